@@ -61,6 +61,7 @@
 #include "ioc.h"
 #include "pm.h"
 #include "atomic.h"
+#include "virtio.h"
 
 #define GUEST_NIO_PORT		0x488	/* guest upcalls via i/o port */
 
@@ -77,6 +78,7 @@ int guest_ncpus;
 char *guest_uuid_str;
 char *vsbl_file_name;
 uint8_t trusty_enabled;
+uint8_t rt_sched_enabled;
 bool stdio_in_use;
 
 static int guest_vmexit_on_hlt, guest_vmexit_on_pause;
@@ -101,6 +103,11 @@ static char vhm_request_page[4096] __attribute__ ((aligned(4096)));
 static struct vhm_request *vhm_req_buf =
 				(struct vhm_request *)&vhm_request_page;
 
+static char posted_ring_page[4096] __attribute__ ((aligned(4096)));
+
+static struct vhm_posted_ring *posted_ring =
+				(struct vhm_posted_ring *)&posted_ring_page;
+
 struct dmstats {
 	uint64_t	vmexit_bogus;
 	uint64_t	vmexit_reqidle;
@@ -129,7 +136,7 @@ usage(int code)
 		"Usage: %s [-abehuwxACHPSTWY] [-c vcpus] [-g <gdb port>] [-l <lpc>]\n"
 		"       %*s [-m mem] [-p vcpu:hostcpu] [-s <pci>] [-U uuid] \n"
 		"       %*s [--vsbl vsbl_file_name] [--part_info part_info_name]\n"
-		"       %*s [--enable_trusty] <vm>\n"
+		"       %*s [--enable_trusty] [--rt_sched] <vm>\n"
 		"       -a: local apic is in xAPIC mode (deprecated)\n"
 		"       -A: create ACPI tables\n"
 		"       -b: enable bvmcons\n"
@@ -160,7 +167,9 @@ usage(int code)
 		"       --vsbl: vsbl file path\n"
 		"       --part_info: guest partition info file path\n"
 		"       --enable_trusty: enable trusty for guest\n"
-		"       --ptdev_no_reset: disable reset check for ptdev\n",
+		"       --ptdev_no_reset: disable reset check for ptdev\n"
+		"       --rt_sched: schedule vcpus with the fixed-priority "
+		"RT policy\n",
 		progname, (int)strlen(progname), "", (int)strlen(progname), "",
 		(int)strlen(progname), "");
 
@@ -392,6 +401,10 @@ handle_vmexit(struct vmctx *ctx, struct vhm_request *vhm_req, int vcpu)
 		exit(1);
 	}
 
+	/* Send the interrupts raised by the handler and the completion of
+	 * the request to the hypervisor together.
+	 */
+	vm_batch_begin(ctx);
 	(*handler[exitcode])(ctx, vhm_req, &vcpu);
 	atomic_store(&vhm_req->processed, REQ_STATE_COMPLETE);
 
@@ -403,10 +416,13 @@ handle_vmexit(struct vmctx *ctx, struct vhm_request *vhm_req, int vcpu)
 	 * hypervisor.
 	 */
 	if ((VM_SUSPEND_SYSTEM_RESET == vm_get_suspend_mode()) ||
-		(VM_SUSPEND_SUSPEND == vm_get_suspend_mode()))
+		(VM_SUSPEND_SUSPEND == vm_get_suspend_mode())) {
+		vm_batch_flush(ctx);
 		return;
+	}
 
 	vm_notify_request_done(ctx, vcpu);
+	vm_batch_flush(ctx);
 }
 
 static int
@@ -458,6 +474,7 @@ vrtc_fail:
 static void
 vm_deinit_vdevs(struct vmctx *ctx)
 {
+	virtio_doorbell_reset(ctx);
 	deinit_pci(ctx);
 	monitor_close();
 	deinit_bvmcons();
@@ -485,6 +502,7 @@ vm_reset_vdevs(struct vmctx *ctx)
 	atkbdc_deinit(ctx);
 	vrtc_deinit(ctx);
 
+	virtio_doorbell_reset(ctx);
 	deinit_pci(ctx);
 	pci_irq_deinit(ctx);
 	ioapic_deinit();
@@ -605,6 +623,60 @@ vm_suspend_resume(struct vmctx *ctx)
 	vm_reset(ctx);
 }
 
+/*
+ * Emulate the writes the hypervisor posted without waiting for them. They are
+ * never notified as done; the ring is drained until the tail read back after
+ * advancing head is unchanged, as the hypervisor only kicks an empty ring.
+ */
+static void
+handle_posted_writes(struct vmctx *ctx)
+{
+	struct vhm_posted_request *entry;
+	struct vhm_request req;
+	uint32_t head, tail;
+	int vcpu;
+
+	head = atomic_load(&posted_ring->head);
+	tail = atomic_load(&posted_ring->tail);
+	while (head != tail) {
+		if ((tail - head) > VHM_POSTED_REQUEST_MAX) {
+			fprintf(stderr, "posted ring corrupted\n");
+			head = tail;
+			break;
+		}
+
+		for (; head != tail; head++) {
+			entry = &posted_ring->entries[head %
+					VHM_POSTED_REQUEST_MAX];
+
+			bzero(&req, sizeof(req));
+			req.type = entry->type;
+			vcpu = entry->vcpu;
+			if (req.type == REQ_PORTIO) {
+				req.reqs.pio_request.direction = REQUEST_WRITE;
+				req.reqs.pio_request.address = entry->address;
+				req.reqs.pio_request.size = entry->size;
+				req.reqs.pio_request.value = entry->value;
+			} else if (req.type == REQ_MMIO) {
+				req.reqs.mmio_request.direction = REQUEST_WRITE;
+				req.reqs.mmio_request.address = entry->address;
+				req.reqs.mmio_request.size = entry->size;
+				req.reqs.mmio_request.value = entry->value;
+			} else {
+				fprintf(stderr, "posted write: bad type 0x%x\n",
+						req.type);
+				continue;
+			}
+
+			(*handler[req.type])(ctx, &req, &vcpu);
+		}
+
+		atomic_store(&posted_ring->head, head);
+		atomic_thread_fence();
+		tail = atomic_load(&posted_ring->tail);
+	}
+}
+
 static void
 vm_loop(struct vmctx *ctx)
 {
@@ -624,11 +696,20 @@ vm_loop(struct vmctx *ctx)
 		if (error)
 			break;
 
+		handle_posted_writes(ctx);
+		virtio_doorbell_handle(ctx);
+
 		for (vcpu_id = 0; vcpu_id < 4; vcpu_id++) {
 			vhm_req = &vhm_req_buf[vcpu_id];
 			if ((atomic_load(&vhm_req->processed) == REQ_STATE_PROCESSING)
-				&& (vhm_req->client == ctx->ioreq_client))
+				&& (vhm_req->client == ctx->ioreq_client)) {
+				/* posted writes and doorbells issued before
+				 * this request are ordered before it
+				 */
+				handle_posted_writes(ctx);
+				virtio_doorbell_handle(ctx);
 				handle_vmexit(ctx, vhm_req, vcpu_id);
+			}
 		}
 
 		if (VM_SUSPEND_SYSTEM_RESET == vm_get_suspend_mode()) {
@@ -687,6 +768,7 @@ enum {
 	CMD_OPT_PART_INFO,
 	CMD_OPT_TRUSTY_ENABLE,
 	CMD_OPT_PTDEV_NO_RESET,
+	CMD_OPT_RT_SCHED,
 };
 
 static struct option long_options[] = {
@@ -723,6 +805,8 @@ static struct option long_options[] = {
 					CMD_OPT_TRUSTY_ENABLE},
 	{"ptdev_no_reset",	no_argument,		0,
 		CMD_OPT_PTDEV_NO_RESET},
+	{"rt_sched",		no_argument,		0,
+					CMD_OPT_RT_SCHED},
 	{0,			0,			0,  0  },
 };
 
@@ -881,6 +965,9 @@ main(int argc, char *argv[])
 		case CMD_OPT_PTDEV_NO_RESET:
 			ptdev_no_reset(true);
 			break;
+		case CMD_OPT_RT_SCHED:
+			rt_sched_enabled = 1;
+			break;
 		case 'h':
 			usage(0);
 		default:
@@ -908,6 +995,13 @@ main(int argc, char *argv[])
 		if (error)
 			goto fail;
 
+		/* set posted write ring, writes are synchronous without it */
+		if (vm_set_posted_ring(ctx, (unsigned long)posted_ring))
+			fprintf(stderr, "posted writes disabled\n");
+
+		/* set doorbell page before the virtio devices use it */
+		virtio_doorbell_init(ctx);
+
 		if (guest_ncpus < 1) {
 			fprintf(stderr, "Invalid guest vCPUs (%d)\n",
 				guest_ncpus);
@@ -37,6 +37,7 @@
 #include <ctype.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <errno.h>
 
 
 
@@ -138,6 +139,12 @@ vm_open(const char *name)
 	else
 		create_vm.vm_flag &= (~SECURE_WORLD_ENABLED);
 
+	/* Set RT scheduling flag */
+	if (rt_sched_enabled)
+		create_vm.vm_flag |= RT_SCHED_ENABLED;
+	else
+		create_vm.vm_flag &= (~RT_SCHED_ENABLED);
+
 	while (retry > 0) {
 		error = ioctl(ctx->fd, IC_CREATE_VM, &create_vm);
 		if (error == 0)
@@ -187,6 +194,59 @@ vm_set_shared_io_page(struct vmctx *ctx, uint64_t page_vma)
 	return 0;
 }
 
+int
+vm_set_posted_ring(struct vmctx *ctx, uint64_t page_vma)
+{
+	int error;
+
+	error = ioctl(ctx->fd, IC_SET_POSTED_RING, page_vma);
+
+	if (error) {
+		fprintf(stderr, "failed to setup posted ring for VM %s\n",
+				ctx->name);
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+vm_set_posted_range(struct vmctx *ctx, uint32_t type, uint64_t start,
+		uint64_t end, bool set)
+{
+	struct acrn_posted_range range;
+
+	bzero(&range, sizeof(range));
+	range.type = type;
+	range.set = set ? 1 : 0;
+	range.start = start;
+	range.end = end;
+
+	return ioctl(ctx->fd, IC_SET_POSTED_RANGE, &range);
+}
+
+int
+vm_set_doorbell_page(struct vmctx *ctx, uint64_t page_vma)
+{
+	int error;
+
+	error = ioctl(ctx->fd, IC_SET_DOORBELL_PAGE, page_vma);
+
+	if (error) {
+		fprintf(stderr, "failed to setup doorbell page for VM %s\n",
+				ctx->name);
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+vm_set_doorbell(struct vmctx *ctx, struct acrn_doorbell *doorbell)
+{
+	return ioctl(ctx->fd, IC_SET_DOORBELL, doorbell);
+}
+
 int
 vm_create_ioreq_client(struct vmctx *ctx)
 {
@@ -216,26 +276,156 @@ vm_attach_ioreq_client(struct vmctx *ctx)
 	return 0;
 }
 
-int
-vm_notify_request_done(struct vmctx *ctx, int vcpu)
+/*
+ * The irqline, MSI and ioreq completion operations of a thread can be
+ * queued between vm_batch_begin() and vm_batch_flush(), and sent to the
+ * hypervisor with a single IC_MULTICALL instead of one ioctl each.
+ */
+struct vm_batch {
+	/* in one page, VHM hands its gpa to the hypervisor */
+	struct acrn_multicall_entry entries[ACRN_MULTICALL_MAX_ENTRIES];
+	struct vmctx *ctx;
+	uint32_t num;
+} __attribute__((aligned(4096)));
+
+static __thread struct vm_batch vm_batch;
+
+/*
+ * Result of the queued operations until the hypervisor runs them, which
+ * it sets to 0 or a negative errno.
+ */
+#define VM_OP_NOT_RUN	1
+
+/* Set once VHM or the hypervisor lacks IC_MULTICALL */
+static bool multicall_unsupported;
+
+static int
+vm_op_ioctl(struct vmctx *ctx, struct acrn_multicall_entry *op)
 {
 	int error;
 	struct ioreq_notify notify;
 
-	bzero(&notify, sizeof(notify));
-	notify.client_id = ctx->ioreq_client;
-	notify.vcpu = vcpu;
+	switch (op->op) {
+	case ACRN_MULTICALL_ASSERT_IRQLINE:
+		return ioctl(ctx->fd, IC_ASSERT_IRQLINE, &op->param.irqline);
+	case ACRN_MULTICALL_DEASSERT_IRQLINE:
+		return ioctl(ctx->fd, IC_DEASSERT_IRQLINE, &op->param.irqline);
+	case ACRN_MULTICALL_PULSE_IRQLINE:
+		return ioctl(ctx->fd, IC_PULSE_IRQLINE, &op->param.irqline);
+	case ACRN_MULTICALL_INJECT_MSI:
+		return ioctl(ctx->fd, IC_INJECT_MSI, &op->param.msi);
+	case ACRN_MULTICALL_NOTIFY_FINISH:
+		bzero(&notify, sizeof(notify));
+		notify.client_id = ctx->ioreq_client;
+		notify.vcpu = op->param.vcpu_id;
+
+		error = ioctl(ctx->fd, IC_NOTIFY_REQUEST_FINISH, &notify);
+		if (error) {
+			fprintf(stderr, "failed: notify request finish\n");
+			return -1;
+		}
+		return 0;
+	default:
+		return -1;
+	}
+}
 
-	error = ioctl(ctx->fd, IC_NOTIFY_REQUEST_FINISH, &notify);
+static int
+vm_batch_submit(struct vmctx *ctx)
+{
+	struct vhm_multicall mc;
+	uint32_t i;
+	int error = 0;
+
+	if (vm_batch.num == 0)
+		return 0;
+
+	for (i = 0; i < vm_batch.num; i++)
+		vm_batch.entries[i].result = VM_OP_NOT_RUN;
+
+	if (!multicall_unsupported) {
+		bzero(&mc, sizeof(mc));
+		mc.vmid = ctx->vmid;
+		mc.entry_num = vm_batch.num;
+		mc.entries_vma = (uint64_t)vm_batch.entries;
+
+		if (ioctl(ctx->fd, IC_MULTICALL, &mc) != 0) {
+			if ((errno == ENOTTY) || (errno == ENOSYS)) {
+				fprintf(stderr, "multicall unsupported, use "
+						"single operations\n");
+				multicall_unsupported = true;
+			} else {
+				perror("multicall failed");
+			}
+		}
+	}
 
-	if (error) {
-		fprintf(stderr, "failed: notify request finish\n");
-		return -1;
+	/* Send the operations the hypervisor did not run one by one */
+	for (i = 0; i < vm_batch.num; i++) {
+		if (vm_batch.entries[i].result == VM_OP_NOT_RUN)
+			vm_batch.entries[i].result =
+				vm_op_ioctl(ctx, &vm_batch.entries[i]);
+		if (vm_batch.entries[i].result != 0) {
+			fprintf(stderr, "multicall op %u failed: %d\n",
+				vm_batch.entries[i].op,
+				vm_batch.entries[i].result);
+			error = -1;
+		}
 	}
+	vm_batch.num = 0;
+
+	return error;
+}
+
+/*
+ * Queue the operation if the calling thread batches the operations of
+ * ctx, otherwise send it at once.
+ */
+static int
+vm_op(struct vmctx *ctx, struct acrn_multicall_entry *op)
+{
+	if (vm_batch.ctx != ctx)
+		return vm_op_ioctl(ctx, op);
+
+	if (vm_batch.num == ACRN_MULTICALL_MAX_ENTRIES)
+		(void)vm_batch_submit(ctx);
+
+	vm_batch.entries[vm_batch.num] = *op;
+	vm_batch.num++;
 
 	return 0;
 }
 
+void
+vm_batch_begin(struct vmctx *ctx)
+{
+	vm_batch.ctx = ctx;
+	vm_batch.num = 0;
+}
+
+int
+vm_batch_flush(struct vmctx *ctx)
+{
+	int error;
+
+	error = vm_batch_submit(ctx);
+	vm_batch.ctx = NULL;
+
+	return error;
+}
+
+int
+vm_notify_request_done(struct vmctx *ctx, int vcpu)
+{
+	struct acrn_multicall_entry op;
+
+	bzero(&op, sizeof(op));
+	op.op = ACRN_MULTICALL_NOTIFY_FINISH;
+	op.param.vcpu_id = vcpu;
+
+	return vm_op(ctx, &op);
+}
+
 void
 vm_destroy(struct vmctx *ctx)
 {
@@ -447,68 +637,75 @@ vm_apicid2vcpu(struct vmctx *ctx, int apicid)
 int
 vm_lapic_msi(struct vmctx *ctx, uint64_t addr, uint64_t msg)
 {
-	struct acrn_msi_entry msi;
+	struct acrn_multicall_entry op;
 
-	bzero(&msi, sizeof(msi));
-	msi.msi_addr = addr;
-	msi.msi_data = msg;
+	bzero(&op, sizeof(op));
+	op.op = ACRN_MULTICALL_INJECT_MSI;
+	op.param.msi.msi_addr = addr;
+	op.param.msi.msi_data = msg;
 
-	return ioctl(ctx->fd, IC_INJECT_MSI, &msi);
+	return vm_op(ctx, &op);
 }
 
 int
 vm_ioapic_assert_irq(struct vmctx *ctx, int irq)
 {
-	struct acrn_irqline ioapic_irq;
+	struct acrn_multicall_entry op;
 
-	bzero(&ioapic_irq, sizeof(ioapic_irq));
-	ioapic_irq.intr_type = ACRN_INTR_TYPE_IOAPIC;
-	ioapic_irq.ioapic_irq = irq;
+	bzero(&op, sizeof(op));
+	op.op = ACRN_MULTICALL_ASSERT_IRQLINE;
+	op.param.irqline.intr_type = ACRN_INTR_TYPE_IOAPIC;
+	op.param.irqline.ioapic_irq = irq;
 
-	return ioctl(ctx->fd, IC_ASSERT_IRQLINE, &ioapic_irq);
+	return vm_op(ctx, &op);
 }
 
 int
 vm_ioapic_deassert_irq(struct vmctx *ctx, int irq)
 {
-	struct acrn_irqline ioapic_irq;
+	struct acrn_multicall_entry op;
 
-	bzero(&ioapic_irq, sizeof(ioapic_irq));
-	ioapic_irq.intr_type = ACRN_INTR_TYPE_IOAPIC;
-	ioapic_irq.ioapic_irq = irq;
+	bzero(&op, sizeof(op));
+	op.op = ACRN_MULTICALL_DEASSERT_IRQLINE;
+	op.param.irqline.intr_type = ACRN_INTR_TYPE_IOAPIC;
+	op.param.irqline.ioapic_irq = irq;
 
-	return ioctl(ctx->fd, IC_DEASSERT_IRQLINE, &ioapic_irq);
+	return vm_op(ctx, &op);
 }
 
 static int
-vm_isa_irq(struct vmctx *ctx, int irq, int ioapic_irq, unsigned long call_id)
+vm_isa_irq(struct vmctx *ctx, int irq, int ioapic_irq, uint32_t op_id)
 {
-	struct acrn_irqline isa_irq;
+	struct acrn_multicall_entry op;
 
-	bzero(&isa_irq, sizeof(isa_irq));
-	isa_irq.intr_type = ACRN_INTR_TYPE_ISA;
-	isa_irq.pic_irq = irq;
-	isa_irq.ioapic_irq = ioapic_irq;
+	bzero(&op, sizeof(op));
+	op.op = op_id;
+	op.param.irqline.intr_type = ACRN_INTR_TYPE_ISA;
+	op.param.irqline.pic_irq = irq;
+	op.param.irqline.ioapic_irq = ioapic_irq;
 
-	return ioctl(ctx->fd, call_id, &isa_irq);
+	return vm_op(ctx, &op);
 }
 
 int
 vm_isa_assert_irq(struct vmctx *ctx, int atpic_irq, int ioapic_irq)
 {
-	return vm_isa_irq(ctx, atpic_irq, ioapic_irq, IC_ASSERT_IRQLINE);
+	return vm_isa_irq(ctx, atpic_irq, ioapic_irq,
+			ACRN_MULTICALL_ASSERT_IRQLINE);
 }
 
 int
 vm_isa_deassert_irq(struct vmctx *ctx, int atpic_irq, int ioapic_irq)
 {
-	return vm_isa_irq(ctx, atpic_irq, ioapic_irq, IC_DEASSERT_IRQLINE);
+	return vm_isa_irq(ctx, atpic_irq, ioapic_irq,
+			ACRN_MULTICALL_DEASSERT_IRQLINE);
 }
 
 int
 vm_isa_pulse_irq(struct vmctx *ctx, int atpic_irq, int ioapic_irq)
 {
-	return vm_isa_irq(ctx, atpic_irq, ioapic_irq, IC_PULSE_IRQLINE);
+	return vm_isa_irq(ctx, atpic_irq, ioapic_irq,
+			ACRN_MULTICALL_PULSE_IRQLINE);
 }
 
 int
@@ -568,6 +568,9 @@ update_bar_address(struct  pci_vdev *dev, uint64_t addr, int idx, int type)
 
 	if (decode)
 		register_bar(dev, idx);
+
+	if (dev->dev_ops->vdev_bar_remap)
+		(*dev->dev_ops->vdev_bar_remap)(dev->vmctx, dev, idx);
 }
 
 int
@@ -1853,6 +1856,9 @@ pci_emul_cmdsts_write(struct pci_vdev *dev, int coff, uint32_t new, int bytes)
 					register_bar(dev, i);
 				else
 					unregister_bar(dev, i);
+				if (dev->dev_ops->vdev_bar_remap)
+					(*dev->dev_ops->vdev_bar_remap)(
+						dev->vmctx, dev, i);
 			}
 			break;
 		case PCIBAR_MEM32:
@@ -1863,6 +1869,9 @@ pci_emul_cmdsts_write(struct pci_vdev *dev, int coff, uint32_t new, int bytes)
 					register_bar(dev, i);
 				else
 					unregister_bar(dev, i);
+				if (dev->dev_ops->vdev_bar_remap)
+					(*dev->dev_ops->vdev_bar_remap)(
+						dev->vmctx, dev, i);
 				}
 			break;
 		default:
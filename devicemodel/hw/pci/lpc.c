@@ -175,6 +175,8 @@ lpc_deinit(struct vmctx *ctx)
 		iop.size = UART_IO_BAR_SIZE;
 		iop.flags = IOPORT_F_INOUT;
 		unregister_inout(&iop);
+		vm_set_posted_range(ctx, REQ_PORTIO, lpc_uart->iobase,
+				lpc_uart->iobase + UART_IO_BAR_SIZE, false);
 
 		uart_release_backend(lpc_uart->uart, lpc_uart->opts);
 		uart_deinit(lpc_uart->uart);
@@ -239,6 +241,15 @@ lpc_init(struct vmctx *ctx)
 		error = register_inout(&iop);
 		assert(error == 0);
 		lpc_uart->enabled = 1;
+
+		/*
+		 * The guest console writes THR one byte at a time, post the
+		 * writes so the vcpu does not wait for each of them. Reads,
+		 * such as LSR polling, are still ordered after them.
+		 */
+		if (vm_set_posted_range(ctx, REQ_PORTIO, lpc_uart->iobase,
+				lpc_uart->iobase + UART_IO_BAR_SIZE, true))
+			fprintf(stderr, "%s: writes are not posted\n", name);
 	}
 
 	return 0;
@@ -27,11 +27,14 @@
 #include <sys/uio.h>
 #include <stdio.h>
 #include <stddef.h>
+#include <string.h>
 #include <pthread.h>
 
 #include "dm.h"
 #include "pci_core.h"
 #include "virtio.h"
+#include "vmmapi.h"
+#include "atomic.h"
 
 /*
  * Functions for dealing with generalized "virtual devices" as
@@ -45,6 +48,151 @@
  */
 #define DEV_STRUCT(vs) ((void *)(vs))
 
+/*
+ * Doorbells let the hypervisor complete the queue notify writes of the
+ * guest by setting a bit in the doorbell page. They are only used for the
+ * devices which track their BAR remapping with virtio_pci_bar_remap(), and
+ * only for the legacy PIO and the modern MMIO notify registers.
+ *
+ * The doorbells are only changed and handled from the vm_loop thread, the
+ * one handling the virtio register accesses, so need no lock.
+ */
+static union acrn_doorbell_page doorbell_page;
+static bool doorbell_enabled;
+static struct virtio_vq_info *doorbell_vqs[ACRN_DOORBELL_MAX];
+
+static void
+virtio_doorbell_clear(struct vmctx *ctx, int idx)
+{
+	struct acrn_doorbell db;
+
+	memset(&db, 0, sizeof(db));
+	db.index = idx;
+	if (vm_set_doorbell(ctx, &db))
+		fprintf(stderr, "failed to clear doorbell %d\r\n", idx);
+	doorbell_vqs[idx] = NULL;
+}
+
+/*
+ * (Re)assign the doorbell of a queue after its notify register moved or
+ * the queue was set up or reset.
+ */
+static void
+virtio_doorbell_update(struct virtio_base *base, struct virtio_vq_info *vq)
+{
+	struct pci_vdev *dev = base->dev;
+	struct acrn_doorbell db;
+	uint16_t cmd;
+	int i, idx = -1;
+
+	if (!doorbell_enabled || dev->dev_ops->vdev_bar_remap == NULL)
+		return;
+
+	for (i = 0; i < ACRN_DOORBELL_MAX; i++) {
+		if (doorbell_vqs[i] == vq)
+			virtio_doorbell_clear(dev->vmctx, i);
+		if (doorbell_vqs[i] == NULL && idx < 0)
+			idx = i;
+	}
+
+	if (idx < 0 || (vq->flags & VQ_ALLOC) == 0)
+		return;
+
+	memset(&db, 0, sizeof(db));
+	cmd = pci_get_cfgdata16(dev, PCIR_COMMAND);
+	if (vq->pfn != 0) {
+		/* legacy: the queue index is written to QNOTIFY */
+		i = base->legacy_pio_bar_idx;
+		if (dev->bar[i].type != PCIBAR_IO ||
+		    (cmd & PCIM_CMD_PORTEN) == 0)
+			return;
+		db.type = REQ_PORTIO;
+		db.address = dev->bar[i].addr + VIRTIO_CR_QNOTIFY;
+		db.flags = ACRN_DOORBELL_DATAMATCH;
+		db.data = vq->num;
+	} else if (vq->enabled) {
+		/* modern: each queue has its own notify address */
+		i = base->modern_mmio_bar_idx;
+		if ((dev->bar[i].type != PCIBAR_MEM32 &&
+		     dev->bar[i].type != PCIBAR_MEM64) ||
+		    (cmd & PCIM_CMD_MEMEN) == 0)
+			return;
+		db.type = REQ_MMIO;
+		db.address = dev->bar[i].addr + VIRTIO_CAP_NOTIFY_OFFSET +
+			vq->num * VIRTIO_MODERN_NOTIFY_OFF_MULT;
+	} else
+		return;
+
+	db.index = idx;
+	db.size = 2;
+	db.flags |= ACRN_DOORBELL_ASSIGN;
+	if (vm_set_doorbell(dev->vmctx, &db) == 0)
+		doorbell_vqs[idx] = vq;
+}
+
+void
+virtio_doorbell_init(struct vmctx *ctx)
+{
+	memset(doorbell_vqs, 0, sizeof(doorbell_vqs));
+	memset(&doorbell_page, 0, sizeof(doorbell_page));
+	doorbell_enabled = (vm_set_doorbell_page(ctx,
+				(uint64_t)&doorbell_page) == 0);
+	if (!doorbell_enabled)
+		fprintf(stderr, "virtio doorbells disabled\r\n");
+}
+
+void
+virtio_doorbell_reset(struct vmctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < ACRN_DOORBELL_MAX; i++) {
+		if (doorbell_vqs[i] != NULL)
+			virtio_doorbell_clear(ctx, i);
+	}
+}
+
+void
+virtio_doorbell_handle(struct vmctx *ctx)
+{
+	struct virtio_vq_info *vq;
+	struct virtio_base *base;
+	uint64_t pending;
+	int i, bit;
+
+	for (i = 0; i < ACRN_DOORBELL_MAX / 64; i++) {
+		pending = atomic_xchg(&doorbell_page.pending[i], 0);
+		while (pending) {
+			bit = __builtin_ctzl(pending);
+			pending &= pending - 1;
+
+			vq = doorbell_vqs[i * 64 + bit];
+			if (vq == NULL)
+				continue;
+
+			base = vq->base;
+			if (base->mtx)
+				pthread_mutex_lock(base->mtx);
+			if (vq->notify)
+				(*vq->notify)(DEV_STRUCT(base), vq);
+			else if (base->vops->qnotify)
+				(*base->vops->qnotify)(DEV_STRUCT(base), vq);
+			if (base->mtx)
+				pthread_mutex_unlock(base->mtx);
+		}
+	}
+}
+
+void
+virtio_pci_bar_remap(struct vmctx *ctx, struct pci_vdev *dev, int baridx)
+{
+	struct virtio_base *base = dev->arg;
+	int i;
+
+	for (i = 0; i < base->vops->nvq; i++)
+		virtio_doorbell_update(base, &base->queues[i]);
+}
+
 /*
  * Link a virtio_base to its constants, the virtio device, and
  * the PCI emulation.
@@ -101,6 +249,7 @@ virtio_reset_dev(struct virtio_base *base)
 		vq->gpa_used[0] = 0;
 		vq->gpa_used[1] = 0;
 		vq->enabled = 0;
+		virtio_doorbell_update(base, vq);
 	}
 	base->negotiated_caps = 0;
 	base->curq = 0;
@@ -214,6 +363,8 @@ virtio_vq_init(struct virtio_base *base, uint32_t pfn)
 	vq->flags = VQ_ALLOC;
 	vq->last_avail = 0;
 	vq->save_used = 0;
+
+	virtio_doorbell_update(base, vq);
 }
 
 /*
@@ -259,6 +410,8 @@ virtio_vq_enable(struct virtio_base *base)
 
 	/* Mark queue as enabled. */
 	vq->enabled = true;
+
+	virtio_doorbell_update(base, vq);
 }
 
 /*
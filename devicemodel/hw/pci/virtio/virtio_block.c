@@ -472,6 +472,7 @@ struct pci_vdev_ops pci_ops_virtio_blk = {
 	.vdev_init	= virtio_blk_init,
 	.vdev_deinit	= virtio_blk_deinit,
 	.vdev_barwrite	= virtio_pci_write,
-	.vdev_barread	= virtio_pci_read
+	.vdev_barread	= virtio_pci_read,
+	.vdev_bar_remap	= virtio_pci_bar_remap
 };
 DEFINE_PCI_DEVTYPE(pci_ops_virtio_blk);
@@ -1103,6 +1103,7 @@ struct pci_vdev_ops pci_ops_virtio_net = {
 	.vdev_init	= virtio_net_init,
 	.vdev_deinit	= virtio_net_deinit,
 	.vdev_barwrite	= virtio_pci_write,
-	.vdev_barread	= virtio_pci_read
+	.vdev_barread	= virtio_pci_read,
+	.vdev_bar_remap	= virtio_pci_bar_remap
 };
 DEFINE_PCI_DEVTYPE(pci_ops_virtio_net);
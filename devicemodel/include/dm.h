@@ -37,6 +37,7 @@ struct vmctx;
 extern int guest_ncpus;
 extern char *guest_uuid_str;
 extern uint8_t trusty_enabled;
+extern uint8_t rt_sched_enabled;
 extern char *vsbl_file_name;
 extern char *vmname;
 extern bool stdio_in_use;
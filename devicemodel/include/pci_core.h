@@ -74,6 +74,10 @@ struct pci_vdev_ops {
 	uint64_t  (*vdev_barread)(struct vmctx *ctx, int vcpu,
 				struct pci_vdev *pi, int baridx,
 				uint64_t offset, int size);
+
+	/* called after the guest changed the address or decoding of a BAR */
+	void	(*vdev_bar_remap)(struct vmctx *ctx, struct pci_vdev *pi,
+				  int baridx);
 };
 
 /*
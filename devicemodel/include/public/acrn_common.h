@@ -67,6 +67,7 @@
 
 /* Generic VM flags from guest OS */
 #define SECURE_WORLD_ENABLED    (1UL<<0)  /* Whether secure world is enabled */
+#define RT_SCHED_ENABLED        (1UL<<1)  /* Whether vcpus use RT scheduling */
 
 /**
  * @brief Hypercall
@@ -226,6 +227,146 @@ union vhm_request_buffer {
 	int8_t reserved[4096];
 } __aligned(4096);
 
+/*
+ * Posted write ring
+ */
+#define VHM_POSTED_REQUEST_MAX	64U
+
+/**
+ * @brief 32-byte posted write
+ *
+ * A port I/O or MMIO write to a range registered by HC_SET_POSTED_RANGE. The
+ * vCPU issuing it is resumed at once and does not wait for its completion.
+ */
+struct vhm_posted_request {
+	/**
+	 * Type of this request, REQ_PORTIO or REQ_MMIO.
+	 *
+	 * Byte offset: 0.
+	 */
+	uint32_t type;
+
+	/**
+	 * The vCPU which issued this write.
+	 *
+	 * Byte offset: 4.
+	 */
+	uint16_t vcpu;
+
+	/**
+	 * Reserved.
+	 *
+	 * Byte offset: 6.
+	 */
+	uint16_t reserved;
+
+	/**
+	 * The port or guest physical address written.
+	 *
+	 * Byte offset: 8.
+	 */
+	uint64_t address;
+
+	/**
+	 * The width of the write in bytes.
+	 *
+	 * Byte offset: 16.
+	 */
+	uint64_t size;
+
+	/**
+	 * The value written.
+	 *
+	 * Byte offset: 24.
+	 */
+	uint64_t value;
+} __aligned(8);
+
+/**
+ * @brief Ring of posted writes, shared between the hypervisor and SOS
+ *
+ * The hypervisor is the only producer and SOS (DM) the only consumer. Both
+ * indexes are free running and taken modulo VHM_POSTED_REQUEST_MAX, the ring
+ * is empty when they are equal and full when they differ by
+ * VHM_POSTED_REQUEST_MAX.
+ *
+ * The hypervisor fills in an entry before advancing tail, and only fires the
+ * upcall when the ring was empty. The consumer shall therefore drain the ring
+ * until it reads back an unchanged tail after advancing head.
+ *
+ * Ordering guarantees:
+ *
+ *   1. Posted writes are consumed in the order they were issued, including
+ *      writes from different vCPUs of the same VM.
+ *
+ *   2. A vhm_request issued by a vCPU becomes PENDING after all the posted
+ *      writes that vCPU issued before it. The consumer shall drain the ring
+ *      before handling any vhm_request, so that a read never passes an
+ *      earlier posted write of the same vCPU.
+ *
+ *   3. When the ring is full the write falls back to a vhm_request, which by
+ *      2. is still ordered after the writes in the ring.
+ *
+ *   4. There is no ordering against writes emulated by the hypervisor itself
+ *      or against accesses to memory directly mapped to the guest.
+ */
+struct vhm_posted_ring {
+	/**
+	 * Index of the next entry to consume, written by SOS only.
+	 *
+	 * Byte offset: 0.
+	 */
+	uint32_t head;
+
+	/**
+	 * Reserved. Keeps head and tail on separate cache lines.
+	 *
+	 * Byte offset: 4.
+	 */
+	uint32_t reserved0[15];
+
+	/**
+	 * Index of the next entry to produce, written by the hypervisor only.
+	 *
+	 * Byte offset: 64.
+	 */
+	uint32_t tail;
+
+	/**
+	 * Reserved.
+	 *
+	 * Byte offset: 68.
+	 */
+	uint32_t reserved1[15];
+
+	/**
+	 * The posted writes.
+	 *
+	 * Byte offset: 128.
+	 */
+	struct vhm_posted_request entries[VHM_POSTED_REQUEST_MAX];
+} __aligned(4096);
+
+/*
+ * Doorbells
+ */
+#define ACRN_DOORBELL_MAX	256U
+
+/**
+ * @brief Pending doorbell bitmap, shared between the hypervisor and SOS
+ *
+ * Bit i of the bitmap is set by the hypervisor when a write hits doorbell i,
+ * and the upcall is only fired when the bit was clear. The consumer shall
+ * atomically clear the bits before handling the doorbells they stand for.
+ *
+ * A doorbell is consumed like a posted write: SOS shall handle the pending
+ * doorbells and the posted write ring before any vhm_request.
+ */
+union acrn_doorbell_page {
+	uint64_t pending[ACRN_DOORBELL_MAX / 64U];
+	int8_t reserved[4096];
+} __aligned(4096);
+
 /**
  * @brief Info to create a VM, the parameter for HC_CREATE_VM hypercall
  */
@@ -247,6 +388,7 @@ struct acrn_create_vm {
 
 	/* VM flag bits from Guest OS, now used
 	 *  SECURE_WORLD_ENABLED          (1UL<<0)
+	 *  RT_SCHED_ENABLED              (1UL<<1)
 	 */
 	uint64_t vm_flag;
 
@@ -277,6 +419,99 @@ struct acrn_set_ioreq_buffer {
 	uint64_t req_buf;
 } __aligned(8);
 
+/**
+ * @brief Info to add or remove a posted write range for a created VM
+ *
+ * the parameter for HC_SET_POSTED_RANGE hypercall
+ */
+struct acrn_posted_range {
+	/** type of the range, REQ_PORTIO or REQ_MMIO */
+	uint32_t type;
+
+	/** 1 to add the range, 0 to remove it */
+	uint32_t set;
+
+	/** the first port or guest physical address of the range */
+	uint64_t start;
+
+	/** the end (exclusive) of the range */
+	uint64_t end;
+} __aligned(8);
+
+/** Set in acrn_doorbell flags to add the doorbell, clear to remove it */
+#define ACRN_DOORBELL_ASSIGN		(1U << 0U)
+
+/** Set in acrn_doorbell flags to only match writes of the data value */
+#define ACRN_DOORBELL_DATAMATCH		(1U << 1U)
+
+/**
+ * @brief Info to add or remove a doorbell for a created VM
+ *
+ * the parameter for HC_SET_DOORBELL hypercall
+ */
+struct acrn_doorbell {
+	/** type of the doorbell, REQ_PORTIO or REQ_MMIO */
+	uint32_t type;
+
+	/** the bit in acrn_doorbell_page to set, below ACRN_DOORBELL_MAX */
+	uint16_t index;
+
+	/** the width in bytes of the matching writes */
+	uint8_t size;
+
+	/** ACRN_DOORBELL_* flags */
+	uint8_t flags;
+
+	/** the port or guest physical address of the doorbell */
+	uint64_t address;
+
+	/** the value to match with ACRN_DOORBELL_DATAMATCH */
+	uint64_t data;
+} __aligned(8);
+
+/** Number of VMX basic exit reasons in acrn_vmexit_stats */
+#define ACRN_VMEXIT_REASON_NUM	65U
+
+/** Number of log2 buckets in the VM exit latency histogram */
+#define ACRN_VMEXIT_HIST_NUM	32U
+
+/**
+ * @brief VM exit statistics of one VMX basic exit reason
+ */
+struct acrn_vmexit_reason_stats {
+	/** number of VM exits */
+	uint64_t count;
+
+	/** TSC cycles from the VM exits to the following VM entries, summed */
+	uint64_t cycles;
+
+	/**
+	 * log2 histogram of the cycles per VM exit: hist[i] counts the exits
+	 * which took [2^i, 2^(i+1)) cycles, the last bucket also counts the
+	 * longer ones. The buckets wrap around at 2^32.
+	 */
+	uint32_t hist[ACRN_VMEXIT_HIST_NUM];
+} __aligned(8);
+
+/**
+ * @brief VM exit statistics of a vCPU
+ *
+ * the parameter for HC_GET_VCPU_EXIT_STATS hypercall
+ */
+struct acrn_vmexit_stats {
+	/** the vCPU to get the statistics of, set by the caller */
+	uint16_t vcpu_id;
+
+	/** the physical CPU the vCPU runs on */
+	uint16_t pcpu_id;
+
+	/** Reserved for future use*/
+	uint32_t reserved;
+
+	/** statistics indexed by VMX basic exit reason */
+	struct acrn_vmexit_reason_stats reasons[ACRN_VMEXIT_REASON_NUM];
+} __aligned(8);
+
 /** Interrupt type for acrn_irqline: inject interrupt to IOAPIC */
 #define	ACRN_INTR_TYPE_ISA	0U
 
@@ -338,6 +573,61 @@ struct acrn_nmi_entry {
 	uint32_t reserved1;
 } __aligned(8);
 
+/** Operations of the acrn_multicall_entry records */
+#define ACRN_MULTICALL_ASSERT_IRQLINE	0U
+#define ACRN_MULTICALL_DEASSERT_IRQLINE	1U
+#define ACRN_MULTICALL_PULSE_IRQLINE	2U
+#define ACRN_MULTICALL_INJECT_MSI	3U
+#define ACRN_MULTICALL_NOTIFY_FINISH	4U
+
+/** Max number of records in one HC_MULTICALL hypercall */
+#define ACRN_MULTICALL_MAX_ENTRIES	64U
+
+/**
+ * @brief One operation of a HC_MULTICALL batch
+ */
+struct acrn_multicall_entry {
+	/** ACRN_MULTICALL_* operation */
+	uint32_t op;
+
+	/** status of the operation, written back by the hypervisor */
+	int32_t result;
+
+	/** parameters of the operation */
+	union {
+		/** irqline for the ASSERT/DEASSERT/PULSE_IRQLINE operations */
+		struct acrn_irqline irqline;
+
+		/** MSI for the INJECT_MSI operation */
+		struct acrn_msi_entry msi;
+
+		/** vCPU which finished its request, for NOTIFY_FINISH */
+		uint16_t vcpu_id;
+
+		/** Reserved */
+		int64_t reserved[3];
+	} param;
+} __aligned(8);
+
+/**
+ * @brief Info to run a batch of operations for a VM
+ *
+ * the parameter for HC_MULTICALL hypercall
+ */
+struct acrn_multicall {
+	/** vmid of the target VM */
+	uint16_t vmid;
+
+	/** Reserved */
+	uint16_t reserved0;
+
+	/** number of records, no more than ACRN_MULTICALL_MAX_ENTRIES */
+	uint32_t entry_num;
+
+	/** the gpa of the struct acrn_multicall_entry array */
+	uint64_t entries_gpa;
+} __aligned(8);
+
 /**
  * @brief Info to remap pass-through PCI MSI for a VM
  *
@@ -64,6 +64,7 @@
 /* General */
 #define IC_ID_GEN_BASE                  0x0UL
 #define IC_GET_API_VERSION             _IC_ID(IC_ID, IC_ID_GEN_BASE + 0x00)
+#define IC_MULTICALL                   _IC_ID(IC_ID, IC_ID_GEN_BASE + 0x01)
 
 /* VM management */
 #define IC_ID_VM_BASE                  0x10UL
@@ -73,6 +74,7 @@
 #define IC_PAUSE_VM                    _IC_ID(IC_ID, IC_ID_VM_BASE + 0x03)
 #define	IC_CREATE_VCPU                 _IC_ID(IC_ID, IC_ID_VM_BASE + 0x04)
 #define IC_RESET_VM                    _IC_ID(IC_ID, IC_ID_VM_BASE + 0x05)
+#define IC_GET_VCPU_EXIT_STATS         _IC_ID(IC_ID, IC_ID_VM_BASE + 0x06)
 
 /* IRQ and Interrupts */
 #define IC_ID_IRQ_BASE                 0x20UL
@@ -88,6 +90,10 @@
 #define IC_CREATE_IOREQ_CLIENT          _IC_ID(IC_ID, IC_ID_IOREQ_BASE + 0x02)
 #define IC_ATTACH_IOREQ_CLIENT          _IC_ID(IC_ID, IC_ID_IOREQ_BASE + 0x03)
 #define IC_DESTROY_IOREQ_CLIENT         _IC_ID(IC_ID, IC_ID_IOREQ_BASE + 0x04)
+#define IC_SET_POSTED_RING              _IC_ID(IC_ID, IC_ID_IOREQ_BASE + 0x05)
+#define IC_SET_POSTED_RANGE             _IC_ID(IC_ID, IC_ID_IOREQ_BASE + 0x06)
+#define IC_SET_DOORBELL_PAGE            _IC_ID(IC_ID, IC_ID_IOREQ_BASE + 0x07)
+#define IC_SET_DOORBELL                 _IC_ID(IC_ID, IC_ID_IOREQ_BASE + 0x08)
 
 /* Guest memory management */
 #define IC_ID_MEM_BASE                  0x40UL
@@ -107,6 +113,10 @@
 #define IC_ID_PM_BASE                   0x60UL
 #define IC_PM_GET_CPU_STATE            _IC_ID(IC_ID, IC_ID_PM_BASE + 0x00)
 
+/* DEBUG */
+#define IC_ID_DBG_BASE                  0x70UL
+#define IC_SETUP_TRACE_FILTER          _IC_ID(IC_ID, IC_ID_DBG_BASE + 0x00)
+
 #define VM_MEMMAP_SYSMEM       0
 #define VM_MMIO         1
 
@@ -191,6 +201,22 @@ struct ioreq_notify {
        uint32_t vcpu;
 };
 
+/**
+ * struct vhm_multicall - data structure of IC_MULTICALL
+ *
+ * @vmid: vmid of the target VM
+ * @entry_num: number of records, no more than ACRN_MULTICALL_MAX_ENTRIES
+ * @entries_vma: user address of the struct acrn_multicall_entry array,
+ *		 which must not cross a page boundary. VHM pins the page and
+ *		 passes its gpa to HC_MULTICALL as acrn_multicall.entries_gpa
+ */
+struct vhm_multicall {
+	uint16_t vmid;
+	uint16_t reserved;
+	uint32_t entry_num;
+	uint64_t entries_vma;
+};
+
 /**
  * struct api_version - data structure to track VHM API version
  *
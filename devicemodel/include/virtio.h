@@ -847,6 +847,51 @@ uint64_t virtio_pci_read(struct vmctx *ctx, int vcpu, struct pci_vdev *dev,
 void virtio_pci_write(struct vmctx *ctx, int vcpu, struct pci_vdev *dev,
 		      int baridx, uint64_t offset, int size, uint64_t value);
 
+/**
+ * @brief Update the doorbells of a virtio device after a BAR remapping.
+ *
+ * Devices setting this as their vdev_bar_remap let the hypervisor complete
+ * the queue notify writes of the guest by ringing a doorbell, instead of
+ * waiting for the device model.
+ *
+ * @param ctx Pointer to struct vmctx representing VM context.
+ * @param dev Pointer to struct pci_vdev which emulates a PCI device.
+ * @param baridx Which BAR[0..5] was remapped.
+ *
+ * @return N/A
+ */
+void virtio_pci_bar_remap(struct vmctx *ctx, struct pci_vdev *dev,
+			  int baridx);
+
+/**
+ * @brief Register the doorbell page of the VM.
+ *
+ * Doorbells are not used if this fails.
+ *
+ * @param ctx Pointer to struct vmctx representing VM context.
+ *
+ * @return N/A
+ */
+void virtio_doorbell_init(struct vmctx *ctx);
+
+/**
+ * @brief Remove all the doorbells, before the devices are deinitialized.
+ *
+ * @param ctx Pointer to struct vmctx representing VM context.
+ *
+ * @return N/A
+ */
+void virtio_doorbell_reset(struct vmctx *ctx);
+
+/**
+ * @brief Notify the queues of all the pending doorbells.
+ *
+ * @param ctx Pointer to struct vmctx representing VM context.
+ *
+ * @return N/A
+ */
+void virtio_doorbell_handle(struct vmctx *ctx);
+
 /**
  * @brief Indicate the device has experienced an error.
  *
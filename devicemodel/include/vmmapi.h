@@ -103,10 +103,17 @@ void	vm_close(struct vmctx *ctx);
 void	vm_pause(struct vmctx *ctx);
 void	vm_reset(struct vmctx *ctx);
 int	vm_set_shared_io_page(struct vmctx *ctx, uint64_t page_vma);
+int	vm_set_posted_ring(struct vmctx *ctx, uint64_t page_vma);
+int	vm_set_posted_range(struct vmctx *ctx, uint32_t type, uint64_t start,
+		uint64_t end, bool set);
+int	vm_set_doorbell_page(struct vmctx *ctx, uint64_t page_vma);
+int	vm_set_doorbell(struct vmctx *ctx, struct acrn_doorbell *doorbell);
 int	vm_create_ioreq_client(struct vmctx *ctx);
 int	vm_destroy_ioreq_client(struct vmctx *ctx);
 int	vm_attach_ioreq_client(struct vmctx *ctx);
 int	vm_notify_request_done(struct vmctx *ctx, int vcpu);
+void	vm_batch_begin(struct vmctx *ctx);
+int	vm_batch_flush(struct vmctx *ctx);
 void	vm_set_suspend_mode(enum vm_suspend_how how);
 int	vm_get_suspend_mode(void);
 void	vm_destroy(struct vmctx *ctx);
@@ -89,6 +89,86 @@ static void ptdev_build_physical_msi(struct vm *vm, struct ptdev_msi_info *info,
 		info->pmsi_addr, info->pmsi_data);
 }
 
+/* The vcpu a MSI can be posted to, NULL if it has to go through the host */
+static struct vcpu *ptdev_posted_intr_vcpu(struct vm *vm, uint16_t phys_bdf,
+		struct ptdev_msi_info *info)
+{
+	uint64_t vdmask;
+	uint32_t dest, delmode;
+	uint16_t vcpu_id;
+	bool phys;
+
+	if (!is_apicv_posted_intr_supported() ||
+			!iommu_posted_intr_supported(phys_bdf)) {
+		return NULL;
+	}
+
+	delmode = info->vmsi_data & APIC_DELMODE_MASK;
+	if (((info->vmsi_data & 0xFFU) < 16U) ||
+		((delmode != APIC_DELMODE_FIXED) &&
+		(delmode != APIC_DELMODE_LOWPRIO))) {
+		return NULL;
+	}
+
+	dest = (info->vmsi_addr >> 12) & 0xffU;
+	phys = ((info->vmsi_addr & MSI_ADDR_LOG) != MSI_ADDR_LOG);
+	calcvdest(vm, &vdmask, dest, phys);
+
+	/* a fixed interrupt to several vcpus cannot be posted, a lowest
+	 * priority one is posted to the first of them
+	 */
+	vcpu_id = ffs64(vdmask);
+	if ((vcpu_id == INVALID_BIT_INDEX) ||
+		((delmode == APIC_DELMODE_FIXED) &&
+		(vdmask != (1UL << vcpu_id)))) {
+		return NULL;
+	}
+
+	return vcpu_from_vid(vm, vcpu_id);
+}
+
+/*
+ * Route the MSI through the interrupt remapping table when the device is
+ * behind a remapping unit: posted to the vlapic of the target vcpu, so it
+ * is delivered without VM exit while the vcpu runs, or remapped to the
+ * host vector and destination built by ptdev_build_physical_msi().
+ */
+static void ptdev_remap_physical_msi(struct vm *vm,
+		struct ptdev_remapping_info *entry,
+		struct ptdev_msi_info *info, uint32_t vector)
+{
+	uint16_t phys_bdf = entry->phys_sid.msi_id.bdf;
+	struct vcpu *vcpu;
+	uint32_t idx;
+
+	if ((entry->irte_idx == INVALID_IRTE_INDEX) &&
+		(iommu_alloc_irte(phys_bdf, &entry->irte_idx) != 0)) {
+		/* keep the compatibility format */
+		return;
+	}
+
+	vcpu = ptdev_posted_intr_vcpu(vm, phys_bdf, info);
+	if (vcpu != NULL) {
+		iommu_set_posted_irte(phys_bdf, entry->irte_idx,
+			info->vmsi_data & 0xFFU,
+			vlapic_apicv_get_pir_desc_addr(vcpu->arch_vcpu.vlapic));
+	} else {
+		iommu_set_remapped_irte(phys_bdf, entry->irte_idx, vector,
+			(info->pmsi_addr >> 12U) & 0xFFU,
+			info->pmsi_data & APIC_DELMODE_MASK);
+	}
+
+	idx = entry->irte_idx;
+	info->pmsi_addr = MSI_ADDR_BASE | MSI_ADDR_REMAP |
+		((idx & 0x7FFFU) << MSI_ADDR_HANDLE_SHIFT) |
+		(((idx >> 15U) & 0x1U) << 2U);
+	info->pmsi_data = 0U;
+
+	dev_dbg(ACRN_DBG_IRQ, "MSI IRTE %d %s -> 0x%x:%x(P)", idx,
+		(vcpu != NULL) ? "posted" : "remapped",
+		info->pmsi_addr, info->pmsi_data);
+}
+
 static union ioapic_rte
 ptdev_build_physical_rte(struct vm *vm,
 		struct ptdev_remapping_info *entry)
@@ -165,14 +245,14 @@ add_msix_remapping(struct vm *vm, uint16_t virt_bdf, uint16_t phys_bdf,
 	DEFINE_MSI_SID(phys_sid, phys_bdf, entry_nr);
 	DEFINE_MSI_SID(virt_sid, virt_bdf, entry_nr);
 
-	spinlock_obtain(&ptdev_lock);
+	mcs_spinlock_obtain(&ptdev_lock);
 	entry = ptdev_lookup_entry_by_sid(PTDEV_INTR_MSI, &phys_sid, NULL);
 	if (entry == NULL) {
 		if (ptdev_lookup_entry_by_sid(PTDEV_INTR_MSI,
 				&virt_sid, vm) != NULL) {
 			pr_err("MSIX re-add vbdf%x", virt_bdf);
 
-			spinlock_release(&ptdev_lock);
+			mcs_spinlock_release(&ptdev_lock);
 			return NULL;
 		}
 		entry = alloc_entry(vm, PTDEV_INTR_MSI);
@@ -183,6 +263,13 @@ add_msix_remapping(struct vm *vm, uint16_t virt_bdf, uint16_t phys_bdf,
 		ptdev_activate_entry(entry, IRQ_INVALID);
 	} else if (entry->vm != vm) {
 		if (is_vm0(entry->vm)) {
+			/* stop posting to vm0, the new owner programs the
+			 * MSI again before using it
+			 */
+			if (entry->irte_idx != INVALID_IRTE_INDEX) {
+				iommu_free_irte(phys_bdf, entry->irte_idx);
+				entry->irte_idx = INVALID_IRTE_INDEX;
+			}
 			entry->vm = vm;
 			entry->virt_sid.msi_id.bdf = virt_bdf;
 		} else {
@@ -195,14 +282,14 @@ add_msix_remapping(struct vm *vm, uint16_t virt_bdf, uint16_t phys_bdf,
 			ASSERT(false, "msix entry pbdf%x idx%d already in vm%d",
 			       phys_bdf, entry_nr, entry->vm->vm_id);
 
-			spinlock_release(&ptdev_lock);
+			mcs_spinlock_release(&ptdev_lock);
 			return NULL;
 		}
 	} else {
 		/* The mapping has already been added to the VM. No action
 		 * required. */
 	}
-	spinlock_release(&ptdev_lock);
+	mcs_spinlock_release(&ptdev_lock);
 
 	dev_dbg(ACRN_DBG_IRQ,
 		"VM%d MSIX add vector mapping vbdf%x:pbdf%x idx=%d",
@@ -218,7 +305,7 @@ remove_msix_remapping(struct vm *vm, uint16_t virt_bdf, uint32_t entry_nr)
 	struct ptdev_remapping_info *entry;
 	DEFINE_MSI_SID(virt_sid, virt_bdf, entry_nr);
 
-	spinlock_obtain(&ptdev_lock);
+	mcs_spinlock_obtain(&ptdev_lock);
 	entry = ptdev_lookup_entry_by_sid(PTDEV_INTR_MSI, &virt_sid, vm);
 	if (entry == NULL) {
 		goto END;
@@ -237,7 +324,7 @@ remove_msix_remapping(struct vm *vm, uint16_t virt_bdf, uint32_t entry_nr)
 	release_entry(entry);
 
 END:
-	spinlock_release(&ptdev_lock);
+	mcs_spinlock_release(&ptdev_lock);
 
 }
 
@@ -263,13 +350,13 @@ add_intx_remapping(struct vm *vm, uint8_t virt_pin,
 		return NULL;
 	}
 
-	spinlock_obtain(&ptdev_lock);
+	mcs_spinlock_obtain(&ptdev_lock);
 	entry = ptdev_lookup_entry_by_sid(PTDEV_INTR_INTX, &phys_sid, NULL);
 	if (entry == NULL) {
 		if (ptdev_lookup_entry_by_sid(PTDEV_INTR_INTX,
 				&virt_sid, vm) != NULL) {
 			pr_err("INTX re-add vpin %d", virt_pin);
-			spinlock_release(&ptdev_lock);
+			mcs_spinlock_release(&ptdev_lock);
 			return NULL;
 		}
 		entry = alloc_entry(vm, PTDEV_INTR_INTX);
@@ -289,7 +376,7 @@ add_intx_remapping(struct vm *vm, uint8_t virt_pin,
 				entry->virt_sid.intx_id.pin,
 				vm->vm_id, virt_pin);
 
-			spinlock_release(&ptdev_lock);
+			mcs_spinlock_release(&ptdev_lock);
 			return NULL;
 		}
 	} else {
@@ -297,7 +384,7 @@ add_intx_remapping(struct vm *vm, uint8_t virt_pin,
 		 * required. */
 	}
 
-	spinlock_release(&ptdev_lock);
+	mcs_spinlock_release(&ptdev_lock);
 
 	dev_dbg(ACRN_DBG_IRQ,
 		"VM%d INTX add pin mapping vpin%d:ppin%d",
@@ -315,7 +402,7 @@ static void remove_intx_remapping(struct vm *vm, uint8_t virt_pin, bool pic_pin)
 		pic_pin ? PTDEV_VPIN_PIC : PTDEV_VPIN_IOAPIC;
 	DEFINE_IOAPIC_SID(virt_sid, virt_pin, vpin_src);
 
-	spinlock_obtain(&ptdev_lock);
+	mcs_spinlock_obtain(&ptdev_lock);
 	entry = ptdev_lookup_entry_by_sid(PTDEV_INTR_INTX, &virt_sid, vm);
 	if (entry == NULL) {
 		goto END;
@@ -339,7 +426,7 @@ static void remove_intx_remapping(struct vm *vm, uint8_t virt_pin, bool pic_pin)
 	release_entry(entry);
 
 END:
-	spinlock_release(&ptdev_lock);
+	mcs_spinlock_release(&ptdev_lock);
 }
 
 static void ptdev_intr_handle_irq(struct vm *vm,
@@ -394,10 +481,11 @@ static void ptdev_intr_handle_irq(struct vm *vm,
 	}
 }
 
-void ptdev_softirq(__unused uint16_t cpu_id)
+void ptdev_softirq(uint16_t pcpu_id)
 {
 	while (1) {
-		struct ptdev_remapping_info *entry = ptdev_dequeue_softirq();
+		struct ptdev_remapping_info *entry =
+			ptdev_dequeue_softirq(pcpu_id);
 		struct ptdev_msi_info *msi = &entry->msi;
 		struct vm *vm;
 
@@ -442,9 +530,9 @@ void ptdev_intx_ack(struct vm *vm, uint8_t virt_pin,
 	struct ptdev_remapping_info *entry;
 	DEFINE_IOAPIC_SID(virt_sid, virt_pin, vpin_src);
 
-	spinlock_obtain(&ptdev_lock);
+	mcs_spinlock_obtain(&ptdev_lock);
 	entry = ptdev_lookup_entry_by_sid(PTDEV_INTR_INTX, &virt_sid, vm);
-	spinlock_release(&ptdev_lock);
+	mcs_spinlock_release(&ptdev_lock);
 	if (entry == NULL) {
 		return;
 	}
@@ -495,9 +583,9 @@ int ptdev_msix_remap(struct vm *vm, uint16_t virt_bdf,
 	 * For SOS(vm0), it adds the mapping entries at runtime, if the
 	 * entry already be held by others, return error.
 	 */
-	spinlock_obtain(&ptdev_lock);
+	mcs_spinlock_obtain(&ptdev_lock);
 	entry = ptdev_lookup_entry_by_sid(PTDEV_INTR_MSI, &virt_sid, vm);
-	spinlock_release(&ptdev_lock);
+	mcs_spinlock_release(&ptdev_lock);
 	if (entry == NULL) {
 		/* VM0 we add mapping dynamically */
 		if (is_vm0(vm)) {
@@ -525,6 +613,10 @@ int ptdev_msix_remap(struct vm *vm, uint16_t virt_bdf,
 
 	/* build physical config MSI, update to info->pmsi_xxx */
 	ptdev_build_physical_msi(vm, info, irq_to_vector(entry->allocated_pirq));
+	if (iommu_intr_remapping_supported(entry->phys_sid.msi_id.bdf)) {
+		ptdev_remap_physical_msi(vm, entry, info,
+			irq_to_vector(entry->allocated_pirq));
+	}
 	entry->msi = *info;
 
 	dev_dbg(ACRN_DBG_IRQ,
@@ -595,9 +687,9 @@ int ptdev_intx_pin_remap(struct vm *vm, uint8_t virt_pin,
 	}
 
 	/* query if we have virt to phys mapping */
-	spinlock_obtain(&ptdev_lock);
+	mcs_spinlock_obtain(&ptdev_lock);
 	entry = ptdev_lookup_entry_by_sid(PTDEV_INTR_INTX, &virt_sid, vm);
-	spinlock_release(&ptdev_lock);
+	mcs_spinlock_release(&ptdev_lock);
 	if (entry == NULL) {
 		if (is_vm0(vm)) {
 			bool pic_pin = (vpin_src == PTDEV_VPIN_PIC);
@@ -614,10 +706,10 @@ int ptdev_intx_pin_remap(struct vm *vm, uint8_t virt_pin,
 					pic_ioapic_pin_map[virt_pin],
 					pic_pin ? PTDEV_VPIN_IOAPIC :
 					PTDEV_VPIN_PIC);
-				spinlock_obtain(&ptdev_lock);
+				mcs_spinlock_obtain(&ptdev_lock);
 				entry = ptdev_lookup_entry_by_sid(
 					PTDEV_INTR_INTX, &tmp_vsid, vm);
-				spinlock_release(&ptdev_lock);
+				mcs_spinlock_release(&ptdev_lock);
 				if (entry != NULL) {
 					need_switch_vpin_src = true;
 				}
@@ -813,7 +905,7 @@ void get_ptdev_info(char *str_arg, int str_max)
 	size -= len;
 	str += len;
 
-	spinlock_obtain(&ptdev_lock);
+	mcs_spinlock_obtain(&ptdev_lock);
 	list_for_each(pos, &ptdev_list) {
 		entry = list_entry(pos, struct ptdev_remapping_info,
 				entry_node);
@@ -841,7 +933,7 @@ void get_ptdev_info(char *str_arg, int str_max)
 			str += len;
 		}
 	}
-	spinlock_release(&ptdev_lock);
+	mcs_spinlock_release(&ptdev_lock);
 
 	snprintf(str, size, "\r\n");
 }
@@ -396,6 +396,9 @@ void bsp_boot_init(void)
 	 */
 	get_cpu_capabilities();
 
+	init_fast_strings(cpu_has_cap(X86_FEATURE_ERMS),
+			cpu_has_cap(X86_FEATURE_FSRM));
+
 	get_cpu_name();
 
 	load_cpu_state_data();
@@ -685,10 +688,108 @@ void stop_cpus(void)
 	}
 }
 
-void cpu_do_idle(__unused uint16_t pcpu_id)
+/*
+ * Called from the idle loop, with interrupts disabled, when there is no
+ * reschedule or offline request pending. Poll for CONFIG_IDLE_POLL_US, with
+ * interrupts enabled, until the sched_ctx flags are set or a softirq is
+ * pending: a softirq raised by the interrupt handlers meanwhile, e.g. the
+ * timer one, may make a halted vcpu of this pcpu runnable, which only
+ * happens once the idle loop runs the softirqs. Then test both again, with
+ * interrupts disabled and after arming MONITOR on the flags, before going
+ * to sleep, so that neither a request nor a softirq raised since is slept
+ * over. MWAIT only monitors the flags: a softirq raised once asleep comes
+ * with the interrupt which wakes the pcpu.
+ */
+void cpu_do_idle(uint16_t pcpu_id)
+{
+	struct cpu_idle_info *idle = &per_cpu(idle, pcpu_id);
+	uint64_t *flags = &per_cpu(sched_ctx, pcpu_id).flags;
+	uint64_t *softirq = &per_cpu(softirq_pending, pcpu_id);
+	uint64_t poll_ticks = us_to_ticks(CONFIG_IDLE_POLL_US);
+	uint64_t start, now;
+
+	start = rdtsc();
+	atomic_store32(&idle->state, IDLE_STATE_POLL);
+
+	CPU_IRQ_ENABLE();
+	do {
+		asm volatile ("pause" ::: "memory");
+		now = rdtsc();
+	} while ((atomic_load64(flags) == 0UL) &&
+			(atomic_load64(softirq) == 0UL) &&
+			((now - start) < poll_ticks));
+	CPU_IRQ_DISABLE();
+
+	idle->poll_cycles += now - start;
+
+#ifndef CONFIG_PARTITION_MODE
+	if (get_monitor_cap()) {
+		atomic_store32(&idle->state, IDLE_STATE_MWAIT);
+		asm volatile ("monitor" : : "a" (flags), "c" (0U), "d" (0U));
+	} else {
+		atomic_store32(&idle->state, IDLE_STATE_HLT);
+	}
+
+	/* Pairs with the atomic flags update in make_reschedule_request(),
+	 * which sends no IPI to a pcpu it sees polling or in MWAIT.
+	 */
+	CPU_MEMORY_BARRIER();
+
+	/* Pending softirqs may wake up a halted vcpu of this pcpu */
+	if ((atomic_load64(flags) == 0UL) &&
+			(atomic_load64(softirq) == 0UL)) {
+		/* STI only enables interrupts after the next instruction */
+		if (idle->state == IDLE_STATE_MWAIT) {
+			asm volatile ("sti; mwait" : : "a" (0U), "c" (0U)
+					: "memory");
+		} else {
+			asm volatile ("sti; hlt" ::: "memory");
+		}
+		CPU_IRQ_DISABLE();
+
+		start = now;
+		now = rdtsc();
+		idle->sleep_cycles += now - start;
+		idle->sleep_count++;
+	}
+#endif
+
+	atomic_store32(&idle->state, IDLE_STATE_NONE);
+}
+
+#ifdef HV_DEBUG
+void get_cpu_idle_stats(char *str_arg, int str_max)
 {
-	__asm __volatile("pause" ::: "memory");
+	char *str = str_arg;
+	int len, size = str_max;
+	struct cpu_idle_info *idle;
+	uint64_t now = rdtsc();
+	uint16_t pcpu_id;
+
+	len = snprintf(str, size, "\r\nidle sleep: %s, poll window: %dus"
+			"\r\nCPU\t     POLL(us)\t    SLEEP(us)\t     SLEEPS"
+			"\tIDLE%%",
+			get_monitor_cap() ? "mwait" : "hlt",
+			CONFIG_IDLE_POLL_US);
+	size -= len;
+	str += len;
+
+	for (pcpu_id = 0U; pcpu_id < phys_cpu_num; pcpu_id++) {
+		idle = &per_cpu(idle, pcpu_id);
+		/* residency relative to the TSC, which counts since reset */
+		len = snprintf(str, size,
+			"\r\n%hu\t%13lld\t%13lld\t%11lld\t%lld", pcpu_id,
+			ticks_to_us(idle->poll_cycles),
+			ticks_to_us(idle->sleep_cycles), idle->sleep_count,
+			((idle->poll_cycles + idle->sleep_cycles) * 100UL) /
+			now);
+		size -= len;
+		str += len;
+	}
+
+	snprintf(str, size, "\r\n");
 }
+#endif /* HV_DEBUG */
 
 void cpu_dead(uint16_t pcpu_id)
 {
@@ -848,6 +949,13 @@ bool is_apicv_intr_delivery_supported(void)
 	return ((cpu_caps.apicv_features & VAPIC_FEATURE_INTR_DELIVERY) != 0U);
 }
 
+/* Posted-interrupt processing needs virtual interrupt delivery */
+bool is_apicv_posted_intr_supported(void)
+{
+	return (is_apicv_intr_delivery_supported() &&
+		((cpu_caps.apicv_features & VAPIC_FEATURE_POST_INTR) != 0U));
+}
+
 
 static void cpu_xsave_init(void)
 {
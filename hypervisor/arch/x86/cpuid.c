@@ -8,41 +8,58 @@
 
 extern bool x2apic_enabled;
 
-static inline struct vcpuid_entry *find_vcpuid_entry(const struct vcpu *vcpu,
-					uint32_t leaf_arg, uint32_t subleaf)
+static inline struct vcpuid_index *get_vcpuid_index(struct vm *vm,
+		uint32_t leaf)
 {
-	uint32_t i = 0U, nr, half;
-	struct vcpuid_entry *entry = NULL;
-	struct vm *vm = vcpu->vm;
-	uint32_t leaf = leaf_arg;
+	uint32_t range = leaf >> 30U;
+	uint32_t offset = leaf & 0x3fffffffU;
 
-	nr = vm->vcpuid_entry_nr;
-	half = nr >> 1U;
-	if (vm->vcpuid_entries[half].leaf < leaf) {
-		i = half;
+	if ((range >= VCPUID_RANGE_NR) || (offset >= VCPUID_RANGE_LEAVES)) {
+		return NULL;
 	}
 
-	for (; i < nr; i++) {
-		struct vcpuid_entry *tmp = &vm->vcpuid_entries[i];
+	return &vm->vcpuid_index[range][offset];
+}
 
-		if (tmp->leaf < leaf) {
-			continue;
-		} else if (tmp->leaf == leaf) {
-			if (((tmp->flags & CPUID_CHECK_SUBLEAF) != 0U) &&
-				(tmp->subleaf != subleaf)) {
-				continue;
-			}
-			entry = tmp;
-			break;
-		} else {
-			/* tmp->leaf > leaf */
-			break;
+static inline struct vcpuid_entry *lookup_vcpuid_entry(struct vm *vm,
+		uint32_t leaf, uint32_t subleaf)
+{
+	struct vcpuid_index *index = get_vcpuid_index(vm, leaf);
+	struct vcpuid_entry *entry;
+	uint32_t i;
+
+	if ((index == NULL) || (index->nr == 0U)) {
+		return NULL;
+	}
+
+	entry = &vm->vcpuid_entries[index->first];
+	if ((entry->flags & CPUID_CHECK_SUBLEAF) == 0U) {
+		return entry;
+	}
+
+	/* The subleaves are stored in order, mostly without holes */
+	if ((subleaf < index->nr) && (entry[subleaf].subleaf == subleaf)) {
+		return &entry[subleaf];
+	}
+
+	for (i = 0U; i < index->nr; i++) {
+		if (entry[i].subleaf == subleaf) {
+			return &entry[i];
 		}
 	}
 
-	if (entry == NULL) {
-		uint32_t limit;
+	return NULL;
+}
+
+static inline struct vcpuid_entry *find_vcpuid_entry(const struct vcpu *vcpu,
+					uint32_t leaf, uint32_t subleaf)
+{
+	struct vm *vm = vcpu->vm;
+	struct vcpuid_entry *entry;
+	uint32_t limit;
 
+	entry = lookup_vcpuid_entry(vm, leaf, subleaf);
+	if (entry == NULL) {
 		if ((leaf & 0x80000000U) != 0U) {
 			limit = vm->vcpuid_xlevel;
 		}
@@ -56,10 +73,9 @@ static inline struct vcpuid_entry *find_vcpuid_entry(const struct vcpu *vcpu,
 			 * (Intel SDM Vol. 2A - Instruction Set Reference -
 			 * CPUID)
 			 */
-			leaf = vm->vcpuid_level;
-			return find_vcpuid_entry(vcpu, leaf, subleaf);
+			entry = lookup_vcpuid_entry(vm, vm->vcpuid_level,
+					subleaf);
 		}
-
 	}
 
 	return entry;
@@ -69,6 +85,7 @@ static inline int set_vcpuid_entry(struct vm *vm,
 				const struct vcpuid_entry *entry)
 {
 	struct vcpuid_entry *tmp;
+	struct vcpuid_index *index;
 	size_t entry_size = sizeof(struct vcpuid_entry);
 
 	if (vm->vcpuid_entry_nr == MAX_VM_VCPUID_ENTRIES) {
@@ -77,6 +94,19 @@ static inline int set_vcpuid_entry(struct vm *vm,
 		return -ENOMEM;
 	}
 
+	index = get_vcpuid_index(vm, entry->leaf);
+	if (index == NULL) {
+		pr_err("%s, cpuid leaf 0x%x out of the index\n",
+				__func__, entry->leaf);
+		return -EINVAL;
+	}
+
+	/* the entries of a leaf are set one after another */
+	if (index->nr == 0U) {
+		index->first = (uint8_t)vm->vcpuid_entry_nr;
+	}
+	index->nr++;
+
 	tmp = &vm->vcpuid_entries[vm->vcpuid_entry_nr];
 	vm->vcpuid_entry_nr++;
 	(void)memcpy_s(tmp, entry_size, entry, entry_size);
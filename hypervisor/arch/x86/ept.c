@@ -53,6 +53,102 @@ void free_ept_mem(uint64_t *pml4_page)
 	free_paging_struct((void *)pml4_page);
 }
 
+#ifdef HV_DEBUG
+/* Count the 4K, 2M and 1G mappings of an EPT */
+static void count_ept_mappings(uint64_t *pml4_page, uint64_t count[3])
+{
+	uint64_t *pdpt_page, *pd_page, *pt_page;
+	uint64_t *pml4e, *pdpte, *pde;
+	uint64_t pml4e_idx, pdpte_idx, pde_idx, pte_idx;
+
+	for (pml4e_idx = 0U; pml4e_idx < PTRS_PER_PML4E; pml4e_idx++) {
+		pml4e = pml4_page + pml4e_idx;
+		if (pgentry_present(PTT_EPT, *pml4e) == 0UL) {
+			continue;
+		}
+		pdpt_page = pml4e_page_vaddr(*pml4e);
+
+		for (pdpte_idx = 0U; pdpte_idx < PTRS_PER_PDPTE; pdpte_idx++) {
+			pdpte = pdpt_page + pdpte_idx;
+			if (pgentry_present(PTT_EPT, *pdpte) == 0UL) {
+				continue;
+			}
+			if (pdpte_large(*pdpte) != 0UL) {
+				count[2]++;
+				continue;
+			}
+			pd_page = pdpte_page_vaddr(*pdpte);
+
+			for (pde_idx = 0U; pde_idx < PTRS_PER_PDE; pde_idx++) {
+				pde = pd_page + pde_idx;
+				if (pgentry_present(PTT_EPT, *pde) == 0UL) {
+					continue;
+				}
+				if (pde_large(*pde) != 0UL) {
+					count[1]++;
+					continue;
+				}
+				pt_page = pde_page_vaddr(*pde);
+
+				for (pte_idx = 0U; pte_idx < PTRS_PER_PTE;
+						pte_idx++) {
+					if (pgentry_present(PTT_EPT,
+						pt_page[pte_idx]) != 0UL) {
+						count[0]++;
+					}
+				}
+			}
+		}
+	}
+}
+
+void get_ept_stats(char *str_arg, int str_max, uint16_t vmid)
+{
+	char *str = str_arg;
+	int len, size = str_max;
+	struct vm *vm = get_vm_from_vmid(vmid);
+	uint64_t count[3] = {0UL, 0UL, 0UL};
+
+	if (vm == NULL) {
+		len = snprintf(str, size,
+			"\r\nvm is not exist for vmid %hu", vmid);
+		size -= len;
+		str += len;
+		goto END;
+	}
+
+	len = snprintf(str, size, "\r\nEPT\t\t4K\t\t2M\t\t1G");
+	size -= len;
+	str += len;
+
+	count_ept_mappings((uint64_t *)vm->arch_vm.nworld_eptp, count);
+	len = snprintf(str, size, "\r\nnormal\t\t%lld\t\t%lld\t\t%lld",
+		count[0], count[1], count[2]);
+	size -= len;
+	str += len;
+
+	if (vm->arch_vm.sworld_eptp != NULL) {
+		count[0] = 0UL;
+		count[1] = 0UL;
+		count[2] = 0UL;
+		count_ept_mappings((uint64_t *)vm->arch_vm.sworld_eptp,
+				count);
+		len = snprintf(str, size,
+			"\r\nsecure\t\t%lld\t\t%lld\t\t%lld",
+			count[0], count[1], count[2]);
+		size -= len;
+		str += len;
+	}
+
+	len = snprintf(str, size, "\r\nEPT flushes avoided by batching: %lld",
+		vm->arch_vm.ept_flush_avoided);
+	size -= len;
+	str += len;
+END:
+	snprintf(str, size, "\r\n");
+}
+#endif /* HV_DEBUG */
+
 void destroy_ept(struct vm *vm)
 {
 	if (vm->arch_vm.nworld_eptp != NULL)
@@ -219,11 +315,115 @@ int ept_misconfig_vmexit_handler(__unused struct vcpu *vcpu)
 	return status;
 }
 
-int ept_mr_add(const struct vm *vm, uint64_t *pml4_page,
-	uint64_t hpa, uint64_t gpa, uint64_t size, uint64_t prot_orig)
+static void ept_flush_vcpus(struct vm *vm)
 {
 	uint16_t i;
 	struct vcpu *vcpu;
+
+	foreach_vcpu(i, vm, vcpu) {
+		vcpu_make_request(vcpu, ACRN_REQUEST_EPT_FLUSH);
+	}
+}
+
+/*
+ * Make all vcpus of the VM flush their EPT TLB after an update, or
+ * only record it when this pcpu has a batch open on the VM. The guest
+ * page walks cached by gva2gpa() are dropped at once.
+ */
+static void ept_flush(struct vm *vm)
+{
+	uint16_t pcpu_id = get_cpu_id();
+
+	atomic_inc32(&vm->arch_vm.ept_gen);
+	if ((per_cpu(ept_batch_depth, pcpu_id) != 0U) &&
+			(per_cpu(ept_batch_vm, pcpu_id) == vm)) {
+		if (per_cpu(ept_flush_pending, pcpu_id)) {
+			atomic_inc64(&vm->arch_vm.ept_flush_avoided);
+		}
+		per_cpu(ept_flush_pending, pcpu_id) = true;
+	} else {
+		ept_flush_vcpus(vm);
+	}
+}
+
+/**
+ * Open an EPT update batch on the VM: the EPT TLB flushes of the
+ * ept_mr_* calls made by this pcpu are deferred to ept_batch_end(),
+ * which flushes once. The batch belongs to the calling pcpu, updates
+ * done by other pcpus meanwhile are flushed at once. Batches may nest
+ * on the same VM.
+ */
+void ept_batch_begin(struct vm *vm)
+{
+	uint16_t pcpu_id = get_cpu_id();
+
+	ASSERT((per_cpu(ept_batch_depth, pcpu_id) == 0U) ||
+		(per_cpu(ept_batch_vm, pcpu_id) == vm),
+		"nested EPT batches on different VMs");
+	per_cpu(ept_batch_vm, pcpu_id) = vm;
+	per_cpu(ept_batch_depth, pcpu_id)++;
+}
+
+void ept_batch_end(struct vm *vm)
+{
+	uint16_t pcpu_id = get_cpu_id();
+
+	per_cpu(ept_batch_depth, pcpu_id)--;
+	if ((per_cpu(ept_batch_depth, pcpu_id) == 0U) &&
+			per_cpu(ept_flush_pending, pcpu_id)) {
+		per_cpu(ept_flush_pending, pcpu_id) = false;
+		ept_flush_vcpus(vm);
+	}
+}
+
+static void ept_invept_local(void *data)
+{
+	struct vcpu *vcpu = vcpu_from_pid((struct vm *)data, get_cpu_id());
+
+	if (vcpu != NULL) {
+		invept(vcpu);
+	}
+}
+
+/*
+ * Free the EPT tables merge_page_table() unlinked during this update,
+ * once INVEPT has completed on every pcpu running a vcpu of the VM, as
+ * the requested flushes are asynchronous and may be batched, and the
+ * IOMMU domain of the VM, which walks the same tables, was invalidated.
+ */
+static void ept_free_merged(struct vm *vm)
+{
+	uint16_t i, pcpu_id = get_cpu_id();
+	uint32_t j, num = per_cpu(ept_merged_num, pcpu_id);
+	uint64_t mask = 0UL;
+	struct vcpu *vcpu;
+
+	if (num == 0U) {
+		return;
+	}
+
+	foreach_vcpu(i, vm, vcpu) {
+		bitmap_set_nolock(vcpu->pcpu_id, &mask);
+	}
+	if (bitmap_test_and_clear_nolock(pcpu_id, &mask)) {
+		ept_invept_local(vm);
+	}
+	if (mask != 0UL) {
+		smp_call_function(mask, ept_invept_local, vm);
+	}
+	if (vm->iommu != NULL) {
+		iommu_flush_domain(vm->iommu);
+	}
+
+	for (j = 0U; j < num; j++) {
+		free_paging_struct(per_cpu(ept_merged, pcpu_id)[j]);
+	}
+	per_cpu(ept_merged_num, pcpu_id) = 0U;
+}
+
+int ept_mr_add(struct vm *vm, uint64_t *pml4_page,
+	uint64_t hpa, uint64_t gpa, uint64_t size, uint64_t prot_orig)
+{
 	int ret;
 	uint64_t prot = prot_orig;
 
@@ -246,36 +446,30 @@ int ept_mr_add(const struct vm *vm, uint64_t *pml4_page,
 			gpa, hpa, size, prot, PTT_EPT);
 	}
 
-	foreach_vcpu(i, vm, vcpu) {
-		vcpu_make_request(vcpu, ACRN_REQUEST_EPT_FLUSH);
-	}
+	ept_flush(vm);
+	ept_free_merged(vm);
 
 	return ret;
 }
 
-int ept_mr_modify(const struct vm *vm, uint64_t *pml4_page,
+int ept_mr_modify(struct vm *vm, uint64_t *pml4_page,
 		uint64_t gpa, uint64_t size,
 		uint64_t prot_set, uint64_t prot_clr)
 {
-	struct vcpu *vcpu;
-	uint16_t i;
 	int ret;
 
 	ret = mmu_modify_or_del(pml4_page, gpa, size,
 			prot_set, prot_clr, PTT_EPT, MR_MODIFY);
 
-	foreach_vcpu(i, vm, vcpu) {
-		vcpu_make_request(vcpu, ACRN_REQUEST_EPT_FLUSH);
-	}
+	ept_flush(vm);
+	ept_free_merged(vm);
 
 	return ret;
 }
 
-int ept_mr_del(const struct vm *vm, uint64_t *pml4_page,
+int ept_mr_del(struct vm *vm, uint64_t *pml4_page,
 		uint64_t gpa, uint64_t size)
 {
-	struct vcpu *vcpu;
-	uint16_t i;
 	int ret;
 	uint64_t hpa = gpa2hpa(vm, gpa);
 
@@ -289,9 +483,8 @@ int ept_mr_del(const struct vm *vm, uint64_t *pml4_page,
 				hpa, size, 0UL, 0UL, PTT_EPT, MR_DEL);
 	}
 
-	foreach_vcpu(i, vm, vcpu) {
-		vcpu_make_request(vcpu, ACRN_REQUEST_EPT_FLUSH);
-	}
+	ept_flush(vm);
+	ept_free_merged(vm);
 
 	return ret;
 }
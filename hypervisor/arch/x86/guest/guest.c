@@ -27,8 +27,14 @@ struct page_walk_info {
 				 * true for PAE/4-level paing */
 	bool wp;		/* CR0.WP */
 	bool nxe;		/* MSR_IA32_EFER_NXE_BIT */
+	uint32_t rights;	/* PW_RIGHTS_* of the entries walked */
 };
 
+/* Access rights combined over the levels of a page walk */
+#define PW_RIGHTS_WRITE		(1U << 0U)
+#define PW_RIGHTS_USER		(1U << 1U)
+#define PW_RIGHTS_NX		(1U << 2U)
+
 uint64_t vcpumask2pcpumask(struct vm *vm, uint64_t vdmask)
 {
 	uint16_t vcpu_id;
@@ -82,6 +88,31 @@ enum vm_paging_mode get_vcpu_paging_mode(struct vcpu *vcpu)
 	}
 }
 
+static bool is_pw_fault(const struct page_walk_info *pw_info)
+{
+	/* check for R/W
+	 * Case1: Supermode and wp is 1
+	 * Case2: Usermode
+	 */
+	if (pw_info->is_write_access &&
+		((pw_info->rights & PW_RIGHTS_WRITE) == 0U) &&
+		(pw_info->is_user_mode || pw_info->wp)) {
+		return true;
+	}
+
+	/* check for nx, since for 32-bit paing, the XD bit is
+	 * reserved(0), use the same logic as PAE/4-level paging
+	 */
+	if (pw_info->is_inst_fetch && pw_info->nxe &&
+		((pw_info->rights & PW_RIGHTS_NX) != 0U)) {
+		return true;
+	}
+
+	/* check for U/S */
+	return (pw_info->is_user_mode &&
+		((pw_info->rights & PW_RIGHTS_USER) == 0U));
+}
+
 /* TODO: Add code to check for Revserved bits, SMAP and PKE when do translation
  * during page walk */
 static int local_gva2gpa_common(struct vcpu *vcpu, struct page_walk_info *pw_info,
@@ -94,12 +125,13 @@ static int local_gva2gpa_common(struct vcpu *vcpu, struct page_walk_info *pw_inf
 	uint64_t entry;
 	uint64_t addr, page_size;
 	int ret = 0;
-	int fault = 0;
 
 	if (pw_info->level < 1U) {
 		return -EINVAL;
 	}
 
+	pw_info->rights = PW_RIGHTS_WRITE | PW_RIGHTS_USER;
+
 	addr = pw_info->top_entry;
 	i = pw_info->level;
 	while (i != 0U) {
@@ -130,24 +162,14 @@ static int local_gva2gpa_common(struct vcpu *vcpu, struct page_walk_info *pw_inf
 			ret = -EFAULT;
 			goto out;
 		}
-		/* check for R/W */
-		if (pw_info->is_write_access && ((entry & PAGE_RW) == 0U)) {
-			/* Case1: Supermode and wp is 1
-			 * Case2: Usermode */
-			if (pw_info->is_user_mode || pw_info->wp) {
-				fault = 1;
-			}
+		if ((entry & PAGE_RW) == 0U) {
+			pw_info->rights &= ~PW_RIGHTS_WRITE;
 		}
-		/* check for nx, since for 32-bit paing, the XD bit is
-		 * reserved(0), use the same logic as PAE/4-level paging */
-		if (pw_info->is_inst_fetch && pw_info->nxe &&
-		    ((entry & PAGE_NX) != 0U)) {
-			fault = 1;
+		if ((entry & PAGE_NX) != 0U) {
+			pw_info->rights |= PW_RIGHTS_NX;
 		}
-
-		/* check for U/S */
-		if (((entry & PAGE_USER) == 0U) && pw_info->is_user_mode) {
-			fault = 1;
+		if ((entry & PAGE_USER) == 0U) {
+			pw_info->rights &= ~PW_RIGHTS_USER;
 		}
 
 		if (pw_info->pse && ((i > 0U) && ((entry & PAGE_PSE) != 0U))) {
@@ -163,7 +185,7 @@ static int local_gva2gpa_common(struct vcpu *vcpu, struct page_walk_info *pw_inf
 	*gpa = entry | (gva & (page_size - 1UL));
 out:
 
-	if (fault != 0) {
+	if (is_pw_fault(pw_info)) {
 		ret = -EFAULT;
 		*err_code |= PAGE_FAULT_P_FLAG;
 	}
@@ -202,37 +224,57 @@ out:
 	return ret;
 }
 
-/* Refer to SDM Vol.3A 6-39 section 6.15 for the format of paging fault error
- * code.
- *
- * Caller should set the contect of err_code properly according to the address
- * usage when calling this function:
- * - If it is an address for write, set PAGE_FAULT_WR_FLAG in err_code.
- * - If it is an address for instruction featch, set PAGE_FAULT_ID_FLAG in
- *   err_code.
- * Caller should check the return value to confirm if the function success or
- * not.
- * If a protection volation detected during page walk, this function still will
- * give the gpa translated, it is up to caller to decide if it need to inject a
- * #PF or not.
- * - Return 0 for success.
- * - Return -EINVAL for invalid parameter.
- * - Return -EFAULT for paging fault, and refer to err_code for paging fault
- *   error code.
- */
-int gva2gpa(struct vcpu *vcpu, uint64_t gva, uint64_t *gpa,
-	uint32_t *err_code)
+static struct guest_tlb_entry *gtlb_entry(struct vcpu *vcpu, uint64_t gva)
+{
+	uint64_t idx = (gva >> CPU_PAGE_SHIFT) & (GUEST_TLB_ENTRIES - 1U);
+
+	return &vcpu->arch_vcpu.gtlb[idx];
+}
+
+static struct guest_tlb_entry *gtlb_lookup(struct vcpu *vcpu, uint64_t cr3,
+	uint64_t gva)
+{
+	struct guest_tlb_entry *entry = gtlb_entry(vcpu, gva);
+
+	if ((entry->gen == vcpu->arch_vcpu.gtlb_gen) &&
+		(entry->ept_gen == vcpu->vm->arch_vm.ept_gen) &&
+		(entry->cr3 == cr3) &&
+		(entry->gva_page == (gva & CPU_PAGE_MASK))) {
+		return entry;
+	}
+
+	return NULL;
+}
+
+static struct guest_tlb_entry *gtlb_fill(struct vcpu *vcpu, uint64_t cr3,
+	uint64_t gva, uint64_t gpa, uint32_t rights)
+{
+	struct guest_tlb_entry *entry = gtlb_entry(vcpu, gva);
+
+	entry->gen = vcpu->arch_vcpu.gtlb_gen;
+	entry->ept_gen = vcpu->vm->arch_vm.ept_gen;
+	entry->cr3 = cr3;
+	entry->gva_page = gva & CPU_PAGE_MASK;
+	entry->gpa_page = gpa & CPU_PAGE_MASK;
+	entry->hpa_page = 0UL;
+	entry->rights = rights;
+
+	return entry;
+}
+
+static int local_gva2gpa(struct vcpu *vcpu, uint64_t gva, uint64_t *gpa,
+	uint32_t *err_code, struct guest_tlb_entry **tlb)
 {
 	enum vm_paging_mode pm = get_vcpu_paging_mode(vcpu);
 	struct page_walk_info pw_info;
+	struct guest_tlb_entry *entry = NULL;
+	uint64_t cr3;
 	int ret = 0;
 
-	if ((gpa == NULL) || (err_code == NULL)) {
-		return -EINVAL;
-	}
 	*gpa = 0UL;
 
-	pw_info.top_entry = exec_vmread(VMX_GUEST_CR3);
+	cr3 = exec_vmread(VMX_GUEST_CR3);
+	pw_info.top_entry = cr3;
 	pw_info.level = pm;
 	pw_info.is_write_access = ((*err_code & PAGE_FAULT_WR_FLAG) != 0U);
 	pw_info.is_inst_fetch = ((*err_code & PAGE_FAULT_ID_FLAG) != 0U);
@@ -252,6 +294,23 @@ int gva2gpa(struct vcpu *vcpu, uint64_t gva, uint64_t *gpa,
 
 	*err_code &=  ~PAGE_FAULT_P_FLAG;
 
+	/* The walks done during this VM exit are cached, so that the
+	 * instruction fetch and the operand accesses of an emulation walk
+	 * each page once.
+	 */
+	if (pm != PAGING_MODE_0_LEVEL) {
+		entry = gtlb_lookup(vcpu, cr3, gva);
+		if (entry != NULL) {
+			*gpa = entry->gpa_page | (gva & (~CPU_PAGE_MASK));
+			pw_info.rights = entry->rights;
+			if (is_pw_fault(&pw_info)) {
+				ret = -EFAULT;
+				*err_code |= PAGE_FAULT_P_FLAG;
+			}
+			goto out;
+		}
+	}
+
 	if (pm == PAGING_MODE_4_LEVEL) {
 		pw_info.width = 9U;
 		ret = local_gva2gpa_common(vcpu, &pw_info, gva, gpa, err_code);
@@ -267,15 +326,51 @@ int gva2gpa(struct vcpu *vcpu, uint64_t gva, uint64_t *gpa,
 		*gpa = gva;
 	}
 
+	if ((ret == 0) && (pm != PAGING_MODE_0_LEVEL)) {
+		entry = gtlb_fill(vcpu, cr3, gva, *gpa, pw_info.rights);
+	}
+
+out:
 	if (ret == -EFAULT) {
 		if (pw_info.is_user_mode) {
 			*err_code |= PAGE_FAULT_US_FLAG;
 		}
 	}
 
+	*tlb = entry;
 	return ret;
 }
 
+/* Refer to SDM Vol.3A 6-39 section 6.15 for the format of paging fault error
+ * code.
+ *
+ * Caller should set the contect of err_code properly according to the address
+ * usage when calling this function:
+ * - If it is an address for write, set PAGE_FAULT_WR_FLAG in err_code.
+ * - If it is an address for instruction featch, set PAGE_FAULT_ID_FLAG in
+ *   err_code.
+ * Caller should check the return value to confirm if the function success or
+ * not.
+ * If a protection volation detected during page walk, this function still will
+ * give the gpa translated, it is up to caller to decide if it need to inject a
+ * #PF or not.
+ * - Return 0 for success.
+ * - Return -EINVAL for invalid parameter.
+ * - Return -EFAULT for paging fault, and refer to err_code for paging fault
+ *   error code.
+ */
+int gva2gpa(struct vcpu *vcpu, uint64_t gva, uint64_t *gpa,
+	uint32_t *err_code)
+{
+	struct guest_tlb_entry *entry;
+
+	if ((gpa == NULL) || (err_code == NULL)) {
+		return -EINVAL;
+	}
+
+	return local_gva2gpa(vcpu, gva, gpa, err_code, &entry);
+}
+
 static inline uint32_t local_copy_gpa(const struct vm *vm, void *h_ptr, uint64_t gpa,
 	uint32_t size, uint32_t fix_pg_size, bool cp_from_vm)
 {
@@ -335,12 +430,44 @@ static inline int copy_gpa(const struct vm *vm, void *h_ptr_arg, uint64_t gpa_ar
 	return 0;
 }
 
+/* Copy within the 4K page of a cached translation, whose HPA is looked up
+ * on the first access
+ */
+static uint32_t gtlb_copy(struct vcpu *vcpu, struct guest_tlb_entry *entry,
+	void *h_ptr, uint64_t gva, uint32_t size, bool cp_from_vm)
+{
+	uint32_t offset_in_pg, len;
+	void *g_ptr;
+
+	if (entry->hpa_page == 0UL) {
+		entry->hpa_page = gpa2hpa(vcpu->vm, entry->gpa_page);
+		if (entry->hpa_page == 0UL) {
+			return 0U;
+		}
+	}
+
+	offset_in_pg = (uint32_t)gva & (CPU_PAGE_SIZE - 1U);
+	len = (size > (CPU_PAGE_SIZE - offset_in_pg)) ?
+		(CPU_PAGE_SIZE - offset_in_pg) : size;
+
+	g_ptr = HPA2HVA(entry->hpa_page + offset_in_pg);
+
+	if (cp_from_vm) {
+		(void)memcpy_s(h_ptr, len, g_ptr, len);
+	} else {
+		(void)memcpy_s(g_ptr, len, h_ptr, len);
+	}
+
+	return len;
+}
+
 static inline int copy_gva(struct vcpu *vcpu, void *h_ptr_arg, uint64_t gva_arg,
 	uint32_t size_arg, uint32_t *err_code, uint64_t *fault_addr,
 	bool cp_from_vm)
 {
 	void *h_ptr = h_ptr_arg;
 	uint64_t gpa = 0UL;
+	struct guest_tlb_entry *entry;
 	int32_t ret;
 	uint32_t len;
 	uint64_t gva = gva_arg;
@@ -356,7 +483,7 @@ static inline int copy_gva(struct vcpu *vcpu, void *h_ptr_arg, uint64_t gva_arg,
 	}
 
 	while (size > 0U) {
-		ret = gva2gpa(vcpu, gva, &gpa, err_code);
+		ret = local_gva2gpa(vcpu, gva, &gpa, err_code, &entry);
 		if (ret < 0) {
 			*fault_addr = gva;
 			pr_err("error[%d] in GVA2GPA, err_code=0x%x",
@@ -364,8 +491,13 @@ static inline int copy_gva(struct vcpu *vcpu, void *h_ptr_arg, uint64_t gva_arg,
 			return ret;
 		}
 
-		len = local_copy_gpa(vcpu->vm, h_ptr, gpa, size,
-			PAGE_SIZE_4K, cp_from_vm);
+		if (entry != NULL) {
+			len = gtlb_copy(vcpu, entry, h_ptr, gva, size,
+				cp_from_vm);
+		} else {
+			len = local_copy_gpa(vcpu->vm, h_ptr, gpa, size,
+				PAGE_SIZE_4K, cp_from_vm);
+		}
 
 		if (len == 0U) {
 			return -EINVAL;
@@ -571,6 +703,8 @@ int prepare_vm0_memmap_and_e820(struct vm *vm)
 		"vm0: bottom memory - 0x%llx, top memory - 0x%llx\n",
 		e820_mem.mem_bottom, e820_mem.mem_top);
 
+	ept_batch_begin(vm);
+
 	/* create real ept map for all ranges with UC */
 	ept_mr_add(vm, pml4_page,
 			e820_mem.mem_bottom, e820_mem.mem_bottom,
@@ -602,6 +736,8 @@ int prepare_vm0_memmap_and_e820(struct vm *vm)
 	 */
 	hv_hpa = get_hv_image_base();
 	ept_mr_del(vm, pml4_page, hv_hpa, CONFIG_RAM_SIZE);
+
+	ept_batch_end(vm);
 	return 0;
 }
 
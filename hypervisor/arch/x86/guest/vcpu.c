@@ -163,6 +163,192 @@ struct vcpu *get_ever_run_vcpu(uint16_t pcpu_id)
 	return per_cpu(ever_run_vcpu, pcpu_id);
 }
 
+/* Size of the XSAVE area for all the components the CPU supports */
+static uint32_t get_xsave_area_size(void)
+{
+	uint32_t eax, ebx, ecx, edx;
+
+	if (!cpu_has_cap(X86_FEATURE_OSXSAVE)) {
+		return VMX_CPU_S_FXSAVE_GUEST_AREA_SIZE;
+	}
+
+	cpuid_subleaf(CPUID_XSAVE_FEATURES, 0U, &eax, &ebx, &ecx, &edx);
+	return ecx;
+}
+
+/* Mask of all the state components the CPU supports in XCR0 */
+static uint64_t get_xsave_mask(void)
+{
+	uint32_t eax, ebx, ecx, edx;
+
+	cpuid_subleaf(CPUID_XSAVE_FEATURES, 0U, &eax, &ebx, &ecx, &edx);
+	return ((uint64_t)edx << 32U) | (uint64_t)eax;
+}
+
+/*
+ * FXSAVE/XSAVE image of the power-up state: FCW and MXCSR at their reset
+ * values and an XSAVE header with no component, which XRSTOR sets to their
+ * initial state.
+ */
+struct initial_fpu_image {
+	uint16_t fcw;
+	uint8_t reserved0[22];
+	uint32_t mxcsr;
+	uint8_t reserved1[548];
+} __aligned(64);
+
+static const struct initial_fpu_image initial_fpu = {
+	.fcw = 0x37fU,
+	.mxcsr = 0x1f80U,
+};
+
+/* XCR0 after power-up or reset: x87 state only */
+#define XCR0_INIT	1UL
+
+/*
+ * Save the guest state which the VMCS does not switch, before another
+ * vcpu runs on this pcpu. The hypervisor never touches the FPU/SSE
+ * registers or these MSRs, so they still hold the guest values.
+ */
+static void save_switch_context(struct vcpu *vcpu)
+{
+	struct switch_context *ctx = &vcpu->arch_vcpu.switch_ctx;
+	uint64_t mask;
+
+	ctx->ia32_star = msr_read(MSR_IA32_STAR);
+	ctx->ia32_lstar = msr_read(MSR_IA32_LSTAR);
+	ctx->ia32_fmask = msr_read(MSR_IA32_FMASK);
+	ctx->ia32_kernel_gs_base = msr_read(MSR_IA32_KERNEL_GS_BASE);
+
+	if (cpu_has_cap(X86_FEATURE_OSXSAVE)) {
+		/* Save all components, whatever the guest XCR0 enables */
+		mask = get_xsave_mask();
+		ctx->xcr0 = read_xcr(0);
+		write_xcr(0, mask);
+		asm volatile ("xsave (%0)"
+				: : "r" (ctx->xsave_area), "a" ((uint32_t)mask),
+				"d" ((uint32_t)(mask >> 32U)) : "memory");
+		write_xcr(0, ctx->xcr0);
+	} else {
+		asm volatile ("fxsave (%0)"
+				: : "r" (ctx->xsave_area) : "memory");
+	}
+
+	ctx->saved = true;
+}
+
+/*
+ * Make the vcpu the one whose VMCS and guest state are loaded on its
+ * pcpu. Nothing is done if it was the last vcpu running there. Otherwise
+ * the state of that last vcpu is saved first: it is only saved once
+ * another vcpu needs the pcpu, not each time it is switched out.
+ */
+void load_switch_context(struct vcpu *vcpu)
+{
+	struct switch_context *ctx = &vcpu->arch_vcpu.switch_ctx;
+	struct vcpu *prev;
+	const void *area;
+	uint64_t vmcs_pa, mask, xcr0, rflags;
+
+	vlapic_set_posted_intr_vector(vcpu->arch_vcpu.vlapic,
+			VECTOR_POSTED_INTR);
+	/* A notification sent while switched out may have hit another vcpu */
+	if (vlapic_has_posted_intr(vcpu->arch_vcpu.vlapic)) {
+		vcpu_make_request(vcpu, ACRN_REQUEST_EVENT);
+	}
+
+	/* unload_vcpu() may not run while the state changes hands */
+	CPU_INT_ALL_DISABLE(&rflags);
+
+	prev = per_cpu(ever_run_vcpu, vcpu->pcpu_id);
+	if (prev == vcpu) {
+		CPU_INT_ALL_RESTORE(rflags);
+		return;
+	}
+
+	if (prev != NULL) {
+		save_switch_context(prev);
+	}
+
+	/* A vcpu not launched yet gets its VMCS loaded by init_vmcs() */
+	if (vcpu->launched) {
+		vmcs_pa = HVA2HPA(vcpu->arch_vcpu.vmcs);
+		(void)exec_vmptrld((void *)&vmcs_pa);
+
+		/* avoid VMCS recycling RSB usage, set IBPB */
+		if (ibrs_type == IBRS_RAW) {
+			msr_write(MSR_IA32_PRED_CMD, PRED_SET_IBPB);
+		}
+	}
+	per_cpu(ever_run_vcpu, vcpu->pcpu_id) = vcpu;
+
+	if (ctx->saved) {
+		msr_write(MSR_IA32_STAR, ctx->ia32_star);
+		msr_write(MSR_IA32_LSTAR, ctx->ia32_lstar);
+		msr_write(MSR_IA32_FMASK, ctx->ia32_fmask);
+		msr_write(MSR_IA32_KERNEL_GS_BASE, ctx->ia32_kernel_gs_base);
+		area = ctx->xsave_area;
+		xcr0 = ctx->xcr0;
+	} else {
+		/* A vcpu starting from power-up or reset gets the reset
+		 * state, not the one of the last vcpu of the pcpu.
+		 */
+		msr_write(MSR_IA32_STAR, 0UL);
+		msr_write(MSR_IA32_LSTAR, 0UL);
+		msr_write(MSR_IA32_FMASK, 0UL);
+		msr_write(MSR_IA32_KERNEL_GS_BASE, 0UL);
+		area = &initial_fpu;
+		xcr0 = XCR0_INIT;
+	}
+
+	if (cpu_has_cap(X86_FEATURE_OSXSAVE)) {
+		mask = get_xsave_mask();
+		write_xcr(0, mask);
+		asm volatile ("xrstor (%0)"
+				: : "r" (area), "a" ((uint32_t)mask),
+				"d" ((uint32_t)(mask >> 32U)) : "memory");
+		write_xcr(0, xcr0);
+	} else {
+		asm volatile ("fxrstor (%0)" : : "r" (area));
+	}
+
+	CPU_INT_ALL_RESTORE(rflags);
+}
+
+static void unload_vcpu_on_pcpu(void *data)
+{
+	struct vcpu *vcpu = (struct vcpu *)data;
+	uint64_t vmcs_pa = HVA2HPA(vcpu->arch_vcpu.vmcs);
+
+	/* Write the VMCS back to memory and make it inactive */
+	(void)exec_vmclear((void *)&vmcs_pa);
+	if (per_cpu(ever_run_vcpu, vcpu->pcpu_id) == vcpu) {
+		per_cpu(ever_run_vcpu, vcpu->pcpu_id) = NULL;
+	}
+}
+
+/*
+ * VMCLEAR the VMCS of a paused vcpu on its pcpu, where it may still be
+ * active, and make the pcpu forget the vcpu state it holds. The VMCS can
+ * then be reset or freed, and the vcpu state is fully reloaded the next
+ * time the vcpu runs.
+ */
+static void unload_vcpu(struct vcpu *vcpu)
+{
+	uint16_t pcpu_id = vcpu->pcpu_id;
+
+	if (pcpu_id == get_cpu_id()) {
+		unload_vcpu_on_pcpu(vcpu);
+	} else if (bitmap_test(pcpu_id, &pcpu_active_bitmap)) {
+		smp_call_function(1UL << pcpu_id, unload_vcpu_on_pcpu, vcpu);
+	} else {
+		/* VMX is off on an offline pcpu */
+		if (per_cpu(ever_run_vcpu, pcpu_id) == vcpu) {
+			per_cpu(ever_run_vcpu, pcpu_id) = NULL;
+		}
+	}
+}
+
 /***********************************************************************
  *  vcpu_id/pcpu_id mapping table:
  *
@@ -190,7 +376,6 @@ int create_vcpu(uint16_t pcpu_id, struct vm *vm, struct vcpu **rtn_vcpu_handle)
 
 	/* Initialize the physical CPU ID for this VCPU */
 	vcpu->pcpu_id = pcpu_id;
-	per_cpu(ever_run_vcpu, pcpu_id) = vcpu;
 
 	/* Initialize the parent VM reference */
 	vcpu->vm = vm;
@@ -216,7 +401,10 @@ int create_vcpu(uint16_t pcpu_id, struct vm *vm, struct vcpu **rtn_vcpu_handle)
 	ASSERT(vcpu->vcpu_id < vm->hw.num_vcpus,
 			"Allocated vcpu_id is out of range!");
 
-	per_cpu(vcpu, pcpu_id) = vcpu;
+	/* Updated by the scheduler when other vcpus share the pcpu */
+	if (per_cpu(vcpu, pcpu_id) == NULL) {
+		per_cpu(vcpu, pcpu_id) = vcpu;
+	}
 
 	pr_info("PCPU%d is working as VM%d VCPU%d, Role: %s",
 			vcpu->pcpu_id, vcpu->vm->vm_id, vcpu->vcpu_id,
@@ -231,6 +419,14 @@ int create_vcpu(uint16_t pcpu_id, struct vm *vm, struct vcpu **rtn_vcpu_handle)
 	/* Memset VMCS region for this VCPU */
 	(void)memset(vcpu->arch_vcpu.vmcs, 0U, CPU_PAGE_SIZE);
 
+	/* Allocate the area saving the FPU/SSE/AVX state when switched out */
+	vcpu->arch_vcpu.switch_ctx.xsave_area = alloc_pages(
+		INT_DIV_ROUNDUP(get_xsave_area_size(), CPU_PAGE_SIZE));
+	ASSERT(vcpu->arch_vcpu.switch_ctx.xsave_area != NULL, "");
+	(void)memset(vcpu->arch_vcpu.switch_ctx.xsave_area, 0U,
+		INT_DIV_ROUNDUP(get_xsave_area_size(), CPU_PAGE_SIZE) *
+		CPU_PAGE_SIZE);
+
 	/* Initialize exception field in VCPU context */
 	vcpu->arch_vcpu.exception_info.exception = VECTOR_INVALID;
 
@@ -253,6 +449,11 @@ int create_vcpu(uint16_t pcpu_id, struct vm *vm, struct vcpu **rtn_vcpu_handle)
 	vcpu->arch_vcpu.nr_sipi = 0;
 	vcpu->pending_pre_work = 0U;
 	vcpu->state = VCPU_INIT;
+	vcpu->halted = 0U;
+	/* entries of generation 0 are never valid */
+	vcpu->arch_vcpu.gtlb_gen = 1UL;
+	set_vcpu_sched_policy(vcpu, (vm->sched_prio != 0U) ?
+		&sched_rt_policy : &sched_fair_policy, vm->sched_prio);
 
 	(void)memset(&vcpu->req, 0U, sizeof(struct io_request));
 
@@ -310,8 +511,8 @@ int start_vcpu(struct vcpu *vcpu)
 		vcpu->launched = true;
 
 		/* avoid VMCS recycling RSB usage, set IBPB.
-		 * NOTE: this should be done for any time vmcs got switch
-		 * currently, there is no other place to do vmcs switch
+		 * NOTE: this should be done for any time vmcs got switch,
+		 * see also load_switch_context().
 		 * Please add IBPB set for future vmcs switch case(like trusty)
 		 */
 		if (ibrs_type == IBRS_RAW)
@@ -383,9 +584,13 @@ void destroy_vcpu(struct vcpu *vcpu)
 
 	atomic_dec16(&vcpu->vm->hw.created_vcpus);
 
+	unload_vcpu(vcpu);
 	vlapic_free(vcpu);
 	free(vcpu->arch_vcpu.vmcs);
-	per_cpu(ever_run_vcpu, vcpu->pcpu_id) = NULL;
+	free(vcpu->arch_vcpu.switch_ctx.xsave_area);
+	if (per_cpu(vcpu, vcpu->pcpu_id) == vcpu) {
+		per_cpu(vcpu, vcpu->pcpu_id) = NULL;
+	}
 	free_pcpu(vcpu->pcpu_id);
 	free(vcpu);
 }
@@ -407,11 +612,18 @@ void reset_vcpu(struct vcpu *vcpu)
 
 	vcpu->state = VCPU_INIT;
 
+	/* The VMCS is cleared below, and the vcpu restarts from the reset
+	 * state instead of the one its pcpu holds.
+	 */
+	unload_vcpu(vcpu);
+
 	vcpu->launched = false;
 	vcpu->paused_cnt = 0U;
 	vcpu->running = 0;
 	vcpu->arch_vcpu.nr_sipi = 0;
 	vcpu->pending_pre_work = 0U;
+	vcpu->halted = 0U;
+	vcpu->arch_vcpu.switch_ctx.saved = false;
 
 	vcpu->arch_vcpu.exception_info.exception = VECTOR_INVALID;
 	vcpu->arch_vcpu.cur_context = NORMAL_WORLD;
@@ -462,7 +674,9 @@ void resume_vcpu(struct vcpu *vcpu)
 	get_schedule_lock(vcpu->pcpu_id);
 	vcpu->state = vcpu->prev_state;
 
-	if (vcpu->state == VCPU_RUNNING) {
+	/* A halted vcpu stays off the runqueue until wake_halted_vcpu() */
+	if ((vcpu->state == VCPU_RUNNING) &&
+			(atomic_load32(&vcpu->halted) == 0U)) {
 		add_vcpu_to_runqueue(vcpu);
 		make_reschedule_request(vcpu);
 	}
@@ -480,6 +694,46 @@ void schedule_vcpu(struct vcpu *vcpu)
 	release_schedule_lock(vcpu->pcpu_id);
 }
 
+static bool vcpu_has_pending_event(struct vcpu *vcpu)
+{
+	return ((atomic_load64(&vcpu->arch_vcpu.pending_req) != 0UL) ||
+		(vlapic_pending_intr(vcpu->arch_vcpu.vlapic, NULL) != 0) ||
+		vlapic_has_pending_delivery_intr(vcpu));
+}
+
+/*
+ * Called on a HLT VM exit, on the pcpu of the vcpu: leave the pcpu to
+ * other vcpus until vcpu_make_request() signals a new event.
+ */
+void halt_vcpu(struct vcpu *vcpu)
+{
+	remove_vcpu_from_runqueue(vcpu);
+	atomic_store32(&vcpu->halted, 1U);
+
+	/* Pairs with the pending_req update in vcpu_make_request() */
+	CPU_MEMORY_BARRIER();
+
+	if (vcpu_has_pending_event(vcpu)) {
+		wake_halted_vcpu(vcpu);
+	} else {
+		make_reschedule_request(vcpu);
+	}
+}
+
+/* Put a vcpu stopped by halt_vcpu() back on the runqueue */
+void wake_halted_vcpu(struct vcpu *vcpu)
+{
+	if (atomic_cmpxchg32(&vcpu->halted, 1U, 0U) == 1U) {
+		get_schedule_lock(vcpu->pcpu_id);
+		/* A paused vcpu gets back on the runqueue when resumed */
+		if (vcpu->state == VCPU_RUNNING) {
+			add_vcpu_to_runqueue(vcpu);
+			make_reschedule_request(vcpu);
+		}
+		release_schedule_lock(vcpu->pcpu_id);
+	}
+}
+
 /* help function for vcpu create */
 int prepare_vcpu(struct vm *vm, uint16_t pcpu_id)
 {
@@ -528,8 +782,6 @@ int prepare_vcpu(struct vm *vm, uint16_t pcpu_id)
 	/* initialize the vcpu tsc aux */
 	vcpu->msr_tsc_aux_guest = vcpu->vcpu_id;
 
-	set_pcpu_used(pcpu_id);
-
 	INIT_LIST_HEAD(&vcpu->run_list);
 
 	return ret;
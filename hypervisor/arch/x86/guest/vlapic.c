@@ -415,7 +415,7 @@ static uint64_t vlapic_get_tsc_deadline_msr(struct acrn_vlapic *vlapic)
 
 }
 
-static void vlapic_set_tsc_deadline_msr(struct acrn_vlapic *vlapic,
+void vlapic_set_tsc_deadline_msr(struct acrn_vlapic *vlapic,
 			uint64_t val_arg)
 {
 	struct hv_timer *timer;
@@ -1559,6 +1559,17 @@ vlapic_reset(struct acrn_vlapic *vlapic)
 	(void)memset((void *)lapic, 0U, CPU_PAGE_SIZE);
 	(void)memset((void *)&(vlapic->pir_desc), 0U, sizeof(vlapic->pir_desc));
 
+	/* Notify the pcpu this vcpu runs on, with the wakeup vector until
+	 * it is switched in
+	 */
+	vlapic->pir_desc.pending =
+		((uint64_t)VECTOR_POSTED_INTR_WAKEUP << POSTED_INTR_NV_SHIFT) |
+		((uint64_t)per_cpu(lapic_id, vlapic->vcpu->pcpu_id) <<
+			POSTED_INTR_NDST_SHIFT);
+	if (atomic_load32(&vlapic->vcpu->running) == 1U) {
+		vlapic_set_posted_intr_vector(vlapic, VECTOR_POSTED_INTR);
+	}
+
 	lapic->id = vlapic_build_id(vlapic);
 	lapic->version = VLAPIC_VERSION;
 	lapic->version |= (VLAPIC_MAXLVT_INDEX << MAXLVTSHIFT);
@@ -2019,7 +2030,8 @@ apicv_set_intr_ready(struct acrn_vlapic *vlapic, uint32_t vector,
 	mask = 1UL << (vector & 0x3fU);
 
 	atomic_set64(&pir_desc->pir[idx], mask);
-	notify = (atomic_cmpxchg64(&pir_desc->pending, 0UL, 1UL) == 0UL) ? 1 : 0;
+	notify = bitmap_test_and_set_lock(POSTED_INTR_ON,
+			&pir_desc->pending) ? 0 : 1;
 	return notify;
 }
 
@@ -2034,7 +2046,7 @@ apicv_pending_intr(struct acrn_vlapic *vlapic, __unused uint32_t *vecptr)
 	pir_desc = &(vlapic->pir_desc);
 
 	pending = atomic_load64(&pir_desc->pending);
-	if (pending == 0U) {
+	if ((pending & (1UL << POSTED_INTR_ON)) == 0UL) {
 		return 0;
 	}
 
@@ -2108,6 +2120,57 @@ vlapic_apicv_get_apic_page_addr(struct acrn_vlapic *vlapic)
 	return HVA2HPA(&(vlapic->apic_page));
 }
 
+/**
+ *APIC-v: Get the HPA to the posted-interrupt descriptor
+ * **/
+uint64_t
+vlapic_apicv_get_pir_desc_addr(struct acrn_vlapic *vlapic)
+{
+	return HVA2HPA(&(vlapic->pir_desc));
+}
+
+/*
+ * Select the vector the CPU or remapping hardware notifies with: the
+ * posted-interrupt vector is consumed by the CPU while this vcpu is in
+ * non-root mode, the wakeup vector reaches the hypervisor otherwise.
+ */
+void
+vlapic_set_posted_intr_vector(struct acrn_vlapic *vlapic, uint32_t vector)
+{
+	uint64_t *pending = &(vlapic->pir_desc.pending);
+	uint64_t old, new;
+
+	do {
+		old = atomic_load64(pending);
+		new = (old & ~POSTED_INTR_NV_MASK) |
+			((uint64_t)vector << POSTED_INTR_NV_SHIFT);
+	} while (atomic_cmpxchg64(pending, old, new) != old);
+}
+
+bool
+vlapic_has_posted_intr(struct acrn_vlapic *vlapic)
+{
+	return bitmap_test(POSTED_INTR_ON, &(vlapic->pir_desc.pending));
+}
+
+/*
+ * Whether the virtual interrupt delivery of the vcpu holds an interrupt
+ * in RVI which its PPR lets the guest take.
+ */
+bool
+vlapic_has_pending_delivery_intr(struct vcpu *vcpu)
+{
+	struct acrn_vlapic *vlapic = vcpu->arch_vcpu.vlapic;
+	uint32_t rvi;
+
+	if (!is_apicv_intr_delivery_supported()) {
+		return false;
+	}
+
+	rvi = (uint32_t)exec_vmread16(VMX_GUEST_INTR_STATUS) & 0xFFU;
+	return (PRIO(rvi) > PRIO(vlapic->apic_page.ppr));
+}
+
 /*
  * Transfer the pending interrupts in the PIR descriptor to the IRR
  * in the virtual APIC page.
@@ -2124,7 +2187,7 @@ vlapic_apicv_inject_pir(struct acrn_vlapic *vlapic)
 	struct lapic_reg *irr = NULL;
 
 	pir_desc = &(vlapic->pir_desc);
-	if (atomic_cmpxchg64(&pir_desc->pending, 1UL, 0UL) != 1UL) {
+	if (!bitmap_test_and_clear_lock(POSTED_INTR_ON, &pir_desc->pending)) {
 		return;
 	}
 
@@ -2252,6 +2315,71 @@ int veoi_vmexit_handler(struct vcpu *vcpu)
 	return 0;
 }
 
+/*
+ * Deliver an edge interrupt to a vcpu running on another pcpu with a
+ * posted-interrupt notification, which the CPU consumes in non-root mode
+ * without VM exit. Arriving in root mode, the notification is handed
+ * over as an event by the posted interrupt softirq.
+ */
+static void vlapic_post_intr(struct vcpu *vcpu, uint32_t vector)
+{
+	if (vlapic_set_intr_ready(vcpu->arch_vcpu.vlapic, vector, false) == 0) {
+		return;
+	}
+
+	if (is_apicv_posted_intr_supported() &&
+			(vcpu->pcpu_id != get_cpu_id()) &&
+			(atomic_load32(&vcpu->running) == 1U)) {
+		send_single_ipi(vcpu->pcpu_id, VECTOR_POSTED_INTR);
+	} else {
+		vcpu_make_request(vcpu, ACRN_REQUEST_EVENT);
+	}
+}
+
+/*
+ * Fast path of an APIC-write VM exit, for the common fixed IPI to one
+ * physical destination. Returns false, leaving the register untouched,
+ * for any other write which takes apic_write_vmexit_handler().
+ */
+bool vlapic_apic_write_fast_path(struct acrn_vlapic *vlapic, uint32_t offset)
+{
+	struct lapic_regs *lapic = &(vlapic->apic_page);
+	struct vcpu *target_vcpu;
+	uint32_t icr_low, vec;
+	uint64_t dmask = 0UL;
+	uint16_t vcpu_id;
+
+	if (offset != APIC_OFFSET_ICR_LOW) {
+		return false;
+	}
+
+	icr_low = lapic->icr_lo;
+	vec = icr_low & APIC_VECTOR_MASK;
+	if (((icr_low & (APIC_DEST_MASK | APIC_DELMODE_MASK |
+			APIC_DESTMODE_LOG)) != (APIC_DEST_DESTFLD |
+			APIC_DELMODE_FIXED | APIC_DESTMODE_PHY)) ||
+			(vec < 16U)) {
+		return false;
+	}
+
+	vlapic_calcdest(vlapic->vm, &dmask, lapic->icr_hi >> APIC_ID_SHIFT,
+			true, false);
+	vcpu_id = ffs64(dmask);
+	if ((vcpu_id == INVALID_BIT_INDEX) || (dmask != (1UL << vcpu_id))) {
+		return false;
+	}
+
+	target_vcpu = vcpu_from_vid(vlapic->vm, vcpu_id);
+	if (target_vcpu == NULL) {
+		return false;
+	}
+
+	lapic->icr_lo &= ~APIC_DELSTAT_PEND;
+	vlapic_post_intr(target_vcpu, vec);
+
+	return true;
+}
+
 int apic_write_vmexit_handler(struct vcpu *vcpu)
 {
 	uint64_t qual;
@@ -90,6 +90,16 @@
 
 struct acrn_vlapic;
 
+/*
+ * Posted-interrupt descriptor, shared with the CPU and the remapping
+ * hardware. 'pending' holds the outstanding notification bit (ON), the
+ * notification vector (NV) and the xAPIC ID of the notified pcpu (NDST).
+ */
+#define POSTED_INTR_ON		0U
+#define POSTED_INTR_NV_SHIFT	16U
+#define POSTED_INTR_NV_MASK	(0xFFUL << POSTED_INTR_NV_SHIFT)
+#define POSTED_INTR_NDST_SHIFT	40U
+
 struct vlapic_pir_desc {
 	uint64_t pir[4];
 	uint64_t pending;
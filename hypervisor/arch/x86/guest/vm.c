@@ -20,9 +20,16 @@ struct list_head vm_list = {
 /* Lock for VMs list */
 spinlock_t vm_list_lock = {
 	.head = 0U,
-	.tail = 0U
+	.tail = 0U,
+	SPINLOCK_NAME("vm_list_lock")
 };
 
+/*
+ * VMs indexed by vm_id, for lock-free lookup by get_vm_from_vmid(). A slot is
+ * published once the VM is created and cleared before the VM is freed.
+ */
+static struct vm *vm_array[MAX_VM_NUM];
+
 #ifndef CONFIG_PARTITION_MODE
 /* used for vmid allocation. And this means the max vm number is 64 */
 static uint64_t vmid_bitmap;
@@ -70,23 +77,70 @@ static void init_vm(struct vm_description *vm_desc,
 
 /* return a pointer to the virtual machine structure associated with
  * this VM ID
+ *
+ * No lock is taken. The returned VM stays valid until the caller's pcpu
+ * passes its next quiescent state, which is a VM entry or an iteration of
+ * the idle loop. A pcpu holds no VM pointer while it runs in guest mode.
  */
 struct vm *get_vm_from_vmid(uint16_t vm_id)
 {
-	struct vm *vm = NULL;
-	struct list_head *pos;
+	if (vm_id >= MAX_VM_NUM) {
+		return NULL;
+	}
 
-	spinlock_obtain(&vm_list_lock);
-	list_for_each(pos, &vm_list) {
-		vm = list_entry(pos, struct vm, list);
-		if (vm->vm_id == vm_id) {
-			spinlock_release(&vm_list_lock);
-			return vm;
+	/* pairs with the store in publish_vm()/unpublish_vm() */
+	return (struct vm *)atomic_load64((uint64_t *)&vm_array[vm_id]);
+}
+
+static void publish_vm(struct vm *vm)
+{
+	/* the VM is fully initialized before being visible to lookups */
+	atomic_store64((uint64_t *)&vm_array[vm->vm_id], (uint64_t)vm);
+}
+
+/*
+ * Remove the VM from the lookup table, then wait until every other active
+ * pcpu has passed a quiescent state, so that no pcpu still uses the VM
+ * pointer once this function returns. A pcpu in guest mode, where its
+ * vm_qs_seq is odd, is quiescent already. A pcpu sleeping in the idle loop
+ * is kicked once, as it only passes a quiescent state after waking up.
+ */
+static void unpublish_vm(struct vm *vm)
+{
+	uint16_t pcpu_id;
+	uint16_t self = get_cpu_id();
+	uint64_t seq;
+	uint32_t idle_state;
+	bool kicked;
+
+	atomic_store64((uint64_t *)&vm_array[vm->vm_id], 0UL);
+	/* pairs with the barrier after the vm_qs_seq bumps */
+	CPU_MEMORY_BARRIER();
+
+	for (pcpu_id = 0U; pcpu_id < phys_cpu_num; pcpu_id++) {
+		if ((pcpu_id == self) ||
+			!bitmap_test(pcpu_id, &pcpu_active_bitmap)) {
+			continue;
 		}
-	}
-	spinlock_release(&vm_list_lock);
 
-	return NULL;
+		seq = atomic_load64(&per_cpu(vm_qs_seq, pcpu_id));
+		if ((seq & 1UL) != 0UL) {
+			continue;
+		}
+
+		kicked = false;
+		while ((atomic_load64(&per_cpu(vm_qs_seq, pcpu_id)) == seq) &&
+			bitmap_test(pcpu_id, &pcpu_active_bitmap)) {
+			idle_state =
+				atomic_load32(&per_cpu(idle, pcpu_id).state);
+			if (!kicked && ((idle_state == IDLE_STATE_MWAIT) ||
+					(idle_state == IDLE_STATE_HLT))) {
+				send_single_ipi(pcpu_id, VECTOR_NOTIFY_VCPU);
+				kicked = true;
+			}
+			asm volatile ("pause" ::: "memory");
+		}
+	}
 }
 
 int create_vm(struct vm_description *vm_desc, struct vm **rtn_vm)
@@ -111,9 +165,6 @@ int create_vm(struct vm_description *vm_desc, struct vm **rtn_vm)
 	 */
 	init_vm(vm_desc, vm);
 
-	/* Init mmio list */
-	INIT_LIST_HEAD(&vm->mmio_list);
-
 	if (vm->hw.num_vcpus == 0U) {
 		vm->hw.num_vcpus = phys_cpu_num;
 	}
@@ -128,6 +179,11 @@ int create_vm(struct vm_description *vm_desc, struct vm **rtn_vm)
 
 #ifdef CONFIG_PARTITION_MODE
 	vm->vm_id = vm_desc->vm_id;
+	if (vm->vm_id >= MAX_VM_NUM) {
+		pr_err("%s, vm id %hu is out of range\n", __func__, vm->vm_id);
+		status = -EINVAL;
+		goto err;
+	}
 #else
 	vm->vm_id = alloc_vm_id();
 	if (vm->vm_id == INVALID_VM_ID) {
@@ -139,6 +195,9 @@ int create_vm(struct vm_description *vm_desc, struct vm **rtn_vm)
 
 	atomic_store16(&vm->hw.created_vcpus, 0U);
 
+	spinlock_init(&vm->posted_io.lock);
+	spinlock_init(&vm->doorbells.lock);
+
 	/* gpa_lowtop are used for system start up */
 	vm->hw.gpa_lowtop = 0UL;
 
@@ -169,6 +228,7 @@ int create_vm(struct vm_description *vm_desc, struct vm **rtn_vm)
 		/* populate UOS vm fields according to vm_desc */
 		vm->sworld_control.flag.supported =
 			vm_desc->sworld_supported;
+		vm->sched_prio = vm_desc->rt_sched ? SCHED_RT_PRIO_DEFAULT : 0U;
 		(void)memcpy_s(&vm->GUID[0], sizeof(vm->GUID),
 					&vm_desc->GUID[0],
 					sizeof(vm_desc->GUID));
@@ -229,6 +289,8 @@ int create_vm(struct vm_description *vm_desc, struct vm **rtn_vm)
 
 	vm->state = VM_CREATED;
 
+	publish_vm(vm);
+
 	return 0;
 
 err:
@@ -268,17 +330,22 @@ int shutdown_vm(struct vm *vm)
 		return -EINVAL;
 	}
 
-	foreach_vcpu(i, vm, vcpu) {
-		reset_vcpu(vcpu);
-		destroy_vcpu(vcpu);
-	}
-
 	spinlock_obtain(&vm_list_lock);
 	list_del_init(&vm->list);
 	spinlock_release(&vm_list_lock);
 
+	unpublish_vm(vm);
+
+	/* No interrupt is posted to the vcpus any more once the remapping
+	 * entries are released, and lookups no longer find them.
+	 */
 	ptdev_release_all_entries(vm);
 
+	foreach_vcpu(i, vm, vcpu) {
+		reset_vcpu(vcpu);
+		destroy_vcpu(vcpu);
+	}
+
 	/* cleanup vioapic */
 	vioapic_cleanup(vm_ioapic(vm));
 
@@ -445,11 +512,14 @@ int prepare_vm(uint16_t pcpu_id)
 
 		mptable_build(vm);
 
+		set_pcpu_used(vm_desc->vm_pcpu_ids[0]);
 		prepare_vcpu(vm, vm_desc->vm_pcpu_ids[0]);
 
 		/* Prepare the AP for vm */
-		for (i = 1U; i < vm_desc->vm_hw_num_cores; i++)
+		for (i = 1U; i < vm_desc->vm_hw_num_cores; i++) {
+			set_pcpu_used(vm_desc->vm_pcpu_ids[i]);
 			prepare_vcpu(vm, vm_desc->vm_pcpu_ids[i]);
+		}
 
 		/* start vm BSP automatically */
 		start_vm(vm);
@@ -481,6 +551,7 @@ int prepare_vm0(void)
 
 	/* Allocate all cpus to vm0 at the beginning */
 	for (i = 0U; i < phys_cpu_num; i++) {
+		set_pcpu_used(i);
 		err = prepare_vcpu(vm, i);
 		if (err != 0) {
 			return err;
@@ -50,6 +50,10 @@ int vmcall_vmexit_handler(struct vcpu *vcpu)
 		ret = hcall_get_api_version(vm, param1);
 		break;
 
+	case HC_MULTICALL:
+		ret = hcall_multicall(vm, param1);
+		break;
+
 	case HC_CREATE_VM:
 		ret = hcall_create_vm(vm, param1);
 		break;
@@ -69,6 +73,11 @@ int vmcall_vmexit_handler(struct vcpu *vcpu)
 		ret = hcall_reset_vm((uint16_t)param1);
 		break;
 
+	case HC_GET_VCPU_EXIT_STATS:
+		/* param1: vmid */
+		ret = hcall_get_vcpu_exit_stats(vm, (uint16_t)param1, param2);
+		break;
+
 	case HC_PAUSE_VM:
 		/* param1: vmid */
 		ret = hcall_pause_vm((uint16_t)param1);
@@ -111,6 +120,26 @@ int vmcall_vmexit_handler(struct vcpu *vcpu)
 			(uint16_t)param2);
 		break;
 
+	case HC_SET_POSTED_RING:
+		/* param1: vmid */
+		ret = hcall_set_posted_ring(vm, (uint16_t)param1, param2);
+		break;
+
+	case HC_SET_POSTED_RANGE:
+		/* param1: vmid */
+		ret = hcall_set_posted_range(vm, (uint16_t)param1, param2);
+		break;
+
+	case HC_SET_DOORBELL_PAGE:
+		/* param1: vmid */
+		ret = hcall_set_doorbell_page(vm, (uint16_t)param1, param2);
+		break;
+
+	case HC_SET_DOORBELL:
+		/* param1: vmid */
+		ret = hcall_set_doorbell(vm, (uint16_t)param1, param2);
+		break;
+
 	case HC_VM_SET_MEMORY_REGION:
 		/* param1: vmid */
 		ret = hcall_set_vm_memory_region(vm, (uint16_t)param1, param2);
@@ -163,6 +192,10 @@ int vmcall_vmexit_handler(struct vcpu *vcpu)
 	case HC_SETUP_HV_NPK_LOG:
 		ret = hcall_setup_hv_npk_log(vm, param1);
 		break;
+
+	case HC_SETUP_TRACE_FILTER:
+		ret = hcall_setup_trace_filter(vm, param1);
+		break;
 #endif
 
 	case HC_WORLD_SWITCH:
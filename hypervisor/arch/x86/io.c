@@ -162,6 +162,45 @@ void emulate_io_post(struct vcpu *vcpu)
 	resume_vcpu(vcpu);
 }
 
+/**
+ * Find the port I/O handler whose range overlaps [port, port + size).
+ *
+ * The handler array of a VM is sorted by base port and the ranges never
+ * overlap, so the only candidate is the handler with the highest base which
+ * is not above the last accessed port.
+ *
+ * @return the overlapping handler, or NULL if no handler overlaps the access.
+ */
+static struct vm_io_handler *
+find_io_handler(struct vm *vm, uint16_t port, uint16_t size)
+{
+	struct vm_io_handler *handler;
+	uint32_t last = (uint32_t)port + size - 1U;
+	uint32_t lo = 0U, hi = vm->arch_vm.io_handler_num;
+	uint32_t mid;
+
+	/* Find the first handler whose base is above the last accessed port */
+	while (lo < hi) {
+		mid = lo + ((hi - lo) >> 1U);
+		if (vm->arch_vm.io_handlers[mid]->desc.addr <= last) {
+			lo = mid + 1U;
+		} else {
+			hi = mid;
+		}
+	}
+
+	if (lo == 0U) {
+		return NULL;
+	}
+
+	handler = vm->arch_vm.io_handlers[lo - 1U];
+	if (((uint32_t)handler->desc.addr + handler->desc.len) <= port) {
+		return NULL;
+	}
+
+	return handler;
+}
+
 /**
  * Try handling the given request by any port I/O handler registered in the
  * hypervisor.
@@ -186,19 +225,18 @@ hv_emulate_pio(struct vcpu *vcpu, struct io_request *io_req)
 	size = (uint16_t)pio_req->size;
 	mask = 0xFFFFFFFFU >> (32U - 8U * size);
 
-	for (handler = vm->arch_vm.io_handler;
-		handler != NULL; handler = handler->next) {
-		uint16_t base = handler->desc.addr;
-		uint16_t end = base + (uint16_t)handler->desc.len;
+	handler = find_io_handler(vm, port, size);
+	if (handler != NULL) {
+		uint32_t base = handler->desc.addr;
+		uint32_t end = base + (uint32_t)handler->desc.len;
 
-		if ((port >= end) || (port + size <= base)) {
-			continue;
-		} else if (!((port >= base) && ((port + size) <= end))) {
+		if (!((port >= base) && (((uint32_t)port + size) <= end))) {
 			pr_fatal("Err:IO, port 0x%04x, size=%hu spans devices",
 					port, size);
 			status = -EIO;
-			break;
 		} else {
+			atomic_inc64(&handler->hits);
+
 			if (pio_req->direction == REQUEST_WRITE) {
 				handler->desc.io_write(handler, vm, port, size,
 					pio_req->value & mask);
@@ -213,17 +251,58 @@ hv_emulate_pio(struct vcpu *vcpu, struct io_request *io_req)
 					port, pio_req->value);
 			}
 			status = 0;
-			break;
 		}
 	}
 
 	return status;
 }
 
+/**
+ * Find the MMIO node whose range overlaps [address, address + size).
+ *
+ * Like the port I/O handlers, the MMIO nodes of a VM are sorted by the start
+ * of their non-overlapping ranges.
+ *
+ * @return the overlapping node, or NULL if no node overlaps the access.
+ */
+static struct mem_io_node *
+find_mmio_node(struct vm *vm, uint64_t address, uint64_t size)
+{
+	struct mem_io_node *mmio_node;
+	uint64_t last = address + size - 1UL;
+	uint32_t lo = 0U, hi = vm->mmio_node_num;
+	uint32_t mid;
+
+	/* Find the first node which starts above the last accessed byte */
+	while (lo < hi) {
+		mid = lo + ((hi - lo) >> 1U);
+		if (vm->mmio_nodes[mid]->range_start <= last) {
+			lo = mid + 1U;
+		} else {
+			hi = mid;
+		}
+	}
+
+	if (lo == 0U) {
+		return NULL;
+	}
+
+	mmio_node = vm->mmio_nodes[lo - 1U];
+	if (mmio_node->range_end <= address) {
+		return NULL;
+	}
+
+	return mmio_node;
+}
+
 /**
  * Use registered MMIO handlers on the given request if it falls in the range of
  * any of them.
  *
+ * The node matched by the previous MMIO access of \p vcpu is tried first, so
+ * that a guest hammering the same device resolves its handler without a
+ * search.
+ *
  * @pre io_req->type == REQ_MMIO
  *
  * @return 0       - Successfully emulated by registered handlers.
@@ -235,34 +314,33 @@ hv_emulate_mmio(struct vcpu *vcpu, struct io_request *io_req)
 {
 	int status = -ENODEV;
 	uint64_t address, size;
-	struct list_head *pos;
 	struct mmio_request *mmio_req = &io_req->reqs.mmio;
-	struct mem_io_node *mmio_handler = NULL;
+	struct mem_io_node *mmio_handler = vcpu->last_mmio_node;
 
 	address = mmio_req->address;
 	size = mmio_req->size;
 
-	list_for_each(pos, &vcpu->vm->mmio_list) {
-		uint64_t base, end;
-
-		mmio_handler = list_entry(pos, struct mem_io_node, list);
-		base = mmio_handler->range_start;
-		end = mmio_handler->range_end;
+	if ((mmio_handler == NULL) || (address < mmio_handler->range_start) ||
+			(address + size > mmio_handler->range_end)) {
+		mmio_handler = find_mmio_node(vcpu->vm, address, size);
+		if (mmio_handler == NULL) {
+			return status;
+		}
 
-		if ((address + size <= base) || (address >= end)) {
-			continue;
-		} else if (!((address >= base) && (address + size <= end))) {
+		if (!((address >= mmio_handler->range_start) &&
+				(address + size <= mmio_handler->range_end))) {
 			pr_fatal("Err MMIO, address:0x%llx, size:%x",
 				 address, size);
 			return -EIO;
-		} else {
-			/* Handle this MMIO operation */
-			status = mmio_handler->read_write(vcpu, io_req,
-					mmio_handler->handler_private_data);
-			break;
 		}
+
+		vcpu->last_mmio_node = mmio_handler;
 	}
 
+	/* Handle this MMIO operation */
+	status = mmio_handler->read_write(vcpu, io_req,
+			mmio_handler->handler_private_data);
+
 	return status;
 }
 
@@ -307,8 +385,20 @@ emulate_io(struct vcpu *vcpu, struct io_request *io_req)
 		/*
 		 * No handler from HV side, search from VHM in Dom0
 		 *
-		 * ACRN insert request to VHM and inject upcall.
+		 * Doorbell writes and writes to posted ranges are handed to
+		 * VHM and complete at once. Otherwise ACRN insert request to
+		 * VHM and inject upcall.
 		 */
+		status = acrn_ring_doorbell(vcpu, io_req);
+		if (status == 0) {
+			return status;
+		}
+
+		status = acrn_insert_posted_request(vcpu, io_req);
+		if (status == 0) {
+			return status;
+		}
+
 		status = acrn_insert_request_wait(vcpu, io_req);
 
 		if (status != 0) {
@@ -362,26 +452,57 @@ int32_t pio_instr_vmexit_handler(struct vcpu *vcpu)
 	return status;
 }
 
-static void register_io_handler(struct vm *vm, struct vm_io_handler *hdlr)
+/**
+ * Insert the handler into the sorted handler array of the VM.
+ *
+ * @return 0 on success, -EINVAL if its range overlaps a registered one or
+ * -ENOMEM if the handler array is full.
+ */
+static int32_t register_io_handler(struct vm *vm, struct vm_io_handler *hdlr)
 {
-	if (vm->arch_vm.io_handler != NULL) {
-		hdlr->next = vm->arch_vm.io_handler;
+	struct vm_arch *arch_vm = &vm->arch_vm;
+	uint32_t base = hdlr->desc.addr;
+	uint32_t end = base + (uint32_t)hdlr->desc.len;
+	uint32_t i, pos;
+
+	if (arch_vm->io_handler_num >= MAX_IO_HANDLER_NUM) {
+		return -ENOMEM;
+	}
+
+	for (pos = 0U; pos < arch_vm->io_handler_num; pos++) {
+		if (arch_vm->io_handlers[pos]->desc.addr >= base) {
+			break;
+		}
+	}
+
+	/* Reject ranges overlapping with their neighbours */
+	if ((pos > 0U) && ((arch_vm->io_handlers[pos - 1U]->desc.addr +
+			arch_vm->io_handlers[pos - 1U]->desc.len) > base)) {
+		return -EINVAL;
+	}
+	if ((pos < arch_vm->io_handler_num) &&
+			(arch_vm->io_handlers[pos]->desc.addr < end)) {
+		return -EINVAL;
+	}
+
+	for (i = arch_vm->io_handler_num; i > pos; i--) {
+		arch_vm->io_handlers[i] = arch_vm->io_handlers[i - 1U];
 	}
+	arch_vm->io_handlers[pos] = hdlr;
+	arch_vm->io_handler_num++;
 
-	vm->arch_vm.io_handler = hdlr;
+	return 0;
 }
 
 static void empty_io_handler_list(struct vm *vm)
 {
-	struct vm_io_handler *handler = vm->arch_vm.io_handler;
-	struct vm_io_handler *tmp;
+	uint32_t i;
 
-	while (handler != NULL) {
-		tmp = handler;
-		handler = tmp->next;
-		free(tmp);
+	for (i = 0U; i < vm->arch_vm.io_handler_num; i++) {
+		free(vm->arch_vm.io_handlers[i]);
+		vm->arch_vm.io_handlers[i] = NULL;
 	}
-	vm->arch_vm.io_handler = NULL;
+	vm->arch_vm.io_handler_num = 0U;
 }
 
 void free_io_emulation_resource(struct vm *vm)
@@ -480,14 +601,95 @@ void register_io_emulation_handler(struct vm *vm, struct vm_io_range *range,
 		return;
 	}
 
+	handler = create_io_handler(range->base,
+			range->len, io_read_fn_ptr, io_write_fn_ptr);
+	if (handler == NULL) {
+		return;
+	}
+
+	if (register_io_handler(vm, handler) != 0) {
+		pr_err("Failed to register IO handler for port 0x%04x, len %hu",
+			range->base, range->len);
+		free(handler);
+		return;
+	}
+
 	if (is_vm0(vm)) {
 		deny_guest_io_access(vm, range->base, range->len);
 	}
+}
 
-	handler = create_io_handler(range->base,
-			range->len, io_read_fn_ptr, io_write_fn_ptr);
+#ifdef HV_DEBUG
+void get_vm_io_info(char *str_arg, int str_max, uint16_t vmid)
+{
+	char *str = str_arg;
+	int len, size = str_max;
+	struct vm *vm = get_vm_from_vmid(vmid);
+	struct vm_io_handler *handler;
+	uint32_t i;
+
+	if (vm == NULL) {
+		len = snprintf(str, size,
+			"\r\nvm is not exist for vmid %hu", vmid);
+		size -= len;
+		str += len;
+		goto END;
+	}
 
-	register_io_handler(vm, handler);
+	len = snprintf(str, size, "\r\nPORT\tLEN\tHITS");
+	size -= len;
+	str += len;
+
+	for (i = 0U; i < vm->arch_vm.io_handler_num; i++) {
+		handler = vm->arch_vm.io_handlers[i];
+		len = snprintf(str, size, "\r\n0x%04x\t%u\t%lld",
+			handler->desc.addr, (uint32_t)handler->desc.len,
+			handler->hits);
+		size -= len;
+		str += len;
+	}
+END:
+	snprintf(str, size, "\r\n");
+}
+#endif /* HV_DEBUG */
+
+/**
+ * Insert the node into the sorted MMIO node array of the VM.
+ *
+ * @return 0 on success, -EINVAL if its range overlaps a registered one or
+ * -ENOMEM if the node array is full.
+ */
+static int32_t insert_mmio_node(struct vm *vm, struct mem_io_node *mmio_node)
+{
+	uint32_t i, pos;
+
+	if (vm->mmio_node_num >= MAX_MMIO_NODE_NUM) {
+		return -ENOMEM;
+	}
+
+	for (pos = 0U; pos < vm->mmio_node_num; pos++) {
+		if (vm->mmio_nodes[pos]->range_start >= mmio_node->range_start) {
+			break;
+		}
+	}
+
+	/* Reject ranges overlapping with their neighbours */
+	if ((pos > 0U) && (vm->mmio_nodes[pos - 1U]->range_end >
+			mmio_node->range_start)) {
+		return -EINVAL;
+	}
+	if ((pos < vm->mmio_node_num) &&
+		(vm->mmio_nodes[pos]->range_start < mmio_node->range_end)) {
+		return -EINVAL;
+	}
+
+	for (i = vm->mmio_node_num; i > pos; i--) {
+		vm->mmio_nodes[i] = vm->mmio_nodes[i - 1U];
+	}
+	vm->mmio_nodes[pos] = mmio_node;
+	vm->mmio_node_num++;
+
+	return 0;
 }
 
 int register_mmio_emulation_handler(struct vm *vm,
@@ -513,13 +715,17 @@ int register_mmio_emulation_handler(struct vm *vm,
 			/* Fill in information for this node */
 			mmio_node->read_write = read_write;
 			mmio_node->handler_private_data = handler_private_data;
-
-			INIT_LIST_HEAD(&mmio_node->list);
-			list_add(&mmio_node->list, &vm->mmio_list);
-
 			mmio_node->range_start = start;
 			mmio_node->range_end = end;
 
+			status = insert_mmio_node(vm, mmio_node);
+			if (status != 0) {
+				pr_err("Failed to register MMIO handler for "
+					"[0x%llx, 0x%llx)", start, end);
+				free(mmio_node);
+				return status;
+			}
+
 			/*
 			 * SOS would map all its memory at beginning, so we
 			 * should unmap it. But UOS will not, so we shouldn't
@@ -530,9 +736,6 @@ int register_mmio_emulation_handler(struct vm *vm,
 					(uint64_t *)vm->arch_vm.nworld_eptp,
 					start, end - start);
 			}
-
-			/* Return success */
-			status = 0;
 		}
 	}
 
@@ -543,16 +746,30 @@ int register_mmio_emulation_handler(struct vm *vm,
 void unregister_mmio_emulation_handler(struct vm *vm, uint64_t start,
 	uint64_t end)
 {
-	struct list_head *pos, *tmp;
 	struct mem_io_node *mmio_node;
+	struct vcpu *vcpu;
+	uint32_t i, pos;
+	uint16_t vcpu_id;
 
-	list_for_each_safe(pos, tmp, &vm->mmio_list) {
-		mmio_node = list_entry(pos, struct mem_io_node, list);
+	for (pos = 0U; pos < vm->mmio_node_num; pos++) {
+		mmio_node = vm->mmio_nodes[pos];
 
 		if ((mmio_node->range_start == start) &&
 			(mmio_node->range_end == end)) {
-			/* assume only one entry found in mmio_list */
-			list_del_init(&mmio_node->list);
+			/* ranges never overlap, so only one node is found */
+			for (i = pos + 1U; i < vm->mmio_node_num; i++) {
+				vm->mmio_nodes[i - 1U] = vm->mmio_nodes[i];
+			}
+			vm->mmio_node_num--;
+			vm->mmio_nodes[vm->mmio_node_num] = NULL;
+
+			/* Drop the last-hit hints pointing to the freed node */
+			foreach_vcpu(vcpu_id, vm, vcpu) {
+				if (vcpu->last_mmio_node == mmio_node) {
+					vcpu->last_mmio_node = NULL;
+				}
+			}
+
 			free(mmio_node);
 			break;
 		}
@@ -17,10 +17,12 @@ static uint32_t vector_to_irq[NR_MAX_VECTOR + 1];
 
 spurious_handler_t spurious_handler;
 
-#define NR_STATIC_MAPPINGS     (2U)
+#define NR_STATIC_MAPPINGS     (4U)
 static uint32_t irq_static_mappings[NR_STATIC_MAPPINGS][2] = {
 	{TIMER_IRQ, VECTOR_TIMER},
 	{NOTIFY_IRQ, VECTOR_NOTIFY_VCPU},
+	{POSTED_INTR_IRQ, VECTOR_POSTED_INTR},
+	{POSTED_INTR_WAKEUP_IRQ, VECTOR_POSTED_INTR_WAKEUP},
 };
 
 /*
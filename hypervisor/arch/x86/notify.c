@@ -5,6 +5,7 @@
  */
 
 #include <hypervisor.h>
+#include <softirq.h>
 
 static uint32_t notification_irq = IRQ_INVALID;
 
@@ -78,6 +79,52 @@ static int request_notification_irq(irq_action_t func, void *data)
 	return 0;
 }
 
+/* run in interrupt context */
+static void posted_intr_notification(__unused uint32_t irq,
+		__unused void *data)
+{
+	/* Reaching here means the posted interrupt was not consumed in
+	 * non-root mode: the target vcpu is in root mode, switched out or
+	 * halted. Let the softirq hand it over as a normal event.
+	 */
+	fire_softirq(SOFTIRQ_POSTED_INTR);
+}
+
+static void posted_intr_softirq(uint16_t pcpu_id)
+{
+	uint16_t vm_id, i;
+	struct vm *vm;
+	struct vcpu *vcpu;
+
+	for (vm_id = 0U; vm_id < MAX_VM_NUM; vm_id++) {
+		vm = get_vm_from_vmid(vm_id);
+		if (vm == NULL) {
+			continue;
+		}
+
+		foreach_vcpu(i, vm, vcpu) {
+			if (vcpu->pcpu_id != pcpu_id) {
+				continue;
+			}
+			if (vlapic_has_posted_intr(vcpu->arch_vcpu.vlapic)) {
+				vcpu_make_request(vcpu, ACRN_REQUEST_EVENT);
+			}
+		}
+	}
+}
+
+static void setup_posted_intr_notification(void)
+{
+	register_softirq(SOFTIRQ_POSTED_INTR, posted_intr_softirq);
+
+	if ((request_irq(POSTED_INTR_IRQ, posted_intr_notification,
+			NULL, IRQF_NONE) < 0) ||
+		(request_irq(POSTED_INTR_WAKEUP_IRQ, posted_intr_notification,
+			NULL, IRQF_NONE) < 0)) {
+		pr_err("Failed to add posted interrupt isr");
+	}
+}
+
 void setup_notification(void)
 {
 	uint16_t cpu = get_cpu_id();
@@ -94,4 +141,6 @@ void setup_notification(void)
 
 	dev_dbg(ACRN_DBG_PTIRQ, "NOTIFY: irq[%d] setup vector %x",
 		notification_irq, irq_to_vector(notification_irq));
+
+	setup_posted_intr_notification();
 }
@@ -56,6 +56,91 @@ static int split_large_page(uint64_t *pte,
 	return 0;
 }
 
+static void defer_free_paging_struct(uint64_t *pbase)
+{
+	uint16_t pcpu_id = get_cpu_id();
+	uint32_t num = per_cpu(ept_merged_num, pcpu_id);
+
+	per_cpu(ept_merged, pcpu_id)[num] = (void *)pbase;
+	per_cpu(ept_merged_num, pcpu_id) = num + 1U;
+}
+
+/*
+ * Replace the next level page table of an EPT pde/pdpte by a large page
+ * when its entries map a contiguous, aligned range with the same
+ * attributes, or drop it when all its entries were deleted.
+ * Only done for EPT: the mapping is unchanged meanwhile, but the pcpus
+ * and the DMA remapping units, for which the EPT is also the VT-d
+ * second-level table, may still walk the unlinked table through their
+ * paging-structure caches. So it is only queued here, and the ept_mr_*
+ * caller frees it after INVEPT on all the pcpus of the VM and the
+ * invalidation of its IOMMU domain. No merge once the queue is full.
+ */
+static void merge_page_table(uint64_t *pte,
+			enum _page_table_level level,
+			enum _page_table_type ptt)
+{
+	uint64_t *pbase;
+	uint64_t first, expected, paddrinc, align;
+	uint64_t i;
+
+	if (ptt != PTT_EPT) {
+		return;
+	}
+
+	switch (level) {
+	case IA32E_PDPT:
+		pbase = pdpte_page_vaddr(*pte);
+		paddrinc = PDE_SIZE;
+		align = PDPTE_SIZE;
+		break;
+	case IA32E_PD:
+		pbase = pde_page_vaddr(*pte);
+		paddrinc = PTE_SIZE;
+		align = PDE_SIZE;
+		break;
+	default:
+		return;
+	}
+
+	if (get_cpu_var(ept_merged_num) >= EPT_MERGED_MAX) {
+		return;
+	}
+
+	first = pbase[0];
+	if (first == 0UL) {
+		for (i = 1UL; i < PTRS_PER_PTE; i++) {
+			if (pbase[i] != 0UL) {
+				return;
+			}
+		}
+		set_pgentry(pte, 0UL);
+		defer_free_paging_struct(pbase);
+		return;
+	}
+
+	/* A pde pointing to a page table can not be merged into a pdpte */
+	if ((pgentry_present(ptt, first) == 0UL) ||
+			((level == IA32E_PDPT) && (pde_large(first) == 0UL)) ||
+			!MEM_ALIGNED_CHECK(first & PDE_PFN_MASK, align)) {
+		return;
+	}
+
+	expected = first;
+	for (i = 1UL; i < PTRS_PER_PTE; i++) {
+		expected += paddrinc;
+		if (pbase[i] != expected) {
+			return;
+		}
+	}
+
+	dev_dbg(ACRN_DBG_MMU, "%s, paddr: 0x%llx\n", __func__,
+		first & PDE_PFN_MASK);
+
+	set_pgentry(pte, first | PAGE_PSE);
+	defer_free_paging_struct(pbase);
+}
+
 static inline void __modify_or_del_pte(uint64_t *pte,
 		uint64_t prot_set, uint64_t prot_clr, uint32_t type)
 {
@@ -167,6 +252,9 @@ static int modify_or_del_pde(uint64_t *pdpte,
 		}
 		ret = modify_or_del_pte(pde, vaddr, vaddr_end,
 				prot_set, prot_clr, ptt, type);
+		if (ret == 0) {
+			merge_page_table(pde, IA32E_PD, ptt);
+		}
 		if (ret != 0 || (vaddr_next >= vaddr_end)) {
 			return ret;
 		}
@@ -222,6 +310,9 @@ static int modify_or_del_pdpte(uint64_t *pml4e,
 		}
 		ret = modify_or_del_pde(pdpte, vaddr, vaddr_end,
 				prot_set, prot_clr, ptt, type);
+		if (ret == 0) {
+			merge_page_table(pdpte, IA32E_PDPT, ptt);
+		}
 		if (ret != 0 || (vaddr_next >= vaddr_end)) {
 			return ret;
 		}
@@ -355,6 +446,9 @@ static int add_pde(uint64_t *pdpte, uint64_t paddr_start,
 			}
 		}
 		ret = add_pte(pde, paddr, vaddr, vaddr_end, prot, ptt);
+		if (ret == 0) {
+			merge_page_table(pde, IA32E_PD, ptt);
+		}
 		if (ret != 0 || (vaddr_next >= vaddr_end)) {
 			return ret;
 		}
@@ -404,6 +498,9 @@ static int add_pdpte(uint64_t *pml4e, uint64_t paddr_start,
 			}
 		}
 		ret = add_pde(pdpte, paddr, vaddr, vaddr_end, prot, ptt);
+		if (ret == 0) {
+			merge_page_table(pdpte, IA32E_PDPT, ptt);
+		}
 		if (ret != 0 || (vaddr_next >= vaddr_end)) {
 			return ret;
 		}
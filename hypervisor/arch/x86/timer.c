@@ -7,7 +7,6 @@
 #include <hypervisor.h>
 #include <softirq.h>
 
-#define MAX_TIMER_ACTIONS	32U
 #define CAL_MS			10U
 #define MIN_TIMER_PERIOD_US	500U
 
@@ -31,42 +30,101 @@ static void tsc_deadline_handler(__unused uint32_t irq, __unused void *data)
 
 static inline void update_physical_timer(struct per_cpu_timers *cpu_timer)
 {
-	struct hv_timer *timer = NULL;
+	/* program the next event timer, or disarm if there is none */
+	if (cpu_timer->timer_num > 0U) {
+		/* it is okay to program a expired time */
+		msr_write(MSR_IA32_TSC_DEADLINE, cpu_timer->heap[0]->fire_tsc);
+	} else {
+		msr_write(MSR_IA32_TSC_DEADLINE, 0UL);
+	}
+}
 
-	/* find the next event timer */
-	if (!list_empty(&cpu_timer->timer_list)) {
-		timer = list_entry((&cpu_timer->timer_list)->next,
-			struct hv_timer, node);
+static inline void timer_heap_set(struct per_cpu_timers *cpu_timer,
+			uint32_t idx, struct hv_timer *timer)
+{
+	cpu_timer->heap[idx] = timer;
+	timer->heap_idx = idx;
+}
 
-		/* it is okay to program a expired time */
-		msr_write(MSR_IA32_TSC_DEADLINE, timer->fire_tsc);
+static void timer_heap_sift_up(struct per_cpu_timers *cpu_timer,
+			uint32_t idx_arg)
+{
+	struct hv_timer *timer = cpu_timer->heap[idx_arg];
+	uint32_t idx = idx_arg;
+	uint32_t parent;
+
+	while (idx > 0U) {
+		parent = (idx - 1U) >> 1U;
+		if (cpu_timer->heap[parent]->fire_tsc <= timer->fire_tsc) {
+			break;
+		}
+		timer_heap_set(cpu_timer, idx, cpu_timer->heap[parent]);
+		idx = parent;
 	}
+	timer_heap_set(cpu_timer, idx, timer);
 }
 
-static void local_add_timer(struct per_cpu_timers *cpu_timer,
-			struct hv_timer *timer,
-			bool *need_update)
+static void timer_heap_sift_down(struct per_cpu_timers *cpu_timer,
+			uint32_t idx_arg)
 {
-	struct list_head *pos, *prev;
-	struct hv_timer *tmp;
-	uint64_t tsc = timer->fire_tsc;
-
-	prev = &cpu_timer->timer_list;
-	list_for_each(pos, &cpu_timer->timer_list) {
-		tmp = list_entry(pos, struct hv_timer, node);
-		if (tmp->fire_tsc < tsc) {
-			prev = &tmp->node;
+	struct hv_timer *timer = cpu_timer->heap[idx_arg];
+	uint32_t idx = idx_arg;
+	uint32_t child;
+
+	while (true) {
+		child = (idx << 1U) + 1U;
+		if (child >= cpu_timer->timer_num) {
+			break;
+		}
+		if (((child + 1U) < cpu_timer->timer_num) &&
+				(cpu_timer->heap[child + 1U]->fire_tsc <
+				cpu_timer->heap[child]->fire_tsc)) {
+			child++;
 		}
-		else {
+		if (timer->fire_tsc <= cpu_timer->heap[child]->fire_tsc) {
 			break;
 		}
+		timer_heap_set(cpu_timer, idx, cpu_timer->heap[child]);
+		idx = child;
+	}
+	timer_heap_set(cpu_timer, idx, timer);
+}
+
+static int local_add_timer(struct per_cpu_timers *cpu_timer,
+			struct hv_timer *timer,
+			bool *need_update)
+{
+	if (cpu_timer->timer_num >= MAX_TIMER_NUM) {
+		return -ENOMEM;
 	}
 
-	list_add(&timer->node, prev);
+	timer_heap_set(cpu_timer, cpu_timer->timer_num, timer);
+	cpu_timer->timer_num++;
+	timer_heap_sift_up(cpu_timer, timer->heap_idx);
 
 	if (need_update != NULL) {
-		/* update the physical timer if we're on the timer_list head */
-		*need_update = (prev == &cpu_timer->timer_list);
+		/* update the physical timer if we're on the heap top */
+		*need_update = (timer->heap_idx == 0U);
+	}
+
+	return 0;
+}
+
+static void local_del_timer(struct per_cpu_timers *cpu_timer,
+			struct hv_timer *timer)
+{
+	struct hv_timer *last;
+	uint32_t idx = timer->heap_idx;
+
+	timer->heap_idx = INVALID_TIMER_IDX;
+	cpu_timer->timer_num--;
+
+	/* move the last timer into the hole, then restore the heap order */
+	if (idx != cpu_timer->timer_num) {
+		last = cpu_timer->heap[cpu_timer->timer_num];
+		timer_heap_set(cpu_timer, idx, last);
+		timer_heap_sift_down(cpu_timer, idx);
+		timer_heap_sift_up(cpu_timer, last->heap_idx);
 	}
 }
 
@@ -86,9 +144,16 @@ int add_timer(struct hv_timer *timer)
 				us_to_ticks(MIN_TIMER_PERIOD_US));
 	}
 
+	/* an active timer is moved to its new deadline */
+	del_timer(timer);
+
 	pcpu_id  = get_cpu_id();
 	cpu_timer = &per_cpu(cpu_timers, pcpu_id);
-	local_add_timer(cpu_timer, timer, &need_update);
+	if (local_add_timer(cpu_timer, timer, &need_update) != 0) {
+		pr_err("%s: too many timers on pcpu%hu", __func__, pcpu_id);
+		return -ENOMEM;
+	}
+	timer->pcpu_id = pcpu_id;
 
 	if (need_update) {
 		update_physical_timer(cpu_timer);
@@ -101,8 +166,11 @@ int add_timer(struct hv_timer *timer)
 
 void del_timer(struct hv_timer *timer)
 {
-	if ((timer != NULL) && !list_empty(&timer->node)) {
-		list_del_init(&timer->node);
+	if ((timer != NULL) && (timer->heap_idx != INVALID_TIMER_IDX)) {
+		/* the physical timer is left armed, which at worst raises
+		 * a timer softirq finding nothing expired
+		 */
+		local_del_timer(&per_cpu(cpu_timers, timer->pcpu_id), timer);
 	}
 }
 
@@ -111,7 +179,7 @@ static void init_percpu_timer(uint16_t pcpu_id)
 	struct per_cpu_timers *cpu_timer;
 
 	cpu_timer = &per_cpu(cpu_timers, pcpu_id);
-	INIT_LIST_HEAD(&cpu_timer->timer_list);
+	cpu_timer->timer_num = 0U;
 }
 
 static void init_tsc_deadline_timer(void)
@@ -131,36 +199,33 @@ static void timer_softirq(uint16_t pcpu_id)
 {
 	struct per_cpu_timers *cpu_timer;
 	struct hv_timer *timer;
-	struct list_head *pos, *n;
-	int tries = MAX_TIMER_ACTIONS;
 	uint64_t current_tsc = rdtsc();
 
 	/* handle passed timer */
 	cpu_timer = &per_cpu(cpu_timers, pcpu_id);
 
-	/* This is to make sure we are not blocked due to delay inside func()
-	 * force to exit irq handler after we serviced >31 timers
-	 * caller used to local_add_timer() for periodic timer, if there is a delay
-	 * inside func(), it will infinitely loop here, because new added timer
-	 * already passed due to previously func()'s delay.
+	/* Only the timers expired by current_tsc are run, so a periodic
+	 * timer delayed by func() catches up with its missed periods and
+	 * then leaves the loop.
 	 */
-	list_for_each_safe(pos, n, &cpu_timer->timer_list) {
-		timer = list_entry(pos, struct hv_timer, node);
+	while (cpu_timer->timer_num > 0U) {
+		timer = cpu_timer->heap[0];
 		/* timer expried */
-		tries--;
-		if ((timer->fire_tsc <= current_tsc) && (tries > 0)) {
-			del_timer(timer);
-
-			run_timer(timer);
-
-			if (timer->mode == TICK_MODE_PERIODIC) {
-				/* update periodic timer fire tsc */
-				timer->fire_tsc += timer->period_in_cycle;
-				local_add_timer(cpu_timer, timer, NULL);
-			}
-		} else {
+		if (timer->fire_tsc > current_tsc) {
 			break;
 		}
+
+		local_del_timer(cpu_timer, timer);
+
+		run_timer(timer);
+
+		if (timer->mode == TICK_MODE_PERIODIC) {
+			/* update periodic timer fire tsc, the slot of the
+			 * timer just deleted is still free
+			 */
+			timer->fire_tsc += timer->period_in_cycle;
+			(void)local_add_timer(cpu_timer, timer, NULL);
+		}
 	}
 
 	/* update nearest timer */
@@ -95,14 +95,18 @@ static bool vcpu_pending_request(struct vcpu *vcpu)
 void vcpu_make_request(struct vcpu *vcpu, uint16_t eventid)
 {
 	bitmap_set_lock(eventid, &vcpu->arch_vcpu.pending_req);
+
+	/* A halted vcpu is off the runqueue, put it back to handle the event.
+	 * The locked bit set above orders against the check in halt_vcpu().
+	 */
+	if (atomic_load32(&vcpu->halted) != 0U) {
+		wake_halted_vcpu(vcpu);
+	}
+
 	/*
 	 * if current hostcpu is not the target vcpu's hostcpu, we need
-	 * to invoke IPI to wake up target vcpu
-	 *
-	 * TODO: Here we just compare with cpuid, since cpuid currently is
-	 *  global under pCPU / vCPU 1:1 mapping. If later we enabled vcpu
-	 *  scheduling, we need change here to determine it target vcpu is
-	 *  VMX non-root or root mode
+	 * to invoke IPI to wake up target vcpu. The IPI is harmless if the
+	 * pcpu is running another vcpu.
 	 */
 	if (get_cpu_id() != vcpu->pcpu_id) {
 		send_single_ipi(vcpu->pcpu_id, VECTOR_NOTIFY_VCPU);
@@ -14,6 +14,7 @@
 
 static int unhandled_vmexit_handler(struct vcpu *vcpu);
 static int xsetbv_vmexit_handler(struct vcpu *vcpu);
+static int hlt_vmexit_handler(struct vcpu *vcpu);
 
 /* VM Dispatch table for Exit condition handling */
 static const struct vm_exit_dispatch dispatch_table[NR_VMX_EXIT_REASONS] = {
@@ -42,7 +43,7 @@ static const struct vm_exit_dispatch dispatch_table[NR_VMX_EXIT_REASONS] = {
 	[VMX_EXIT_REASON_GETSEC] = {
 		.handler = unhandled_vmexit_handler},
 	[VMX_EXIT_REASON_HLT] = {
-		.handler = unhandled_vmexit_handler},
+		.handler = hlt_vmexit_handler},
 	[VMX_EXIT_REASON_INVD] = {
 		.handler = unhandled_vmexit_handler},
 	[VMX_EXIT_REASON_INVLPG] = {
@@ -151,6 +152,42 @@ static const struct vm_exit_dispatch dispatch_table[NR_VMX_EXIT_REASONS] = {
 		.handler = unhandled_vmexit_handler}
 };
 
+/*
+ * Early dispatch of the two most frequent exits of SMP guests, TSC
+ * deadline rearms and IPIs, bypassing the generic handlers. Returns true
+ * if the exit is fully handled.
+ */
+static bool vmexit_fast_path(struct vcpu *vcpu, uint16_t basic_exit_reason)
+{
+	uint64_t v;
+	uint32_t offset;
+
+	switch (basic_exit_reason) {
+	case VMX_EXIT_REASON_WRMSR:
+		if ((uint32_t)vcpu_get_gpreg(vcpu, CPU_REG_RCX) !=
+				MSR_IA32_TSC_DEADLINE) {
+			return false;
+		}
+		v = (vcpu_get_gpreg(vcpu, CPU_REG_RDX) << 32U) |
+			(vcpu_get_gpreg(vcpu, CPU_REG_RAX) & 0xFFFFFFFFUL);
+		vlapic_set_tsc_deadline_msr(vcpu->arch_vcpu.vlapic, v);
+		TRACE_2L(TRACE_VMEXIT_WRMSR, MSR_IA32_TSC_DEADLINE, v);
+		return true;
+	case VMX_EXIT_REASON_APIC_WRITE:
+		offset = (uint32_t)vcpu->arch_vcpu.exit_qualification & 0xFFFU;
+		if (!vlapic_apic_write_fast_path(vcpu->arch_vcpu.vlapic,
+				offset)) {
+			return false;
+		}
+		/* APIC-write is trap-like */
+		vcpu_retain_rip(vcpu);
+		TRACE_2L(TRACE_VMEXIT_APICV_WRITE, offset, 0UL);
+		return true;
+	default:
+		return false;
+	}
+}
+
 int vmexit_handler(struct vcpu *vcpu)
 {
 	struct vm_exit_dispatch *dispatch = NULL;
@@ -162,6 +199,9 @@ int vmexit_handler(struct vcpu *vcpu)
 		return -EINVAL;
 	}
 
+	/* Drop the guest page walks cached during the previous exit */
+	vcpu->arch_vcpu.gtlb_gen++;
+
 	/* Obtain interrupt info */
 	vcpu->arch_vcpu.idt_vectoring_info =
 	    exec_vmread32(VMX_IDT_VEC_INFO_FIELD);
@@ -211,6 +251,10 @@ int vmexit_handler(struct vcpu *vcpu)
 		    exec_vmread(VMX_EXIT_QUALIFICATION);
 	}
 
+	if (vmexit_fast_path(vcpu, basic_exit_reason)) {
+		return 0;
+	}
+
 	/* exit dispatch handling */
 	if (basic_exit_reason == VMX_EXIT_REASON_EXTERNAL_INTERRUPT) {
 		/* Handling external_interrupt
@@ -226,6 +270,98 @@ int vmexit_handler(struct vcpu *vcpu)
 	return ret;
 }
 
+/*
+ * Account a VM exit which took cycles from the VM exit to the following VM
+ * entry, so including any wait for the device model.
+ *
+ * Only called on the pcpu of the vcpu, hence lockless.
+ */
+void vmexit_account(struct vcpu *vcpu, uint32_t basic_exit_reason,
+		uint64_t cycles)
+{
+	struct acrn_vmexit_reason_stats *stats;
+	uint16_t bucket;
+
+	if (basic_exit_reason >= ACRN_VMEXIT_REASON_NUM) {
+		return;
+	}
+
+	bucket = fls64(cycles);
+	if (bucket == INVALID_BIT_INDEX) {
+		bucket = 0U;
+	} else if (bucket >= ACRN_VMEXIT_HIST_NUM) {
+		bucket = (uint16_t)(ACRN_VMEXIT_HIST_NUM - 1U);
+	} else {
+		/* cycles in [2^bucket, 2^(bucket+1)) */
+	}
+
+	stats = &vcpu->exit_stats[basic_exit_reason];
+	stats->count++;
+	stats->cycles += cycles;
+	stats->hist[bucket]++;
+}
+
+#ifdef HV_DEBUG
+void get_vm_vmexit_stats(char *str_arg, int str_max, uint16_t vmid)
+{
+	char *str = str_arg;
+	int len, size = str_max;
+	struct vm *vm = get_vm_from_vmid(vmid);
+	struct vcpu *vcpu;
+	struct acrn_vmexit_reason_stats *stats;
+	uint16_t i;
+	uint32_t reason, bucket;
+
+	if (vm == NULL) {
+		len = snprintf(str, size,
+			"\r\nvm is not exist for vmid %hu", vmid);
+		size -= len;
+		str += len;
+		goto END;
+	}
+
+	len = snprintf(str, size, "\r\nVCPU\tPCPU\tREASON\t     COUNT"
+			"\t  AVG_CYC\tHIST(log2 cycles:count)");
+	size -= len;
+	str += len;
+
+	foreach_vcpu(i, vm, vcpu) {
+		for (reason = 0U; reason < ACRN_VMEXIT_REASON_NUM; reason++) {
+			stats = &vcpu->exit_stats[reason];
+			if (stats->count == 0UL) {
+				continue;
+			}
+
+			len = snprintf(str, size, "\r\n%hu\t%hu\t0x%02x\t%10lld"
+				"\t%9lld\t", vcpu->vcpu_id, vcpu->pcpu_id,
+				reason, stats->count,
+				stats->cycles / stats->count);
+			if (len >= size) {
+				goto END;
+			}
+			size -= len;
+			str += len;
+
+			for (bucket = 0U; bucket < ACRN_VMEXIT_HIST_NUM;
+					bucket++) {
+				if (stats->hist[bucket] == 0U) {
+					continue;
+				}
+				len = snprintf(str, size, " %u:%u", bucket,
+						stats->hist[bucket]);
+				if (len >= size) {
+					goto END;
+				}
+				size -= len;
+				str += len;
+			}
+		}
+	}
+END:
+	snprintf(str, size, "\r\n");
+}
+#endif /* HV_DEBUG */
+
 static int unhandled_vmexit_handler(struct vcpu *vcpu)
 {
 	pr_fatal("Error: Unhandled VM exit condition from guest at 0x%016llx ",
@@ -241,6 +377,14 @@ static int unhandled_vmexit_handler(struct vcpu *vcpu)
 	return 0;
 }
 
+/* HLT exiting is only enabled for UOS vcpus, see init_exec_ctrl() */
+static int hlt_vmexit_handler(struct vcpu *vcpu)
+{
+	halt_vcpu(vcpu);
+
+	return 0;
+}
+
 int cpuid_vmexit_handler(struct vcpu *vcpu)
 {
 	uint64_t rax, rbx, rcx, rdx;
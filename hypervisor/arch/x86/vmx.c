@@ -934,8 +934,12 @@ static void init_exec_ctrl(struct vcpu *vcpu)
 	 * interrupts preemption timer - pg 2899 24.6.1
 	 */
 	/* enable external interrupt VM Exit */
-	value32 = check_vmx_ctrl(MSR_IA32_VMX_PINBASED_CTLS,
-			VMX_PINBASED_CTLS_IRQ_EXIT);
+	value32 = VMX_PINBASED_CTLS_IRQ_EXIT;
+	/* process posted interrupts without VM exit */
+	if (is_apicv_posted_intr_supported()) {
+		value32 |= VMX_PINBASED_CTLS_POST_IRQ;
+	}
+	value32 = check_vmx_ctrl(MSR_IA32_VMX_PINBASED_CTLS, value32);
 
 	exec_vmwrite32(VMX_PIN_VM_EXEC_CONTROLS, value32);
 	pr_dbg("VMX_PIN_VM_EXEC_CONTROLS: 0x%x ", value32);
@@ -968,6 +972,13 @@ static void init_exec_ctrl(struct vcpu *vcpu)
 	 */
 	value32 &= ~VMX_PROCBASED_CTLS_INVLPG;
 
+#ifndef CONFIG_PARTITION_MODE
+	/* A halted UOS vcpu gives its pcpu to the other vcpus sharing it */
+	if (!is_vm0(vcpu->vm)) {
+		value32 |= VMX_PROCBASED_CTLS_HLT;
+	}
+#endif
+
 	exec_vmwrite32(VMX_PROC_VM_EXEC_CONTROLS, value32);
 	pr_dbg("VMX_PROC_VM_EXEC_CONTROLS: 0x%x ", value32);
 
@@ -1030,6 +1041,13 @@ static void init_exec_ctrl(struct vcpu *vcpu)
 		exec_vmwrite16(VMX_GUEST_INTR_STATUS, 0);
 	}
 
+	if (is_apicv_posted_intr_supported()) {
+		exec_vmwrite16(VMX_POSTED_INTR_VECTOR, VECTOR_POSTED_INTR);
+		value64 = vlapic_apicv_get_pir_desc_addr(
+				vcpu->arch_vcpu.vlapic);
+		exec_vmwrite64(VMX_PIR_DESC_ADDR_FULL, value64);
+	}
+
 	/* Load EPTP execution control
 	 * TODO: introduce API to make this data driven based
 	 * on VMX_EPT_VPID_CAP
@@ -1202,6 +1220,7 @@ int init_vmcs(struct vcpu *vcpu)
 	/* Load VMCS pointer */
 	status = exec_vmptrld((void *)&vmcs_pa);
 	ASSERT(status == 0, "Failed VMCS pointer load!");
+	per_cpu(ever_run_vcpu, vcpu->pcpu_id) = vcpu;
 
 	/* Initialize the Virtual Machine Control Structure (VMCS) */
 	init_host_state(vcpu);
@@ -80,6 +80,34 @@ dmar_set_bitslice(uint64_t var, uint64_t mask,
 #define DMAR_MSI_REDIRECTION_CPU         (0 << DMAR_MSI_REDIRECTION_SHIFT)
 #define DMAR_MSI_REDIRECTION_LOWPRI      (1 << DMAR_MSI_REDIRECTION_SHIFT)
 
+/* Queued invalidation descriptors, 128 bits each */
+#define QI_QUEUE_ENTRIES            256U
+#define QI_CC_DESC                  0x1UL
+#define QI_IOTLB_DESC               0x2UL
+#define QI_IOTLB_DR                 (1UL << 7U)
+#define QI_IOTLB_DW                 (1UL << 6U)
+#define QI_IEC_DESC                 0x4UL
+#define QI_IEC_INDEX                (1UL << 4U)
+#define QI_WAIT_DESC                0x5UL
+#define QI_WAIT_SW                  (1UL << 5U)
+#define QI_WAIT_FN                  (1UL << 6U)
+#define QI_WAIT_DONE                1U
+
+/* Interrupt remapping table entry, xAPIC destination format */
+#define IR_TABLE_ENTRIES            256U
+#define IR_TABLE_SIZE_ORDER         7UL /* 2^(7+1) entries */
+#define IRTE_PRESENT                (1UL << 0U)
+#define IRTE_DEST_MODE_LOGIC        (1UL << 2U)
+#define IRTE_REDIR_HINT             (1UL << 3U)
+#define IRTE_DELMODE_SHIFT          5U
+#define IRTE_POSTED                 (1UL << 15U)
+#define IRTE_VECTOR_SHIFT           16U
+#define IRTE_DEST_SHIFT             40U
+#define IRTE_PDA_LOW_MASK           0xFFFFFFC0UL
+#define IRTE_PDA_LOW_SHIFT          32U
+#define IRTE_PDA_HIGH_SHIFT         32U
+#define IRTE_SVT_ALL_BITS           (1UL << 18U) /* verify all SID bits */
+
 #define IOMMU_LOCK(u) spinlock_obtain(&((u)->lock))
 #define IOMMU_UNLOCK(u) spinlock_release(&((u)->lock))
 
@@ -135,6 +163,20 @@ struct dmar_drhd_rt {
 	uint16_t cap_num_fault_regs;
 	uint16_t cap_fault_reg_offset;
 	uint16_t ecap_iotlb_offset;
+
+	/* queued invalidation, replaces the register interface once enabled */
+	uint64_t *qi_queue;
+	uint32_t qi_tail;
+	volatile uint32_t qi_status;
+
+	/* interrupt remapping table and its allocation bitmap */
+	struct dmar_ir_entry *ir_table;
+	uint64_t ir_bitmap[IR_TABLE_ENTRIES / 64U];
+};
+
+struct dmar_ir_entry {
+	uint64_t lower;
+	uint64_t upper;
 };
 
 struct dmar_root_entry {
@@ -175,6 +217,8 @@ static struct list_head iommu_domains;
 static void dmar_register_hrhd(struct dmar_drhd_rt *dmar_uint);
 static struct dmar_drhd_rt *device_to_dmaru(uint16_t segment, uint8_t bus,
 					   uint8_t devfun);
+static void dmar_disable_qi(struct dmar_drhd_rt *dmar_uint);
+static void dmar_disable_intr_remapping(struct dmar_drhd_rt *dmar_uint);
 static void register_hrhd_units(void)
 {
 	struct dmar_info *info = get_dmar_info();
@@ -454,6 +498,10 @@ static void dmar_register_hrhd(struct dmar_drhd_rt *dmar_uint)
 	if ((dmar_uint->gcmd & DMA_GCMD_TE) != 0U) {
 		dmar_disable_translation(dmar_uint);
 	}
+
+	/* left enabled by firmware, set up again in dmar_enable */
+	dmar_disable_intr_remapping(dmar_uint);
+	dmar_disable_qi(dmar_uint);
 }
 
 static struct dmar_drhd_rt *device_to_dmaru(uint16_t segment, uint8_t bus,
@@ -517,6 +565,98 @@ static void free_domain_id(uint16_t dom_id)
 	spinlock_release(&domain_lock);
 }
 
+static inline bool dmar_qi_enabled(struct dmar_drhd_rt *dmar_uint)
+{
+	return ((dmar_uint->gcmd & DMA_GCMD_QIE) != 0U);
+}
+
+/*
+ * Queue one invalidation descriptor followed by a wait descriptor and
+ * spin until hardware has written back the wait status, so callers see
+ * the same synchronous semantics as the register based invalidation.
+ */
+static void dmar_qi_submit(struct dmar_drhd_rt *dmar_uint,
+		uint64_t lower, uint64_t upper)
+{
+	uint64_t *desc;
+	uint32_t tail;
+	/* variable start isn't used when built as release version */
+	__unused uint64_t start;
+
+	IOMMU_LOCK(dmar_uint);
+	tail = dmar_uint->qi_tail;
+	dmar_uint->qi_status = 0U;
+
+	desc = dmar_uint->qi_queue + (tail * 2U);
+	desc[0] = lower;
+	desc[1] = upper;
+	tail = (tail + 1U) % QI_QUEUE_ENTRIES;
+
+	desc = dmar_uint->qi_queue + (tail * 2U);
+	desc[0] = QI_WAIT_DESC | QI_WAIT_SW | QI_WAIT_FN |
+		((uint64_t)QI_WAIT_DONE << 32U);
+	desc[1] = HVA2HPA((void *)&dmar_uint->qi_status);
+	tail = (tail + 1U) % QI_QUEUE_ENTRIES;
+
+	dmar_uint->qi_tail = tail;
+	iommu_write64(dmar_uint, DMAR_IQT_REG,
+		(uint64_t)tail << DMAR_IQ_SHIFT);
+
+	start = rdtsc();
+	while (dmar_uint->qi_status != QI_WAIT_DONE) {
+		ASSERT(((rdtsc() - start) < CYCLES_PER_MS),
+			"DMAR QI Timeout!");
+		asm volatile ("pause" ::: "memory");
+	}
+	IOMMU_UNLOCK(dmar_uint);
+}
+
+static void dmar_enable_qi(struct dmar_drhd_rt *dmar_uint)
+{
+	uint32_t status;
+
+	if (iommu_ecap_qi(dmar_uint->ecap) == 0U) {
+		return;
+	}
+
+	if (dmar_uint->qi_queue == NULL) {
+		dmar_uint->qi_queue = (uint64_t *)alloc_paging_struct();
+		if (dmar_uint->qi_queue == NULL) {
+			pr_err("failed to allocate invalidation queue");
+			return;
+		}
+	}
+
+	IOMMU_LOCK(dmar_uint);
+	dmar_uint->qi_tail = 0U;
+	iommu_write64(dmar_uint, DMAR_IQT_REG, 0UL);
+	/* queue size 0: a single 4K page of QI_QUEUE_ENTRIES descriptors */
+	iommu_write64(dmar_uint, DMAR_IQA_REG,
+		HVA2HPA((void *)dmar_uint->qi_queue));
+
+	dmar_uint->gcmd |= DMA_GCMD_QIE;
+	iommu_write32(dmar_uint, DMAR_GCMD_REG, dmar_uint->gcmd);
+	DMAR_WAIT_COMPLETION(DMAR_GSTS_REG, (status & DMA_GSTS_QIES) != 0U,
+			status);
+	IOMMU_UNLOCK(dmar_uint);
+}
+
+static void dmar_disable_qi(struct dmar_drhd_rt *dmar_uint)
+{
+	uint32_t status;
+
+	if (!dmar_qi_enabled(dmar_uint)) {
+		return;
+	}
+
+	IOMMU_LOCK(dmar_uint);
+	dmar_uint->gcmd &= ~DMA_GCMD_QIE;
+	iommu_write32(dmar_uint, DMAR_GCMD_REG, dmar_uint->gcmd);
+	DMAR_WAIT_COMPLETION(DMAR_GSTS_REG, (status & DMA_GSTS_QIES) == 0U,
+			status);
+	IOMMU_UNLOCK(dmar_uint);
+}
+
 static void dmar_write_buffer_flush(struct dmar_drhd_rt *dmar_uint)
 {
 	uint32_t status;
@@ -562,6 +702,13 @@ static void dmar_invalid_context_cache(struct dmar_drhd_rt *dmar_uint,
 		return;
 	}
 
+	if (dmar_qi_enabled(dmar_uint)) {
+		dmar_qi_submit(dmar_uint, QI_CC_DESC | ((uint64_t)cirg << 4U) |
+			((uint64_t)did << 16U) | ((uint64_t)sid << 32U) |
+			((uint64_t)fm << 48U), 0UL);
+		return;
+	}
+
 	IOMMU_LOCK(dmar_uint);
 	iommu_write64(dmar_uint, DMAR_CCMD_REG, cmd);
 	/* read upper 32bits to check */
@@ -608,6 +755,14 @@ static void dmar_invalid_iotlb(struct dmar_drhd_rt *dmar_uint,
 		pr_err("unknown IIRG type");
 		return;
 	}
+
+	if (dmar_qi_enabled(dmar_uint)) {
+		dmar_qi_submit(dmar_uint, QI_IOTLB_DESC |
+			((uint64_t)iirg << 4U) | QI_IOTLB_DR | QI_IOTLB_DW |
+			((uint64_t)did << 16U), addr);
+		return;
+	}
+
 	IOMMU_LOCK(dmar_uint);
 	if (addr != 0U) {
 		iommu_write64(dmar_uint, dmar_uint->ecap_iotlb_offset, addr);
@@ -655,6 +810,85 @@ static void dmar_set_root_table(struct dmar_drhd_rt *dmar_uint)
 	IOMMU_UNLOCK(dmar_uint);
 }
 
+static void dmar_invalid_iec(struct dmar_drhd_rt *dmar_uint,
+		uint16_t index, bool global)
+{
+	uint64_t cmd = QI_IEC_DESC;
+
+	if (!global) {
+		cmd |= QI_IEC_INDEX | ((uint64_t)index << 32U);
+	}
+	dmar_qi_submit(dmar_uint, cmd, 0UL);
+}
+
+/*
+ * Interrupt remapping relies on queued invalidation for the interrupt
+ * entry cache. Compatibility format interrupts (IOAPIC, HPET and the
+ * DMAR fault event itself) keep bypassing the table.
+ */
+static void dmar_enable_intr_remapping(struct dmar_drhd_rt *dmar_uint)
+{
+	uint32_t status;
+
+	if ((iommu_ecap_ir(dmar_uint->ecap) == 0U) ||
+			!dmar_qi_enabled(dmar_uint)) {
+		return;
+	}
+
+	if (dmar_uint->ir_table == NULL) {
+		dmar_uint->ir_table =
+			(struct dmar_ir_entry *)alloc_paging_struct();
+		if (dmar_uint->ir_table == NULL) {
+			pr_err("failed to allocate interrupt remapping table");
+			return;
+		}
+	}
+
+	IOMMU_LOCK(dmar_uint);
+	iommu_write64(dmar_uint, DMAR_IRTA_REG,
+		HVA2HPA((void *)dmar_uint->ir_table) | IR_TABLE_SIZE_ORDER);
+	iommu_write32(dmar_uint, DMAR_GCMD_REG,
+		dmar_uint->gcmd | DMA_GCMD_SIRTP);
+	DMAR_WAIT_COMPLETION(DMAR_GSTS_REG, (status & DMA_GSTS_IRTPS) != 0U,
+			status);
+	IOMMU_UNLOCK(dmar_uint);
+
+	dmar_invalid_iec(dmar_uint, 0U, true);
+
+	IOMMU_LOCK(dmar_uint);
+	dmar_uint->gcmd |= DMA_GCMD_CFI;
+	iommu_write32(dmar_uint, DMAR_GCMD_REG, dmar_uint->gcmd);
+	DMAR_WAIT_COMPLETION(DMAR_GSTS_REG, (status & DMA_GSTS_CFIS) != 0U,
+			status);
+
+	dmar_uint->gcmd |= DMA_GCMD_IRE;
+	iommu_write32(dmar_uint, DMAR_GCMD_REG, dmar_uint->gcmd);
+	DMAR_WAIT_COMPLETION(DMAR_GSTS_REG, (status & DMA_GSTS_IRES) != 0U,
+			status);
+	IOMMU_UNLOCK(dmar_uint);
+}
+
+static void dmar_disable_intr_remapping(struct dmar_drhd_rt *dmar_uint)
+{
+	uint32_t status;
+
+	if ((dmar_uint->gcmd & DMA_GCMD_IRE) == 0U) {
+		return;
+	}
+
+	IOMMU_LOCK(dmar_uint);
+	dmar_uint->gcmd &= ~DMA_GCMD_IRE;
+	iommu_write32(dmar_uint, DMAR_GCMD_REG, dmar_uint->gcmd);
+	DMAR_WAIT_COMPLETION(DMAR_GSTS_REG, (status & DMA_GSTS_IRES) == 0U,
+			status);
+
+	dmar_uint->gcmd &= ~DMA_GCMD_CFI;
+	iommu_write32(dmar_uint, DMAR_GCMD_REG, dmar_uint->gcmd);
+	DMAR_WAIT_COMPLETION(DMAR_GSTS_REG, (status & DMA_GSTS_CFIS) == 0U,
+			status);
+	IOMMU_UNLOCK(dmar_uint);
+}
+
 static void dmar_fault_event_mask(struct dmar_drhd_rt *dmar_uint)
 {
 	IOMMU_LOCK(dmar_uint);
@@ -841,8 +1075,10 @@ static void dmar_enable(struct dmar_drhd_rt *dmar_uint)
 	dmar_setup_interrupt(dmar_uint);
 	dmar_write_buffer_flush(dmar_uint);
 	dmar_set_root_table(dmar_uint);
+	dmar_enable_qi(dmar_uint);
 	dmar_invalid_context_cache_global(dmar_uint);
 	dmar_invalid_iotlb_global(dmar_uint);
+	dmar_enable_intr_remapping(dmar_uint);
 	dmar_enable_translation(dmar_uint);
 }
 
@@ -852,6 +1088,9 @@ static void dmar_disable(struct dmar_drhd_rt *dmar_uint)
 		dmar_disable_translation(dmar_uint);
 	}
 
+	dmar_disable_intr_remapping(dmar_uint);
+	dmar_disable_qi(dmar_uint);
+
 	dmar_fault_event_mask(dmar_uint);
 }
 
@@ -917,6 +1156,36 @@ void destroy_iommu_domain(struct iommu_domain *domain)
 	free(domain);
 }
 
+/**
+ * Called once page tables were unlinked from the translation table of the
+ * domain, before they are freed. The units without page-walk coherency
+ * need the updated entries written back first. A domain-selective IOTLB
+ * invalidation also drops the paging-structure cache entries of the domain.
+ *
+ * @pre domain != NULL
+ */
+void iommu_flush_domain(const struct iommu_domain *domain)
+{
+	struct dmar_drhd_rt *dmar_uint;
+	struct list_head *pos;
+	bool wbinvd_done = false;
+
+	list_for_each(pos, &dmar_drhd_units) {
+		dmar_uint = list_entry(pos, struct dmar_drhd_rt, list);
+		if (dmar_uint->drhd->ignore) {
+			continue;
+		}
+
+		if ((iommu_ecap_c(dmar_uint->ecap) == 0U) && !wbinvd_done) {
+			CACHE_FLUSH_INVALIDATE_ALL();
+			wbinvd_done = true;
+		}
+		dmar_write_buffer_flush(dmar_uint);
+		dmar_invalid_iotlb(dmar_uint, domain->dom_id, 0UL, 0U, false,
+				DMAR_IIRG_DOMAIN);
+	}
+}
+
 static int add_iommu_device(struct iommu_domain *domain, uint16_t segment,
 		uint8_t bus, uint8_t devfun)
 {
@@ -1154,6 +1423,130 @@ int unassign_iommu_device(struct iommu_domain *domain, uint8_t bus,
 	return 0;
 }
 
+static struct dmar_drhd_rt *ir_dmar_unit(uint16_t bdf)
+{
+	struct dmar_drhd_rt *dmar_uint;
+
+	dmar_uint = device_to_dmaru(0U, (uint8_t)(bdf >> 8U),
+			(uint8_t)(bdf & 0xFFU));
+	if ((dmar_uint == NULL) || ((dmar_uint->gcmd & DMA_GCMD_IRE) == 0U)) {
+		return NULL;
+	}
+
+	return dmar_uint;
+}
+
+static void dmar_write_irte(struct dmar_drhd_rt *dmar_uint, uint16_t index,
+		uint64_t lower, uint64_t upper)
+{
+	struct dmar_ir_entry *irte = dmar_uint->ir_table + index;
+	uint64_t old_lower = irte->lower;
+	uint64_t old_upper = irte->upper;
+
+	/* hardware fetches the 128-bit entry at once, never let it see a
+	 * half updated one
+	 */
+	asm volatile("1: lock cmpxchg16b %0\n\t"
+			"jnz 1b"
+			: "+m" (*irte), "+a" (old_lower), "+d" (old_upper)
+			: "b" (lower), "c" (upper)
+			: "cc", "memory");
+
+	iommu_flush_cache(dmar_uint, irte, sizeof(struct dmar_ir_entry));
+	dmar_invalid_iec(dmar_uint, index, false);
+}
+
+bool iommu_intr_remapping_supported(uint16_t bdf)
+{
+	return (ir_dmar_unit(bdf) != NULL);
+}
+
+bool iommu_posted_intr_supported(uint16_t bdf)
+{
+	struct dmar_drhd_rt *dmar_uint = ir_dmar_unit(bdf);
+
+	return ((dmar_uint != NULL) && (iommu_cap_pi(dmar_uint->cap) != 0U));
+}
+
+int32_t iommu_alloc_irte(uint16_t bdf, uint16_t *index)
+{
+	struct dmar_drhd_rt *dmar_uint = ir_dmar_unit(bdf);
+	uint64_t idx;
+
+	if (dmar_uint == NULL) {
+		return -ENODEV;
+	}
+
+	IOMMU_LOCK(dmar_uint);
+	idx = ffz64_ex(dmar_uint->ir_bitmap, IR_TABLE_ENTRIES);
+	if (idx >= IR_TABLE_ENTRIES) {
+		IOMMU_UNLOCK(dmar_uint);
+		return -EBUSY;
+	}
+	bitmap_set_nolock((uint16_t)(idx & 0x3FUL),
+		&dmar_uint->ir_bitmap[idx >> 6U]);
+	IOMMU_UNLOCK(dmar_uint);
+
+	*index = (uint16_t)idx;
+	return 0;
+}
+
+void iommu_free_irte(uint16_t bdf, uint16_t index)
+{
+	struct dmar_drhd_rt *dmar_uint = ir_dmar_unit(bdf);
+
+	if ((dmar_uint == NULL) || (index >= IR_TABLE_ENTRIES)) {
+		return;
+	}
+
+	dmar_write_irte(dmar_uint, index, 0UL, 0UL);
+
+	IOMMU_LOCK(dmar_uint);
+	bitmap_clear_nolock((uint16_t)(index & 0x3FU),
+		&dmar_uint->ir_bitmap[index >> 6U]);
+	IOMMU_UNLOCK(dmar_uint);
+}
+
+void iommu_set_remapped_irte(uint16_t bdf, uint16_t index, uint32_t vector,
+		uint32_t dest, uint32_t delmode)
+{
+	struct dmar_drhd_rt *dmar_uint = ir_dmar_unit(bdf);
+	uint64_t lower;
+
+	if ((dmar_uint == NULL) || (index >= IR_TABLE_ENTRIES)) {
+		return;
+	}
+
+	/* logical destination with redirection hint, as for the
+	 * compatibility format programmed by ptdev_build_physical_msi
+	 */
+	lower = IRTE_PRESENT | IRTE_DEST_MODE_LOGIC | IRTE_REDIR_HINT |
+		((uint64_t)(delmode >> 8U) << IRTE_DELMODE_SHIFT) |
+		((uint64_t)(vector & 0xFFU) << IRTE_VECTOR_SHIFT) |
+		((uint64_t)(dest & 0xFFU) << IRTE_DEST_SHIFT);
+
+	dmar_write_irte(dmar_uint, index, lower, IRTE_SVT_ALL_BITS | bdf);
+}
+
+void iommu_set_posted_irte(uint16_t bdf, uint16_t index, uint32_t vector,
+		uint64_t pid_addr)
+{
+	struct dmar_drhd_rt *dmar_uint = ir_dmar_unit(bdf);
+	uint64_t lower, upper;
+
+	if ((dmar_uint == NULL) || (index >= IR_TABLE_ENTRIES)) {
+		return;
+	}
+
+	lower = IRTE_PRESENT | IRTE_POSTED |
+		((uint64_t)(vector & 0xFFU) << IRTE_VECTOR_SHIFT) |
+		((pid_addr & IRTE_PDA_LOW_MASK) << IRTE_PDA_LOW_SHIFT);
+	upper = IRTE_SVT_ALL_BITS | bdf |
+		((pid_addr >> 32U) << IRTE_PDA_HIGH_SHIFT);
+
+	dmar_write_irte(dmar_uint, index, lower, upper);
+}
+
 void enable_iommu(void)
 {
 	struct dmar_drhd_rt *dmar_uint;
@@ -1214,6 +1607,10 @@ void suspend_iommu(void)
 		/* disable translation */
 		dmar_disable_translation(dmar_unit);
 
+		/* the queue and remapping table are set up again on resume */
+		dmar_disable_intr_remapping(dmar_unit);
+		dmar_disable_qi(dmar_unit);
+
 		/* If the number of real iommu devices is larger than we
 		 * defined in kconfig.
 		 */
@@ -1241,6 +1638,7 @@ void resume_iommu(void)
 
 		/* set root table */
 		dmar_set_root_table(dmar_unit);
+		dmar_enable_qi(dmar_unit);
 
 		/* flush */
 		dmar_write_buffer_flush(dmar_unit);
@@ -1253,7 +1651,8 @@ void resume_iommu(void)
 				(i * IOMMU_FAULT_REGISTER_STATE_NUM),
 				iommu_fault_state[iommu_idx][i]);
 		}
-		/* enable translation */
+		/* enable interrupt remapping and translation */
+		dmar_enable_intr_remapping(dmar_unit);
 		dmar_enable_translation(dmar_unit);
 
 		/* If the number of real iommu devices is larger than we
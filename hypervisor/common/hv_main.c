@@ -59,13 +59,15 @@ void vcpu_thread(struct vcpu *vcpu)
 			continue;
 		}
 
-#ifdef HV_DEBUG
 		vmexit_end = rdtsc();
 		if (vmexit_begin != 0UL) {
+			vmexit_account(vcpu, basic_exit_reason,
+					vmexit_end - vmexit_begin);
+#ifdef HV_DEBUG
 			per_cpu(vmexit_time, vcpu->pcpu_id)[basic_exit_reason]
 				+= (vmexit_end - vmexit_begin);
-		}
 #endif
+		}
 		TRACE_2L(TRACE_VM_ENTER, 0UL, 0UL);
 
 		/* Restore guest TSC_AUX */
@@ -74,16 +76,22 @@ void vcpu_thread(struct vcpu *vcpu)
 					vcpu->msr_tsc_aux_guest);
 		}
 
+		/*
+		 * No VM pointer is held across VM entry. vm_qs_seq stays odd
+		 * while in guest mode, which counts as a quiescent state.
+		 */
+		per_cpu(vm_qs_seq, vcpu->pcpu_id)++;
 		ret = start_vcpu(vcpu);
+		per_cpu(vm_qs_seq, vcpu->pcpu_id)++;
+		/* seen by unpublish_vm() before any later VM lookup */
+		CPU_MEMORY_BARRIER();
 		if (ret != 0) {
 			pr_fatal("vcpu resume failed");
 			pause_vcpu(vcpu, VCPU_ZOMBIE);
 			continue;
 		}
 
-#ifdef HV_DEBUG
 		vmexit_begin = rdtsc();
-#endif
 
 		vcpu->arch_vcpu.nrexits++;
 		/* Save guest TSC_AUX */
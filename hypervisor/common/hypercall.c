@@ -188,6 +188,7 @@ int32_t hcall_create_vm(struct vm *vm, uint64_t param)
 	(void)memset(&vm_desc, 0U, sizeof(vm_desc));
 	vm_desc.sworld_supported =
 		((cv.vm_flag & (SECURE_WORLD_ENABLED)) != 0U);
+	vm_desc.rt_sched = ((cv.vm_flag & (RT_SCHED_ENABLED)) != 0U);
 	(void)memcpy_s(&vm_desc.GUID[0], 16U, &cv.GUID[0], 16U);
 	ret = create_vm(&vm_desc, &target_vm);
 
@@ -289,6 +290,42 @@ int32_t hcall_reset_vm(uint16_t vmid)
 	return 0;
 }
 
+int32_t hcall_get_vcpu_exit_stats(struct vm *vm, uint16_t vmid,
+		uint64_t param)
+{
+	struct acrn_vmexit_stats stats_hdr;
+	struct vcpu *vcpu;
+	struct vm *target_vm = get_vm_from_vmid(vmid);
+
+	if (target_vm == NULL) {
+		return -1;
+	}
+
+	if (copy_from_gpa(vm, &stats_hdr, param,
+			offsetof(struct acrn_vmexit_stats, reasons)) != 0) {
+		pr_err("%s: Unable copy param from vm\n", __func__);
+		return -1;
+	}
+
+	vcpu = vcpu_from_vid(target_vm, stats_hdr.vcpu_id);
+	if (vcpu == NULL) {
+		return -1;
+	}
+	stats_hdr.pcpu_id = vcpu->pcpu_id;
+
+	/* Too large for the stack, the reasons are copied from the vcpu */
+	if ((copy_to_gpa(vm, &stats_hdr, param,
+			offsetof(struct acrn_vmexit_stats, reasons)) != 0) ||
+			(copy_to_gpa(vm, vcpu->exit_stats, param +
+			offsetof(struct acrn_vmexit_stats, reasons),
+			sizeof(vcpu->exit_stats)) != 0)) {
+		pr_err("%s: Unable copy param to vm\n", __func__);
+		return -1;
+	}
+
+	return 0;
+}
+
 int32_t hcall_assert_irqline(struct vm *vm, uint16_t vmid, uint64_t param)
 {
 	int32_t ret = 0;
@@ -417,6 +454,221 @@ int32_t hcall_notify_ioreq_finish(uint16_t vmid, uint16_t vcpu_id)
 	return 0;
 }
 
+/* Number of multicall records copied in and out of the guest at a time */
+#define MULTICALL_CHUNK_ENTRIES	16U
+
+static int32_t multicall_run_entry(struct vm *vm, struct vm *target_vm,
+		struct acrn_multicall_entry *entry)
+{
+	int32_t ret;
+
+	switch (entry->op) {
+	case ACRN_MULTICALL_ASSERT_IRQLINE:
+		ret = handle_virt_irqline(vm, target_vm->vm_id,
+				&entry->param.irqline, IRQ_ASSERT);
+		break;
+	case ACRN_MULTICALL_DEASSERT_IRQLINE:
+		ret = handle_virt_irqline(vm, target_vm->vm_id,
+				&entry->param.irqline, IRQ_DEASSERT);
+		break;
+	case ACRN_MULTICALL_PULSE_IRQLINE:
+		ret = handle_virt_irqline(vm, target_vm->vm_id,
+				&entry->param.irqline, IRQ_PULSE);
+		break;
+	case ACRN_MULTICALL_INJECT_MSI:
+		ret = vlapic_intr_msi(target_vm, entry->param.msi.msi_addr,
+				entry->param.msi.msi_data);
+		break;
+	case ACRN_MULTICALL_NOTIFY_FINISH:
+		ret = hcall_notify_ioreq_finish(target_vm->vm_id,
+				entry->param.vcpu_id);
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	return ret;
+}
+
+int32_t hcall_multicall(struct vm *vm, uint64_t param)
+{
+	struct acrn_multicall mc;
+	struct acrn_multicall_entry entries[MULTICALL_CHUNK_ENTRIES];
+	struct vm *target_vm;
+	uint64_t gpa;
+	uint32_t done, num, size, i;
+
+	(void)memset((void *)&mc, 0U, sizeof(mc));
+	if (copy_from_gpa(vm, &mc, param, sizeof(mc)) != 0) {
+		pr_err("%s: Unable copy param from vm\n", __func__);
+		return -EFAULT;
+	}
+
+	target_vm = get_vm_from_vmid(mc.vmid);
+	if ((target_vm == NULL) ||
+			(mc.entry_num > ACRN_MULTICALL_MAX_ENTRIES)) {
+		return -EINVAL;
+	}
+
+	done = 0U;
+	while (done < mc.entry_num) {
+		num = mc.entry_num - done;
+		if (num > MULTICALL_CHUNK_ENTRIES) {
+			num = MULTICALL_CHUNK_ENTRIES;
+		}
+		size = num * (uint32_t)sizeof(struct acrn_multicall_entry);
+		gpa = mc.entries_gpa +
+			(done * sizeof(struct acrn_multicall_entry));
+
+		if (copy_from_gpa(vm, entries, gpa, size) != 0) {
+			pr_err("%s: Unable copy entries from vm\n", __func__);
+			return -EFAULT;
+		}
+
+		for (i = 0U; i < num; i++) {
+			entries[i].result = multicall_run_entry(vm, target_vm,
+					&entries[i]);
+		}
+
+		if (copy_to_gpa(vm, entries, gpa, size) != 0) {
+			pr_err("%s: Unable copy entries to vm\n", __func__);
+			return -EFAULT;
+		}
+		done += num;
+	}
+
+	return 0;
+}
+
+int32_t hcall_set_posted_ring(struct vm *vm, uint16_t vmid, uint64_t param)
+{
+	uint64_t hpa;
+	struct acrn_set_ioreq_buffer iobuf;
+	struct vm *target_vm = get_vm_from_vmid(vmid);
+	struct vm_posted_io *posted_io;
+	struct vhm_posted_ring *ring;
+
+	if (target_vm == NULL) {
+		return -1;
+	}
+
+	(void)memset((void *)&iobuf, 0U, sizeof(iobuf));
+
+	if (copy_from_gpa(vm, &iobuf, param, sizeof(iobuf)) != 0) {
+		pr_err("%s: Unable copy param to vm\n", __func__);
+		return -1;
+	}
+
+	dev_dbg(ACRN_DBG_HYCALL, "[%d] SET POSTED RING=0x%p",
+			vmid, iobuf.req_buf);
+
+	/* The ring is one page, so it must not cross a page boundary */
+	hpa = gpa2hpa(vm, iobuf.req_buf);
+	if ((hpa == 0UL) || ((iobuf.req_buf & (CPU_PAGE_SIZE - 1UL)) != 0UL)) {
+		pr_err("%s: invalid GPA.\n", __func__);
+		return -EINVAL;
+	}
+
+	ring = HPA2HVA(hpa);
+	posted_io = &target_vm->posted_io;
+
+	spinlock_obtain(&posted_io->lock);
+	posted_io->tail = 0U;
+	atomic_store32(&ring->head, 0U);
+	atomic_store32(&ring->tail, 0U);
+	posted_io->ring = ring;
+	spinlock_release(&posted_io->lock);
+
+	return 0;
+}
+
+int32_t hcall_set_posted_range(struct vm *vm, uint16_t vmid, uint64_t param)
+{
+	struct acrn_posted_range range;
+	struct vm *target_vm = get_vm_from_vmid(vmid);
+
+	if (target_vm == NULL) {
+		return -1;
+	}
+
+	(void)memset((void *)&range, 0U, sizeof(range));
+
+	if (copy_from_gpa(vm, &range, param, sizeof(range)) != 0) {
+		pr_err("%s: Unable copy param to vm\n", __func__);
+		return -1;
+	}
+
+	dev_dbg(ACRN_DBG_HYCALL, "[%d] %s POSTED RANGE type %d [0x%llx, 0x%llx)",
+			vmid, (range.set != 0U) ? "SET" : "CLEAR",
+			range.type, range.start, range.end);
+
+	return set_posted_range(target_vm, &range);
+}
+
+int32_t hcall_set_doorbell_page(struct vm *vm, uint16_t vmid, uint64_t param)
+{
+	uint64_t hpa;
+	struct acrn_set_ioreq_buffer iobuf;
+	struct vm *target_vm = get_vm_from_vmid(vmid);
+	struct vm_doorbells *doorbells;
+	union acrn_doorbell_page *page;
+
+	if (target_vm == NULL) {
+		return -1;
+	}
+
+	(void)memset((void *)&iobuf, 0U, sizeof(iobuf));
+
+	if (copy_from_gpa(vm, &iobuf, param, sizeof(iobuf)) != 0) {
+		pr_err("%s: Unable copy param to vm\n", __func__);
+		return -1;
+	}
+
+	dev_dbg(ACRN_DBG_HYCALL, "[%d] SET DOORBELL PAGE=0x%p",
+			vmid, iobuf.req_buf);
+
+	hpa = gpa2hpa(vm, iobuf.req_buf);
+	if ((hpa == 0UL) || ((iobuf.req_buf & (CPU_PAGE_SIZE - 1UL)) != 0UL)) {
+		pr_err("%s: invalid GPA.\n", __func__);
+		return -EINVAL;
+	}
+
+	page = HPA2HVA(hpa);
+	doorbells = &target_vm->doorbells;
+
+	spinlock_obtain(&doorbells->lock);
+	(void)memset((void *)page->pending, 0U, sizeof(page->pending));
+	doorbells->page = page;
+	spinlock_release(&doorbells->lock);
+
+	return 0;
+}
+
+int32_t hcall_set_doorbell(struct vm *vm, uint16_t vmid, uint64_t param)
+{
+	struct acrn_doorbell doorbell;
+	struct vm *target_vm = get_vm_from_vmid(vmid);
+
+	if (target_vm == NULL) {
+		return -1;
+	}
+
+	(void)memset((void *)&doorbell, 0U, sizeof(doorbell));
+
+	if (copy_from_gpa(vm, &doorbell, param, sizeof(doorbell)) != 0) {
+		pr_err("%s: Unable copy param to vm\n", __func__);
+		return -1;
+	}
+
+	dev_dbg(ACRN_DBG_HYCALL, "[%d] %s DOORBELL %hu type %d 0x%llx/%d",
+			vmid, ((doorbell.flags & ACRN_DOORBELL_ASSIGN) != 0U) ?
+			"SET" : "CLEAR", doorbell.index, doorbell.type,
+			doorbell.address, doorbell.size);
+
+	return set_doorbell(target_vm, &doorbell);
+}
+
 static int32_t local_set_vm_memory_region(struct vm *vm,
 	struct vm *target_vm, struct vm_memory_region *region)
 {
@@ -513,6 +765,7 @@ int32_t hcall_set_vm_memory_regions(struct vm *vm, uint64_t param)
 	struct vm_memory_region *regions;
 	struct vm *target_vm;
 	uint32_t idx;
+	int ret = 0;
 
 	if (!is_vm0(vm)) {
 		pr_err("%s: Not coming from service vm", __func__);
@@ -535,17 +788,21 @@ int32_t hcall_set_vm_memory_regions(struct vm *vm, uint64_t param)
 	idx = 0U;
 	/*TODO: use copy_from_gpa for this buffer page */
 	regions = GPA2HVA(vm, set_regions.regions_gpa);
+	/* Flush the EPT TLB of the target VM once for all the regions */
+	ept_batch_begin(target_vm);
 	while (idx < set_regions.mr_num) {
 		/* the force pointer change below is for back compatible
 		 * to struct vm_memory_region, it will be removed in the future
 		 */
-		int ret = local_set_vm_memory_region(vm, target_vm, &regions[idx]);
+		ret = local_set_vm_memory_region(vm, target_vm, &regions[idx]);
 		if (ret < 0) {
-			return ret;
+			break;
 		}
 		idx++;
 	}
-	return 0;
+	ept_batch_end(target_vm);
+
+	return ret;
 }
 
 static int32_t write_protect_page(struct vm *vm, struct wp_data *wp)
@@ -849,6 +1106,28 @@ int32_t hcall_setup_hv_npk_log(__unused struct vm *vm, __unused uint64_t param)
 }
 #endif
 
+#ifdef HV_DEBUG
+int32_t hcall_setup_trace_filter(struct vm *vm, uint64_t param)
+{
+	struct trace_filter_param tfp;
+
+	if (copy_from_gpa(vm, &tfp, param, sizeof(tfp)) != 0) {
+		pr_err("%s: Unable copy param from vm\n", __func__);
+		return -1;
+	}
+
+	trace_filter_setup(&tfp);
+
+	return 0;
+}
+#else
+int32_t hcall_setup_trace_filter(__unused struct vm *vm,
+		__unused uint64_t param)
+{
+	return -ENODEV;
+}
+#endif
+
 int32_t hcall_get_cpu_pm_state(struct vm *vm, uint64_t cmd, uint64_t param)
 {
 	uint16_t target_vm_id;
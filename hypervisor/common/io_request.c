@@ -101,6 +101,304 @@ acrn_insert_request_wait(struct vcpu *vcpu, struct io_request *io_req)
 	return 0;
 }
 
+static bool is_posted_range(struct vm_posted_io *posted_io, uint32_t type,
+		uint64_t address, uint64_t size)
+{
+	struct posted_range *range;
+	uint32_t i;
+
+	for (i = 0U; i < posted_io->range_num; i++) {
+		range = &posted_io->ranges[i];
+		if ((range->type == type) && (address >= range->start) &&
+				((address + size) <= range->end)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Queue a write to a posted range of the VM into its posted write ring, so
+ * that the vcpu can resume without waiting for the device model.
+ *
+ * @return 0       - The write is posted.
+ * @return -ENODEV - The request is not a write to a posted range.
+ * @return -EBUSY  - The ring is full, the request shall go through
+ *                   acrn_insert_request_wait().
+ */
+int32_t
+acrn_insert_posted_request(struct vcpu *vcpu, struct io_request *io_req)
+{
+	struct vm_posted_io *posted_io = &vcpu->vm->posted_io;
+	struct vhm_posted_ring *ring;
+	struct vhm_posted_request *entry;
+	uint64_t address, size, value;
+	uint32_t direction, tail;
+	bool kick = false;
+	int32_t ret;
+
+	switch (io_req->type) {
+	case REQ_PORTIO:
+		direction = io_req->reqs.pio.direction;
+		address = io_req->reqs.pio.address;
+		size = io_req->reqs.pio.size;
+		value = io_req->reqs.pio.value;
+		break;
+	case REQ_MMIO:
+		direction = io_req->reqs.mmio.direction;
+		address = io_req->reqs.mmio.address;
+		size = io_req->reqs.mmio.size;
+		value = io_req->reqs.mmio.value;
+		break;
+	default:
+		return -ENODEV;
+	}
+
+	/* Unlocked peek at range_num keeps VMs without posted ranges fast */
+	if ((direction != REQUEST_WRITE) || (posted_io->range_num == 0U)) {
+		return -ENODEV;
+	}
+
+	spinlock_obtain(&posted_io->lock);
+	ring = posted_io->ring;
+	if ((ring == NULL) ||
+		!is_posted_range(posted_io, io_req->type, address, size)) {
+		ret = -ENODEV;
+	} else {
+		tail = posted_io->tail;
+		if ((tail - atomic_load32(&ring->head)) >=
+				VHM_POSTED_REQUEST_MAX) {
+			posted_io->ring_full++;
+			ret = -EBUSY;
+		} else {
+			entry = &ring->entries[tail % VHM_POSTED_REQUEST_MAX];
+			entry->type = io_req->type;
+			entry->vcpu = vcpu->vcpu_id;
+			entry->address = address;
+			entry->size = size;
+			entry->value = value;
+
+			/* The entry is visible before the tail moves past it */
+			posted_io->tail = tail + 1U;
+			atomic_store32(&ring->tail, posted_io->tail);
+
+			/* Order the tail store before the head load, which
+			 * pairs with the consumer advancing head then reading
+			 * back tail, so that a consumer going idle is always
+			 * kicked.
+			 */
+			CPU_MEMORY_BARRIER();
+			kick = (atomic_load32(&ring->head) == tail);
+
+			posted_io->posted++;
+			ret = 0;
+		}
+	}
+	spinlock_release(&posted_io->lock);
+
+	if (kick) {
+		fire_vhm_interrupt();
+	}
+
+	return ret;
+}
+
+/**
+ * Add or remove a posted write range of the VM.
+ *
+ * @return 0 on success, -EINVAL on an invalid or overlapping range or if the
+ * range to remove is not found, -ENOMEM if the VM has too many posted ranges.
+ */
+int32_t set_posted_range(struct vm *vm, struct acrn_posted_range *range)
+{
+	struct vm_posted_io *posted_io = &vm->posted_io;
+	struct posted_range *cur;
+	int32_t ret = 0;
+	uint32_t i;
+
+	if (((range->type != REQ_PORTIO) && (range->type != REQ_MMIO)) ||
+			(range->start >= range->end)) {
+		return -EINVAL;
+	}
+
+	spinlock_obtain(&posted_io->lock);
+	if (range->set != 0U) {
+		for (i = 0U; i < posted_io->range_num; i++) {
+			cur = &posted_io->ranges[i];
+			if ((cur->type == range->type) &&
+					(range->start < cur->end) &&
+					(cur->start < range->end)) {
+				ret = -EINVAL;
+				break;
+			}
+		}
+
+		if ((ret == 0) && (posted_io->range_num >= MAX_POSTED_RANGE_NUM)) {
+			ret = -ENOMEM;
+		}
+
+		if (ret == 0) {
+			cur = &posted_io->ranges[posted_io->range_num];
+			cur->type = range->type;
+			cur->start = range->start;
+			cur->end = range->end;
+			posted_io->range_num++;
+		}
+	} else {
+		ret = -EINVAL;
+		for (i = 0U; i < posted_io->range_num; i++) {
+			cur = &posted_io->ranges[i];
+			if ((cur->type == range->type) &&
+					(cur->start == range->start) &&
+					(cur->end == range->end)) {
+				posted_io->range_num--;
+				*cur = posted_io->ranges[posted_io->range_num];
+				ret = 0;
+				break;
+			}
+		}
+	}
+	spinlock_release(&posted_io->lock);
+
+	return ret;
+}
+
+/**
+ * Complete a write to a doorbell of the VM by setting the bit of the doorbell
+ * in the doorbell page. VHM is only kicked when the bit was clear.
+ *
+ * @return 0       - Successful.
+ * @return -ENODEV - The request is not a write to a doorbell.
+ */
+int32_t acrn_ring_doorbell(struct vcpu *vcpu, struct io_request *io_req)
+{
+	struct vm_doorbells *doorbells = &vcpu->vm->doorbells;
+	struct doorbell *db;
+	uint64_t address, size, value;
+	uint32_t direction, i;
+	bool kick = false;
+	int32_t ret = -ENODEV;
+
+	switch (io_req->type) {
+	case REQ_PORTIO:
+		direction = io_req->reqs.pio.direction;
+		address = io_req->reqs.pio.address;
+		size = io_req->reqs.pio.size;
+		/* a port write carries the whole RAX, keep the written bytes */
+		value = io_req->reqs.pio.value &
+			(0xFFFFFFFFUL >> (32UL - (8UL * size)));
+		break;
+	case REQ_MMIO:
+		direction = io_req->reqs.mmio.direction;
+		address = io_req->reqs.mmio.address;
+		size = io_req->reqs.mmio.size;
+		value = io_req->reqs.mmio.value;
+		break;
+	default:
+		return -ENODEV;
+	}
+
+	/* Unlocked peek at num keeps VMs without doorbells fast */
+	if ((direction != REQUEST_WRITE) || (doorbells->num == 0U)) {
+		return -ENODEV;
+	}
+
+	spinlock_obtain(&doorbells->lock);
+	if (doorbells->page != NULL) {
+		for (i = 0U; i < doorbells->num; i++) {
+			db = &doorbells->entries[i];
+			if ((db->type == io_req->type) &&
+					(db->address == address) &&
+					(db->size == size) &&
+					(!db->datamatch || (db->data == value))) {
+				kick = !bitmap_test_and_set_lock(
+					db->index & 0x3fU,
+					&doorbells->page->pending[db->index >> 6U]);
+				ret = 0;
+				break;
+			}
+		}
+	}
+	spinlock_release(&doorbells->lock);
+
+	if (kick) {
+		fire_vhm_interrupt();
+	}
+
+	return ret;
+}
+
+/**
+ * Add or remove a doorbell of the VM. A doorbell is removed by its index.
+ *
+ * @return 0 on success, -EINVAL on an invalid doorbell, a doorbell which
+ * index or write is already used, or if the doorbell to remove is not found,
+ * -ENOMEM if the VM has too many doorbells.
+ */
+int32_t set_doorbell(struct vm *vm, struct acrn_doorbell *doorbell)
+{
+	struct vm_doorbells *doorbells = &vm->doorbells;
+	struct doorbell *cur;
+	bool datamatch = ((doorbell->flags & ACRN_DOORBELL_DATAMATCH) != 0U);
+	int32_t ret = 0;
+	uint32_t i;
+
+	if (doorbell->index >= ACRN_DOORBELL_MAX) {
+		return -EINVAL;
+	}
+
+	spinlock_obtain(&doorbells->lock);
+	if ((doorbell->flags & ACRN_DOORBELL_ASSIGN) != 0U) {
+		if (((doorbell->type != REQ_PORTIO) &&
+				(doorbell->type != REQ_MMIO)) ||
+				((doorbell->size != 1U) && (doorbell->size != 2U) &&
+				(doorbell->size != 4U) && (doorbell->size != 8U))) {
+			ret = -EINVAL;
+		}
+
+		for (i = 0U; (ret == 0) && (i < doorbells->num); i++) {
+			cur = &doorbells->entries[i];
+			if ((cur->index == doorbell->index) ||
+					((cur->type == doorbell->type) &&
+					(cur->address == doorbell->address) &&
+					(!cur->datamatch || !datamatch ||
+					(cur->data == doorbell->data)))) {
+				ret = -EINVAL;
+			}
+		}
+
+		if ((ret == 0) && (doorbells->num >= MAX_DOORBELL_NUM)) {
+			ret = -ENOMEM;
+		}
+
+		if (ret == 0) {
+			cur = &doorbells->entries[doorbells->num];
+			cur->type = doorbell->type;
+			cur->index = doorbell->index;
+			cur->size = doorbell->size;
+			cur->datamatch = datamatch;
+			cur->address = doorbell->address;
+			cur->data = doorbell->data;
+			doorbells->num++;
+		}
+	} else {
+		ret = -EINVAL;
+		for (i = 0U; i < doorbells->num; i++) {
+			cur = &doorbells->entries[i];
+			if (cur->index == doorbell->index) {
+				doorbells->num--;
+				*cur = doorbells->entries[doorbells->num];
+				ret = 0;
+				break;
+			}
+		}
+	}
+	spinlock_release(&doorbells->lock);
+
+	return ret;
+}
+
 #ifdef HV_DEBUG
 static void local_get_req_info_(struct vhm_request *req, int *id, char *type,
 	char *state, char *dir, uint64_t *addr, uint64_t *val)
@@ -8,53 +8,95 @@
 #include <softirq.h>
 #include <ptdev.h>
 
-/* SOFTIRQ_PTDEV list for all CPUs */
-static struct list_head softirq_dev_entry_list;
 /* passthrough device link */
 struct list_head ptdev_list;
-spinlock_t ptdev_lock;
+mcs_spinlock_t ptdev_lock;
 
 /*
- * entry could both be in ptdev_list and softirq_dev_entry_list.
- * When release entry, we need make sure entry deleted from both
- * lists. We have to require two locks and the lock sequence is:
- *   ptdev_lock
- *     softirq_dev_lock
+ * Each pcpu queues the entries whose interrupt it received and drains
+ * them in its own SOFTIRQ_PTDEV, so high-rate devices on different pcpus
+ * never contend. The interrupt handler pushes to per_cpu(ptdev_softirq_head)
+ * without lock, the softirq takes the whole stack at once into its private
+ * FIFO per_cpu(ptdev_softirq_fifo).
+ *
+ * An entry is queued at most once, tracked by PTDEV_SOFTIRQ_QUEUED. As it
+ * cannot be unlinked from a lock-free queue, releasing a queued entry only
+ * marks it PTDEV_SOFTIRQ_RELEASED and the draining pcpu frees it. ptdev_lock
+ * is the only lock taken, so the lock order is unchanged.
  */
-static spinlock_t softirq_dev_lock;
+#define PTDEV_SOFTIRQ_QUEUED	(1U << 0U)
+#define PTDEV_SOFTIRQ_RELEASED	(1U << 1U)
 
+/* interrupt context */
 static void ptdev_enqueue_softirq(struct ptdev_remapping_info *entry)
 {
-	uint64_t rflags;
-
-	/* enqueue request in order, SOFTIRQ_PTDEV will pickup */
-	spinlock_irqsave_obtain(&softirq_dev_lock, &rflags);
+	uint64_t *head = (uint64_t *)&get_cpu_var(ptdev_softirq_head);
+	uint64_t first;
+	uint32_t state;
 
 	/* avoid adding recursively */
-	list_del(&entry->softirq_node);
-	/* TODO: assert if entry already in list */
-	list_add_tail(&entry->softirq_node,
-			&softirq_dev_entry_list);
-	spinlock_irqrestore_release(&softirq_dev_lock, rflags);
+	do {
+		state = atomic_load32(&entry->softirq_state);
+		if (state != 0U) {
+			return;
+		}
+	} while (atomic_cmpxchg32(&entry->softirq_state, state,
+			PTDEV_SOFTIRQ_QUEUED) != state);
+
+	do {
+		first = atomic_load64(head);
+		entry->softirq_next = (struct ptdev_remapping_info *)first;
+	} while (atomic_cmpxchg64(head, first, (uint64_t)entry) != first);
+
 	fire_softirq(SOFTIRQ_PTDEV);
 }
 
-struct ptdev_remapping_info*
-ptdev_dequeue_softirq(void)
+/* take all entries queued on the pcpu, in arrival order */
+static struct ptdev_remapping_info *ptdev_take_softirq(uint16_t pcpu_id)
 {
-	uint64_t rflags;
-	struct ptdev_remapping_info *entry = NULL;
+	uint64_t *head = (uint64_t *)&per_cpu(ptdev_softirq_head, pcpu_id);
+	struct ptdev_remapping_info *entry, *next, *fifo = NULL;
+
+	entry = (struct ptdev_remapping_info *)atomic_swap64(head, 0UL);
+	while (entry != NULL) {
+		next = entry->softirq_next;
+		entry->softirq_next = fifo;
+		fifo = entry;
+		entry = next;
+	}
 
-	spinlock_irqsave_obtain(&softirq_dev_lock, &rflags);
+	return fifo;
+}
 
-	if (!list_empty(&softirq_dev_entry_list)) {
-		entry = get_first_item(&softirq_dev_entry_list,
-			struct ptdev_remapping_info, softirq_node);
-		list_del_init(&entry->softirq_node);
+struct ptdev_remapping_info*
+ptdev_dequeue_softirq(uint16_t pcpu_id)
+{
+	struct ptdev_remapping_info *entry;
+	uint32_t state;
+
+	while (true) {
+		entry = (struct ptdev_remapping_info *)
+			per_cpu(ptdev_softirq_fifo, pcpu_id);
+		if (entry == NULL) {
+			entry = ptdev_take_softirq(pcpu_id);
+			if (entry == NULL) {
+				return NULL;
+			}
+		}
+		per_cpu(ptdev_softirq_fifo, pcpu_id) = entry->softirq_next;
+		entry->softirq_next = NULL;
+
+		/* a new interrupt may queue the entry again from now on */
+		do {
+			state = atomic_load32(&entry->softirq_state);
+		} while (atomic_cmpxchg32(&entry->softirq_state, state,
+				state & ~PTDEV_SOFTIRQ_QUEUED) != state);
+
+		if ((state & PTDEV_SOFTIRQ_RELEASED) == 0U) {
+			return entry;
+		}
+		free(entry);
 	}
-
-	spinlock_irqrestore_release(&softirq_dev_lock, rflags);
-	return entry;
 }
 
 /* require ptdev_lock protect */
@@ -68,8 +110,8 @@ alloc_entry(struct vm *vm, uint32_t intr_type)
 	ASSERT(entry != NULL, "alloc memory failed");
 	entry->intr_type = intr_type;
 	entry->vm = vm;
+	entry->irte_idx = INVALID_IRTE_INDEX;
 
-	INIT_LIST_HEAD(&entry->softirq_node);
 	INIT_LIST_HEAD(&entry->entry_node);
 
 	atomic_clear32(&entry->active, ACTIVE_FLAG);
@@ -82,20 +124,24 @@ alloc_entry(struct vm *vm, uint32_t intr_type)
 void
 release_entry(struct ptdev_remapping_info *entry)
 {
-	uint64_t rflags;
+	uint32_t state;
 
 	/* remove entry from ptdev_list */
 	list_del_init(&entry->entry_node);
 
-	/*
-	 * remove entry from softirq list.the ptdev_lock
-	 * is required before calling release_entry.
-	 */
-	spinlock_irqsave_obtain(&softirq_dev_lock, &rflags);
-	list_del_init(&entry->softirq_node);
-	spinlock_irqrestore_release(&softirq_dev_lock, rflags);
+	if (entry->irte_idx != INVALID_IRTE_INDEX) {
+		iommu_free_irte(entry->phys_sid.msi_id.bdf, entry->irte_idx);
+	}
+
+	/* an entry still in a softirq queue is freed by the pcpu draining it */
+	do {
+		state = atomic_load32(&entry->softirq_state);
+	} while (atomic_cmpxchg32(&entry->softirq_state, state,
+			state | PTDEV_SOFTIRQ_RELEASED) != state);
 
-	free(entry);
+	if ((state & PTDEV_SOFTIRQ_QUEUED) == 0U) {
+		free(entry);
+	}
 }
 
 /* require ptdev_lock protect */
@@ -141,17 +187,11 @@ ptdev_activate_entry(struct ptdev_remapping_info *entry, uint32_t phys_irq)
 void
 ptdev_deactivate_entry(struct ptdev_remapping_info *entry)
 {
-	uint64_t rflags;
-
+	/* a queued inactive entry is skipped by ptdev_softirq */
 	atomic_clear32(&entry->active, ACTIVE_FLAG);
 
 	free_irq(entry->allocated_pirq);
 	entry->allocated_pirq = IRQ_INVALID;
-
-	/* remove from softirq list if added */
-	spinlock_irqsave_obtain(&softirq_dev_lock, &rflags);
-	list_del_init(&entry->softirq_node);
-	spinlock_irqrestore_release(&softirq_dev_lock, rflags);
 }
 
 void ptdev_init(void)
@@ -160,9 +200,7 @@ void ptdev_init(void)
 		return;
 
 	INIT_LIST_HEAD(&ptdev_list);
-	spinlock_init(&ptdev_lock);
-	INIT_LIST_HEAD(&softirq_dev_entry_list);
-	spinlock_init(&softirq_dev_lock);
+	mcs_spinlock_init(&ptdev_lock);
 
 	register_softirq(SOFTIRQ_PTDEV, ptdev_softirq);
 }
@@ -170,7 +208,7 @@ void ptdev_init(void)
 void ptdev_release_all_entries(struct vm *vm)
 {
 	/* VM already down */
-	spinlock_obtain(&ptdev_lock);
+	mcs_spinlock_obtain(&ptdev_lock);
 	release_all_entries(vm);
-	spinlock_release(&ptdev_lock);
+	mcs_spinlock_release(&ptdev_lock);
 }
@@ -6,8 +6,112 @@
 
 #include <hypervisor.h>
 #include <schedule.h>
+#include <softirq.h>
 
-static unsigned long pcpu_used_bitmap;
+/* pcpus whose vcpus were assigned explicitly, never shared */
+static uint64_t pcpu_exclusive_bitmap;
+/* To protect pcpu assignment */
+static spinlock_t pcpu_alloc_lock = {
+	.head = 0U,
+	.tail = 0U
+};
+
+/*
+ * Fixed-priority RT policy: the runnable RT vcpu with the highest
+ * priority runs, vcpus of equal priority are time sliced round-robin.
+ */
+static struct vcpu *rt_pick_next(struct sched_context *ctx)
+{
+	struct list_head *pos;
+	struct vcpu *vcpu, *next = NULL;
+
+	list_for_each(pos, &ctx->runqueue) {
+		vcpu = list_entry(pos, struct vcpu, run_list);
+		if ((vcpu->sched_policy == &sched_rt_policy) &&
+			((next == NULL) ||
+			(vcpu->sched_prio > next->sched_prio))) {
+			next = vcpu;
+		}
+	}
+
+	return next;
+}
+
+static void rt_enqueue(__unused struct sched_context *ctx,
+		__unused struct vcpu *vcpu)
+{
+}
+
+static void rt_charge(__unused struct sched_context *ctx,
+		__unused struct vcpu *vcpu, __unused uint64_t cycles)
+{
+}
+
+struct sched_policy sched_rt_policy = {
+	.name = "rt",
+	.pick_next = rt_pick_next,
+	.enqueue = rt_enqueue,
+	.charge = rt_charge,
+};
+
+/*
+ * Fair-share policy: the runnable vcpu which ran the least (smallest
+ * vruntime) runs, so vcpus sharing a pcpu get equal CPU time.
+ */
+static struct vcpu *fair_pick_next(struct sched_context *ctx)
+{
+	struct list_head *pos;
+	struct vcpu *vcpu, *next = NULL;
+
+	list_for_each(pos, &ctx->runqueue) {
+		vcpu = list_entry(pos, struct vcpu, run_list);
+		if ((vcpu->sched_policy == &sched_fair_policy) &&
+			((next == NULL) ||
+			(vcpu->sched_vruntime < next->sched_vruntime))) {
+			next = vcpu;
+		}
+	}
+
+	if ((next != NULL) && (next->sched_vruntime > ctx->min_vruntime)) {
+		ctx->min_vruntime = next->sched_vruntime;
+	}
+
+	return next;
+}
+
+/* A vcpu which was blocked does not get credit for the time it slept */
+static void fair_enqueue(struct sched_context *ctx, struct vcpu *vcpu)
+{
+	if (vcpu->sched_vruntime < ctx->min_vruntime) {
+		vcpu->sched_vruntime = ctx->min_vruntime;
+	}
+}
+
+static void fair_charge(__unused struct sched_context *ctx,
+		struct vcpu *vcpu, uint64_t cycles)
+{
+	vcpu->sched_vruntime += cycles;
+}
+
+struct sched_policy sched_fair_policy = {
+	.name = "fair",
+	.pick_next = fair_pick_next,
+	.enqueue = fair_enqueue,
+	.charge = fair_charge,
+};
+
+/* Policies in precedence order */
+static struct sched_policy *sched_policies[] = {
+	&sched_rt_policy,
+	&sched_fair_policy,
+};
+
+static void slice_timer_fn(void *data)
+{
+	struct sched_context *ctx = (struct sched_context *)data;
+
+	bitmap_set_lock(NEED_RESCHEDULE, &ctx->flags);
+}
 
 void init_scheduler(void)
 {
@@ -19,9 +123,15 @@ void init_scheduler(void)
 
 		spinlock_init(&ctx->runqueue_lock);
 		spinlock_init(&ctx->scheduler_lock);
+		spinlock_set_name(&ctx->runqueue_lock, "runqueue_lock");
+		spinlock_set_name(&ctx->scheduler_lock, "scheduler_lock");
 		INIT_LIST_HEAD(&ctx->runqueue);
 		ctx->flags = 0UL;
 		ctx->curr_vcpu = NULL;
+		ctx->nr_vcpus = 0U;
+		ctx->min_vruntime = 0UL;
+		initialize_timer(&ctx->slice_timer, slice_timer_fn, ctx,
+				0UL, TICK_MODE_ONESHOT, 0UL);
 	}
 }
 
@@ -37,27 +147,68 @@ void release_schedule_lock(uint16_t pcpu_id)
 	spinlock_release(&ctx->scheduler_lock);
 }
 
+/*
+ * Assign a pcpu to a new vcpu: a free pcpu if any, else the least loaded
+ * pcpu which is not used exclusively (by VM0 or a partition mode VM). A pcpu
+ * takes at most MAX_VCPUS_PER_PCPU vcpus, which bounds its active timers.
+ */
 uint16_t allocate_pcpu(void)
 {
-	uint16_t i;
+	uint16_t i, pcpu_id = INVALID_CPU_ID;
+	uint32_t nr_vcpus;
 
+	spinlock_obtain(&pcpu_alloc_lock);
 	for (i = 0U; i < phys_cpu_num; i++) {
-		if (bitmap_test_and_set_lock(i, &pcpu_used_bitmap) == 0) {
-			return i;
+		if (bitmap_test(i, &pcpu_exclusive_bitmap)) {
+			continue;
+		}
+
+		nr_vcpus = per_cpu(sched_ctx, i).nr_vcpus;
+		if (nr_vcpus >= MAX_VCPUS_PER_PCPU) {
+			continue;
+		}
+
+		if ((pcpu_id == INVALID_CPU_ID) ||
+			(nr_vcpus < per_cpu(sched_ctx, pcpu_id).nr_vcpus)) {
+			pcpu_id = i;
 		}
 	}
 
-	return INVALID_CPU_ID;
+	if (pcpu_id != INVALID_CPU_ID) {
+		per_cpu(sched_ctx, pcpu_id).nr_vcpus++;
+	}
+	spinlock_release(&pcpu_alloc_lock);
+
+	return pcpu_id;
 }
 
+/* Assign the pcpu to a vcpu, without sharing it with later vcpus */
 void set_pcpu_used(uint16_t pcpu_id)
 {
-	bitmap_set_lock(pcpu_id, &pcpu_used_bitmap);
+	spinlock_obtain(&pcpu_alloc_lock);
+	bitmap_set_lock(pcpu_id, &pcpu_exclusive_bitmap);
+	per_cpu(sched_ctx, pcpu_id).nr_vcpus++;
+	spinlock_release(&pcpu_alloc_lock);
 }
 
 void free_pcpu(uint16_t pcpu_id)
 {
-	bitmap_clear_lock(pcpu_id, &pcpu_used_bitmap);
+	struct sched_context *ctx = &per_cpu(sched_ctx, pcpu_id);
+
+	spinlock_obtain(&pcpu_alloc_lock);
+	ctx->nr_vcpus--;
+	if (ctx->nr_vcpus == 0U) {
+		bitmap_clear_lock(pcpu_id, &pcpu_exclusive_bitmap);
+	}
+	spinlock_release(&pcpu_alloc_lock);
+}
+
+void set_vcpu_sched_policy(struct vcpu *vcpu, struct sched_policy *policy,
+		uint32_t prio)
+{
+	vcpu->sched_policy = policy;
+	vcpu->sched_prio = prio;
+	vcpu->sched_vruntime = 0UL;
 }
 
 void add_vcpu_to_runqueue(struct vcpu *vcpu)
@@ -67,6 +218,7 @@ void add_vcpu_to_runqueue(struct vcpu *vcpu)
 
 	spinlock_obtain(&ctx->runqueue_lock);
 	if (list_empty(&vcpu->run_list)) {
+		vcpu->sched_policy->enqueue(ctx, vcpu);
 		list_add_tail(&vcpu->run_list, &ctx->runqueue);
 	}
 	spinlock_release(&ctx->runqueue_lock);
@@ -82,14 +234,42 @@ void remove_vcpu_from_runqueue(struct vcpu *vcpu)
 	spinlock_release(&ctx->runqueue_lock);
 }
 
+/*
+ * Charge the current vcpu for the time it ran and pick the next one.
+ * The current vcpu goes to the runqueue tail, for round-robin among
+ * vcpus the policy ranks equal. The slice timer is armed when other
+ * vcpus wait for the pcpu.
+ */
 static struct vcpu *select_next_vcpu(uint16_t pcpu_id)
 {
 	struct sched_context *ctx = &per_cpu(sched_ctx, pcpu_id);
+	struct vcpu *curr = ctx->curr_vcpu;
 	struct vcpu *vcpu = NULL;
+	uint64_t now = rdtsc();
+	uint32_t i;
 
 	spinlock_obtain(&ctx->runqueue_lock);
-	if (!list_empty(&ctx->runqueue)) {
-		vcpu = get_first_item(&ctx->runqueue, struct vcpu, run_list);
+	if (curr != NULL) {
+		curr->sched_policy->charge(ctx, curr, now - curr->sched_start);
+		curr->sched_start = now;
+		if (!list_empty(&curr->run_list)) {
+			list_del(&curr->run_list);
+			list_add_tail(&curr->run_list, &ctx->runqueue);
+		}
+	}
+
+	for (i = 0U; (i < ARRAY_SIZE(sched_policies)) && (vcpu == NULL);
+			i++) {
+		vcpu = sched_policies[i]->pick_next(ctx);
+	}
+	if (vcpu != NULL) {
+		vcpu->sched_start = now;
+	}
+
+	del_timer(&ctx->slice_timer);
+	if ((vcpu != NULL) && (ctx->runqueue.next != ctx->runqueue.prev)) {
+		ctx->slice_timer.fire_tsc = now + us_to_ticks(SCHED_SLICE_US);
+		(void)add_timer(&ctx->slice_timer);
 	}
 	spinlock_release(&ctx->runqueue_lock);
 
@@ -100,9 +280,16 @@ void make_reschedule_request(struct vcpu *vcpu)
 {
 	struct sched_context *ctx = &per_cpu(sched_ctx, vcpu->pcpu_id);
 
+	uint32_t idle_state;
+
 	bitmap_set_lock(NEED_RESCHEDULE, &ctx->flags);
 	if (get_cpu_id() != vcpu->pcpu_id) {
-		send_single_ipi(vcpu->pcpu_id, VECTOR_NOTIFY_VCPU);
+		/* A pcpu polling or in MWAIT on its flags sees the update */
+		idle_state = atomic_load32(&per_cpu(idle, vcpu->pcpu_id).state);
+		if ((idle_state != IDLE_STATE_POLL) &&
+				(idle_state != IDLE_STATE_MWAIT)) {
+			send_single_ipi(vcpu->pcpu_id, VECTOR_NOTIFY_VCPU);
+		}
 	}
 }
 
@@ -123,12 +310,15 @@ static void context_switch_out(struct vcpu *vcpu)
 	/* cancel event(int, gp, nmi and exception) injection */
 	cancel_event_injection(vcpu);
 
-	atomic_store32(&vcpu->running, 0U);
-	/* do prev vcpu context switch out */
-	/* For now, we don't need to invalid ept.
-	 * But if we have more than one vcpu on one pcpu,
-	 * we need add ept invalid operation here.
+	/* Notifications for a switched out vcpu must reach the hypervisor.
+	 * Its guest state is only saved once another vcpu is switched in,
+	 * see load_switch_context().
 	 */
+	vlapic_set_posted_intr_vector(vcpu->arch_vcpu.vlapic,
+			VECTOR_POSTED_INTR_WAKEUP);
+
+	atomic_store32(&vcpu->running, 0U);
+	/* EPT entries are tagged by EPTP and VPID, no flush is needed */
 }
 
 static void context_switch_in(struct vcpu *vcpu)
@@ -142,12 +332,10 @@ static void context_switch_in(struct vcpu *vcpu)
 	}
 
 	atomic_store32(&vcpu->running, 1U);
-	/* FIXME:
-	 * Now, we don't need to load new vcpu VMCS because
-	 * we only do switch between vcpu loop and idle loop.
-	 * If we have more than one vcpu on on pcpu, need to
-	 * add VMCS load operation here.
-	 */
+	get_cpu_var(vcpu) = vcpu;
+
+	/* VMCS and guest state are reloaded if another vcpu ran meanwhile */
+	load_switch_context(vcpu);
 }
 
 void make_pcpu_offline(uint16_t pcpu_id)
@@ -172,14 +360,20 @@ void default_idle(void)
 	uint16_t pcpu_id = get_cpu_id();
 
 	while (1) {
+		/* No VM pointer is held in the idle loop */
+		per_cpu(vm_qs_seq, pcpu_id) += 2UL;
+		/* seen by unpublish_vm() before any later VM lookup */
+		CPU_MEMORY_BARRIER();
+
+		/* Timers may wake up halted vcpus of this pcpu */
+		do_softirq();
+
 		if (need_reschedule(pcpu_id) != 0) {
 			schedule();
 		} else if (need_offline(pcpu_id) != 0) {
 			cpu_dead(pcpu_id);
 		} else {
-			CPU_IRQ_ENABLE();
 			cpu_do_idle(pcpu_id);
-			CPU_IRQ_DISABLE();
 		}
 	}
 }
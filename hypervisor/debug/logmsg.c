@@ -69,6 +69,184 @@ static void do_copy_earlylog(struct shared_buf *dst_sbuf,
 	}
 }
 
+/* Skip the flags, width and precision of a conversion, see print_format() */
+static const char *log_bin_skip_spec(const char *fmt_arg)
+{
+	const char *fmt = fmt_arg;
+
+	while ((*fmt == '#') || (*fmt == '0') || (*fmt == '-') ||
+			(*fmt == '+') || (*fmt == ' ')) {
+		fmt++;
+	}
+	while ((*fmt >= '0') && (*fmt <= '9')) {
+		fmt++;
+	}
+	if (*fmt == '.') {
+		fmt++;
+		while ((*fmt >= '0') && (*fmt <= '9')) {
+			fmt++;
+		}
+	}
+
+	return fmt;
+}
+
+/*
+ * Store the arguments of fmt into rec, with the same types print_format()
+ * reads them with, and copy the strings after them.
+ *
+ * return: the size of the record, or 0 if fmt has too many arguments.
+ */
+static uint32_t log_bin_pack(struct log_bin_record *rec, const char *fmt_arg,
+		va_list args)
+{
+	char strs[LOG_MESSAGE_MAX_SIZE];
+	const char *fmt = fmt_arg;
+	const char *s;
+	uint32_t nr = 0U, str_len = 0U, str_max, size;
+	bool is_64;
+	char ch;
+
+	str_max = LOG_MESSAGE_MAX_SIZE - sizeof(*rec);
+	while (*fmt != '\0') {
+		if (*fmt != '%') {
+			fmt++;
+			continue;
+		}
+
+		fmt = log_bin_skip_spec(fmt + 1);
+		is_64 = false;
+		if (*fmt == 'h') {
+			fmt++;
+			if (*fmt == 'h') {
+				fmt++;
+			}
+		} else if (*fmt == 'l') {
+			fmt++;
+			if (*fmt == 'l') {
+				is_64 = true;
+				fmt++;
+			}
+		} else {
+			/* No length modifiers found. */
+		}
+
+		ch = *fmt;
+		if (ch == '\0') {
+			break;
+		}
+		fmt++;
+
+		/* '%' and unknown conversions take no argument */
+		if ((ch != 'd') && (ch != 'i') && (ch != 'u') && (ch != 'o') &&
+			(ch != 'x') && (ch != 'X') && (ch != 's') &&
+			(ch != 'p') && (ch != 'c')) {
+			continue;
+		}
+
+		if (nr >= LOG_BIN_MAX_ARGS) {
+			return 0U;
+		}
+
+		if (ch == 's') {
+			s = __builtin_va_arg(args, const char *);
+			if (s == NULL) {
+				s = "(null)";
+			}
+			rec->args[nr] = str_len;
+			while ((*s != '\0') && ((str_len + 1U) < str_max)) {
+				strs[str_len] = *s;
+				str_len++;
+				s++;
+			}
+			if (str_len < str_max) {
+				strs[str_len] = '\0';
+				str_len++;
+			}
+		} else if ((ch == 'p') || is_64) {
+			rec->args[nr] = __builtin_va_arg(args, uint64_t);
+		} else {
+			rec->args[nr] = __builtin_va_arg(args, uint32_t);
+		}
+		nr++;
+	}
+
+	/* the strings go right after the stored arguments */
+	size = (uint32_t)((sizeof(*rec) - sizeof(rec->args)) +
+			(nr * sizeof(uint64_t)));
+	if (str_len != 0U) {
+		(void)memcpy_s((char *)rec + size, str_len, strs, str_len);
+	}
+
+	rec->nr_args = (uint8_t)nr;
+	rec->str_len = (uint16_t)str_len;
+
+	return size + str_len;
+}
+
+/*
+ * Log records start with the magic of a binary record or with the '[' of
+ * the header of a text message, see sbuf_put_record()
+ */
+static bool log_rec_start(const uint8_t *entry)
+{
+	return (entry[0] == LOG_BIN_MAGIC) || (entry[0] == (uint8_t)'[');
+}
+
+/*
+ * Put a binary record of the message into sbuf, leaving the formatting to
+ * acrnlog. Return false if the message has to be logged as text.
+ */
+static bool do_bin_logmsg(struct shared_buf *sbuf, uint32_t severity,
+		uint64_t timestamp, uint32_t seq, const char *fmt,
+		va_list args)
+{
+	uint16_t pcpu_id = get_cpu_id();
+	struct log_bin_record *rec;
+	uint64_t fmt_addr = (uint64_t)fmt;
+	uint32_t size, n;
+
+	/* only the format strings in .rodata have an id */
+	if ((fmt_addr < (uint64_t)&_ld_rodata_start) ||
+			(fmt_addr >= (uint64_t)&_ld_rodata_end)) {
+		return false;
+	}
+
+	rec = (struct log_bin_record *)per_cpu(logbuf, pcpu_id);
+	size = log_bin_pack(rec, fmt, args);
+	if (size == 0U) {
+		return false;
+	}
+
+	n = (size + LOG_ENTRY_SIZE - 1U) / LOG_ENTRY_SIZE;
+	rec->magic = LOG_BIN_MAGIC;
+	rec->nr_entries = (uint8_t)n;
+	rec->severity = (uint8_t)severity;
+	rec->fmt_id = (uint32_t)(fmt_addr - (uint64_t)&_ld_rodata_start);
+	rec->timestamp = timestamp;
+	rec->seq = seq;
+	rec->pcpu_id = pcpu_id;
+
+	/* a record which does not fit is dropped, not logged as text */
+	(void)sbuf_put_record(sbuf, (uint8_t *)rec, n, log_rec_start);
+
+	return true;
+}
+
+void set_logmsg_binary(bool enable)
+{
+	if (enable) {
+		logmsg.flags |= LOG_FLAG_BINARY;
+	} else {
+		logmsg.flags &= ~LOG_FLAG_BINARY;
+	}
+}
+
+bool is_logmsg_binary(void)
+{
+	return ((logmsg.flags & LOG_FLAG_BINARY) != 0U);
+}
+
 void init_logmsg(__unused uint32_t mem_size, uint32_t flags)
 {
 	int16_t pcpu_id;
@@ -87,10 +265,12 @@ void do_logmsg(uint32_t severity, const char *fmt, ...)
 	va_list args;
 	uint64_t timestamp, rflags;
 	uint16_t pcpu_id;
+	uint32_t seq;
 	bool do_console_log;
 	bool do_mem_log;
 	bool do_npk_log;
 	char *buffer;
+	struct shared_buf *sbuf = NULL;
 
 	do_console_log = (((logmsg.flags & LOG_FLAG_STDOUT) != 0U) &&
 					(severity <= console_loglevel));
@@ -112,13 +292,45 @@ void do_logmsg(uint32_t severity, const char *fmt, ...)
 	/* Get CPU ID */
 	pcpu_id = get_cpu_id();
 	buffer = per_cpu(logbuf, pcpu_id);
+	seq = (uint32_t)atomic_inc_return(&logmsg.seq);
+
+	/* Check if flags specify to output to memory */
+	if (do_mem_log) {
+		struct shared_buf *early_sbuf = per_cpu(earlylog_sbuf, pcpu_id);
+
+		sbuf = (struct shared_buf *)per_cpu(sbuf, pcpu_id)[ACRN_HVLOG];
+		if (early_sbuf != NULL) {
+			if (sbuf != NULL) {
+				/* switch to sbuf from sos */
+				do_copy_earlylog(sbuf, early_sbuf);
+				free_earlylog_sbuf(pcpu_id);
+			} else {
+				/* use earlylog sbuf if no sbuf from sos */
+				sbuf = early_sbuf;
+			}
+		}
+
+		/* A binary record needs no formatting here */
+		if ((sbuf != NULL) &&
+			((logmsg.flags & LOG_FLAG_BINARY) != 0U)) {
+			va_start(args, fmt);
+			if (do_bin_logmsg(sbuf, severity, timestamp, seq,
+					fmt, args)) {
+				sbuf = NULL;
+			}
+			va_end(args);
+		}
+	}
+
+	if (!do_console_log && !do_npk_log && (sbuf == NULL)) {
+		return;
+	}
 
 	(void)memset(buffer, 0U, LOG_MESSAGE_MAX_SIZE);
 	/* Put time-stamp, CPU ID and severity into buffer */
 	snprintf(buffer, LOG_MESSAGE_MAX_SIZE,
 			"[%lluus][cpu=%hu][sev=%u][seq=%u]:",
-			timestamp, pcpu_id, severity,
-			atomic_inc_return(&logmsg.seq));
+			timestamp, pcpu_id, severity, seq);
 
 	/* Put message into remaining portion of local buffer */
 	va_start(args, fmt);
@@ -141,33 +353,35 @@ void do_logmsg(uint32_t severity, const char *fmt, ...)
 		spinlock_irqrestore_release(&(logmsg.lock), rflags);
 	}
 
-	/* Check if flags specify to output to memory */
-	if (do_mem_log) {
-		int i, msg_len;
-		struct shared_buf *sbuf = (struct shared_buf *)
-					per_cpu(sbuf, pcpu_id)[ACRN_HVLOG];
-		struct shared_buf *early_sbuf = per_cpu(earlylog_sbuf, pcpu_id);
+	/* Text message into memory */
+	if (sbuf != NULL) {
+		int msg_len = strnlen_s(buffer, LOG_MESSAGE_MAX_SIZE);
+		uint32_t n = (uint32_t)(((msg_len - 1) / LOG_ENTRY_SIZE) + 1);
 
-		if (early_sbuf != NULL) {
-			if (sbuf != NULL) {
-				/* switch to sbuf from sos */
-				do_copy_earlylog(sbuf, early_sbuf);
-				free_earlylog_sbuf(pcpu_id);
-			} else {
-				/* use earlylog sbuf if no sbuf from sos */
-				sbuf = early_sbuf;
-			}
-		}
+		(void)sbuf_put_record(sbuf, (uint8_t *)buffer, n,
+				log_rec_start);
+	}
+}
 
-		if (sbuf != NULL) {
-			msg_len = strnlen_s(buffer, LOG_MESSAGE_MAX_SIZE);
+/* The format string of a binary record, without its arguments */
+static void print_bin_logmsg(struct shared_buf *sbuf, const char *entry)
+{
+	struct log_bin_record rec;
+	char skip[LOG_ENTRY_SIZE];
+	uint64_t rflags;
+	uint8_t i;
 
-			for (i = 0; i < (((msg_len - 1) / LOG_ENTRY_SIZE) + 1);
-					i++) {
-				(void)sbuf_put(sbuf, (uint8_t *)buffer +
-							(i * LOG_ENTRY_SIZE));
-			}
-		}
+	/* only the header is needed, which is in the first entry */
+	(void)memcpy_s(&rec, sizeof(rec), entry, LOG_ENTRY_SIZE);
+
+	spinlock_irqsave_obtain(&(logmsg.lock), &rflags);
+	printf("[%lluus][cpu=%hu][sev=%u][seq=%u]:[binary] %s\n\r",
+		rec.timestamp, rec.pcpu_id, rec.severity, rec.seq,
+		(const char *)&_ld_rodata_start + rec.fmt_id);
+	spinlock_irqrestore_release(&(logmsg.lock), rflags);
+
+	for (i = 1U; i < rec.nr_entries; i++) {
+		(void)sbuf_get(sbuf, (uint8_t *)skip);
 	}
 }
 
@@ -178,6 +392,7 @@ void print_logmsg_buffer(uint16_t pcpu_id)
 	struct shared_buf **sbuf;
 	int is_earlylog = 0;
 	uint64_t rflags;
+	bool in_text = false;
 
 	if (pcpu_id >= phys_cpu_num) {
 		return;
@@ -213,8 +428,21 @@ void print_logmsg_buffer(uint16_t pcpu_id)
 			return;
 		}
 
+		/* the rest of a record whose start was overwritten */
+		if (!in_text && !log_rec_start((uint8_t *)buffer)) {
+			continue;
+		}
+
+		if ((uint8_t)buffer[0] == LOG_BIN_MAGIC) {
+			print_bin_logmsg(*sbuf, buffer);
+			in_text = false;
+			continue;
+		}
+
 		idx = (read_cnt < LOG_ENTRY_SIZE) ? read_cnt : LOG_ENTRY_SIZE;
 		buffer[idx] = '\0';
+		/* a text message goes on in the next entry if not ended */
+		in_text = (strnlen_s(buffer, LOG_ENTRY_SIZE) == LOG_ENTRY_SIZE);
 
 		spinlock_irqsave_obtain(&(logmsg.lock), &rflags);
 		printf("%s\n\r", buffer);
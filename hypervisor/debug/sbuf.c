@@ -11,11 +11,6 @@
 
 #include <hypervisor.h>
 
-static inline bool sbuf_is_empty(struct shared_buf *sbuf)
-{
-	return (sbuf->head == sbuf->tail);
-}
-
 static inline uint32_t sbuf_next_ptr(uint32_t pos_arg,
 		uint32_t span, uint32_t scope)
 {
@@ -82,26 +77,240 @@ void sbuf_free(struct shared_buf *sbuf)
 	free(sbuf);
 }
 
-int sbuf_get(struct shared_buf *sbuf, uint8_t *data)
+/* Number of bytes stored between head and tail */
+static inline uint32_t sbuf_used(const struct shared_buf *sbuf,
+		uint32_t head, uint32_t tail)
+{
+	return (tail >= head) ? (tail - head) : ((sbuf->size - head) + tail);
+}
+
+/* Copy len bytes out of the ring at pos, wrapping at the end */
+static void sbuf_copy_from(const struct shared_buf *sbuf, uint8_t *data,
+		uint32_t pos, uint32_t len)
+{
+	const uint8_t *base = (const uint8_t *)sbuf + SBUF_HEAD_SIZE;
+	uint32_t run = sbuf->size - pos;
+
+	run = (len < run) ? len : run;
+	if (run != 0U) {
+		(void)memcpy_s(data, run, base + pos, run);
+	}
+	if (len > run) {
+		(void)memcpy_s(data + run, len - run, base, len - run);
+	}
+}
+
+/* Copy len bytes into the ring at pos, wrapping at the end */
+static void sbuf_copy_to(struct shared_buf *sbuf, const uint8_t *data,
+		uint32_t pos, uint32_t len)
 {
-	const void *from;
+	uint8_t *base = (uint8_t *)sbuf + SBUF_HEAD_SIZE;
+	uint32_t run = sbuf->size - pos;
+
+	run = (len < run) ? len : run;
+	if (run != 0U) {
+		(void)memcpy_s(base + pos, run, data, run);
+	}
+	if (len > run) {
+		(void)memcpy_s(base, len - run, data + run, len - run);
+	}
+}
+
+/**
+ * Read up to nr elements into data, which has room for nr * ele_size bytes,
+ * with a single update of head.
+ *
+ * return: the number of elements read.
+ */
+uint32_t sbuf_get_many(struct shared_buf *sbuf, uint8_t *data, uint32_t nr)
+{
+	uint32_t head, tail, n, len, next_head;
+	bool done;
+
+	if ((sbuf == NULL) || (data == NULL)) {
+		return 0U;
+	}
+
+	do {
+		head = atomic_load32(&sbuf->head);
+		tail = atomic_load32(&sbuf->tail);
+		n = sbuf_used(sbuf, head, tail) / sbuf->ele_size;
+		n = (nr < n) ? nr : n;
+		if (n == 0U) {
+			/* no data available */
+			return 0U;
+		}
+
+		len = n * sbuf->ele_size;
+		sbuf_copy_from(sbuf, data, head, len);
+		next_head = sbuf_next_ptr(head, len, sbuf->size);
+
+		if ((sbuf->flags & OVERWRITE_EN) == 0U) {
+			atomic_store32(&sbuf->head, next_head);
+			done = true;
+		} else {
+			/* the producer may have overwritten what we read */
+			done = (atomic_cmpxchg32(&sbuf->head, head,
+					next_head) == head);
+		}
+	} while (!done);
+
+	return n;
+}
 
+int sbuf_get(struct shared_buf *sbuf, uint8_t *data)
+{
 	if ((sbuf == NULL) || (data == NULL)) {
 		return -EINVAL;
 	}
 
-	if (sbuf_is_empty(sbuf)) {
-		/* no data available */
-		return 0;
+	return (int)(sbuf_get_many(sbuf, data, 1U) * sbuf->ele_size);
+}
+
+/* Drop the oldest elements until n more fit, for OVERWRITE_EN */
+static void sbuf_make_room(struct shared_buf *sbuf, uint32_t tail,
+		uint32_t n)
+{
+	uint32_t head, free_nr, next_head;
+
+	do {
+		head = atomic_load32(&sbuf->head);
+		free_nr = ((sbuf->size - sbuf_used(sbuf, head, tail)) /
+				sbuf->ele_size) - 1U;
+		if (n <= free_nr) {
+			break;
+		}
+		next_head = sbuf_next_ptr(head,
+				(n - free_nr) * sbuf->ele_size, sbuf->size);
+	} while (atomic_cmpxchg32(&sbuf->head, head, next_head) != head);
+}
+
+/**
+ * Write nr elements from data with a single update of tail.
+ *
+ * flag:
+ * buf can store (ele_num - 1) elements at most. If OVERWRITE_EN is not
+ * set, the elements which do not fit are dropped. If it is set, the
+ * oldest elements are dropped instead, so at most the last (ele_num - 1)
+ * elements of data are written.
+ *
+ * return: the number of elements written.
+ */
+uint32_t sbuf_put_many(struct shared_buf *sbuf, const uint8_t *data,
+		uint32_t nr)
+{
+	const uint8_t *from = data;
+	uint32_t head, tail, free_nr, n = nr;
+
+	if ((sbuf == NULL) || (data == NULL)) {
+		return 0U;
 	}
 
-	from = (void *)sbuf + SBUF_HEAD_SIZE + sbuf->head;
+	/* only the producer writes tail */
+	tail = sbuf->tail;
+	head = atomic_load32(&sbuf->head);
+	free_nr = ((sbuf->size - sbuf_used(sbuf, head, tail)) /
+			sbuf->ele_size) - 1U;
 
-	(void)memcpy_s((void *)data, sbuf->ele_size, from, sbuf->ele_size);
+	/* if this write would trigger overrun */
+	if (n > free_nr) {
+		/* accumulate overrun count if necessary */
+		if ((sbuf->flags & OVERRUN_CNT_EN) != 0U) {
+			sbuf->overrun_cnt += n - free_nr;
+		}
 
-	sbuf->head = sbuf_next_ptr(sbuf->head, sbuf->ele_size, sbuf->size);
+		if ((sbuf->flags & OVERWRITE_EN) == 0U) {
+			n = free_nr;
+		} else {
+			if (n > (sbuf->ele_num - 1U)) {
+				from += (n - (sbuf->ele_num - 1U)) *
+					sbuf->ele_size;
+				n = sbuf->ele_num - 1U;
+			}
+			sbuf_make_room(sbuf, tail, n);
+		}
+	}
+
+	if (n != 0U) {
+		sbuf_copy_to(sbuf, from, tail, n * sbuf->ele_size);
+		/* publish the elements to the consumer */
+		atomic_store32(&sbuf->tail, sbuf_next_ptr(tail,
+				n * sbuf->ele_size, sbuf->size));
+	}
 
-	return sbuf->ele_size;
+	return n;
+}
+
+/* Drop the oldest records until n more elements fit, for OVERWRITE_EN */
+static void sbuf_drop_records(struct shared_buf *sbuf, uint32_t tail,
+		uint32_t n, sbuf_rec_start_t rec_start)
+{
+	const uint8_t *base = (const uint8_t *)sbuf + SBUF_HEAD_SIZE;
+	uint32_t head, free_nr, next_head;
+
+	do {
+		head = atomic_load32(&sbuf->head);
+		free_nr = ((sbuf->size - sbuf_used(sbuf, head, tail)) /
+				sbuf->ele_size) - 1U;
+		if (n <= free_nr) {
+			break;
+		}
+		next_head = sbuf_next_ptr(head,
+				(n - free_nr) * sbuf->ele_size, sbuf->size);
+		/* do not leave the rest of a record at head */
+		while ((next_head != tail) && !rec_start(base + next_head)) {
+			next_head = sbuf_next_ptr(next_head, sbuf->ele_size,
+					sbuf->size);
+		}
+	} while (atomic_cmpxchg32(&sbuf->head, head, next_head) != head);
+}
+
+/**
+ * Write the nr elements of a record with a single update of tail, or none
+ * of them, so that readers never see a partial record.
+ *
+ * flag:
+ * If OVERWRITE_EN is not set, the record is dropped if it does not fit. If
+ * it is set, the oldest records are dropped whole instead, rec_start()
+ * telling the elements which begin a record.
+ *
+ * return: true if the record was written.
+ */
+bool sbuf_put_record(struct shared_buf *sbuf, const uint8_t *data,
+		uint32_t nr, sbuf_rec_start_t rec_start)
+{
+	uint32_t head, tail, free_nr;
+
+	if ((sbuf == NULL) || (data == NULL) || (nr == 0U) ||
+			(nr > (sbuf->ele_num - 1U))) {
+		return false;
+	}
+
+	/* only the producer writes tail */
+	tail = sbuf->tail;
+	head = atomic_load32(&sbuf->head);
+	free_nr = ((sbuf->size - sbuf_used(sbuf, head, tail)) /
+			sbuf->ele_size) - 1U;
+
+	/* if this write would trigger overrun */
+	if (nr > free_nr) {
+		/* accumulate overrun count if necessary */
+		if ((sbuf->flags & OVERRUN_CNT_EN) != 0U) {
+			sbuf->overrun_cnt += nr - free_nr;
+		}
+
+		if ((sbuf->flags & OVERWRITE_EN) == 0U) {
+			return false;
+		}
+		sbuf_drop_records(sbuf, tail, nr, rec_start);
+	}
+
+	sbuf_copy_to(sbuf, data, tail, nr * sbuf->ele_size);
+	/* publish the elements to the consumer */
+	atomic_store32(&sbuf->tail, sbuf_next_ptr(tail,
+			nr * sbuf->ele_size, sbuf->size));
+
+	return true;
 }
 
 /**
@@ -109,52 +318,37 @@ int sbuf_get(struct shared_buf *sbuf, uint8_t *data)
  * sbuf->ele_size data can be write form data and this function
  * should guarantee execution atomically.
  *
- * flag:
- * If OVERWRITE_EN set, buf can store (ele_num - 1) elements at most.
- * Should use lock to guarantee that only one read or write at
- * the same time.
- * if OVERWRITE_EN not set, buf can store (ele_num - 1) elements
- * at most. Shouldn't modify the sbuf->head.
- *
  * return:
  * ele_size:	write succeeded.
  * 0:		no write, buf is full
  * negative:	failed.
  */
-
 int sbuf_put(struct shared_buf *sbuf, uint8_t *data)
 {
-	void *to;
-	uint32_t next_tail;
-	bool trigger_overwrite = false;
-
 	if ((sbuf == NULL) || (data == NULL)) {
 		return -EINVAL;
 	}
 
-	next_tail = sbuf_next_ptr(sbuf->tail, sbuf->ele_size, sbuf->size);
-	/* if this write would trigger overrun */
-	if (next_tail == sbuf->head) {
-		/* accumulate overrun count if necessary */
-		sbuf->overrun_cnt += sbuf->flags & OVERRUN_CNT_EN;
-		if ((sbuf->flags & OVERWRITE_EN) == 0U) {
-			/* if not enable over write, return here. */
-			return 0;
-		}
-		trigger_overwrite = true;
-	}
-
-	to = (void *)sbuf + SBUF_HEAD_SIZE + sbuf->tail;
+	return (int)(sbuf_put_many(sbuf, data, 1U) * sbuf->ele_size);
+}
 
-	(void)memcpy_s(to, sbuf->ele_size, data, sbuf->ele_size);
+/*
+ * Check the header of a sbuf set up by the SOS: its layout must be the one
+ * of this hypervisor and its indexes must stay within the buffer.
+ */
+static bool sbuf_header_valid(const struct shared_buf *sbuf)
+{
+	uint64_t size = (uint64_t)sbuf->ele_num * sbuf->ele_size;
 
-	if (trigger_overwrite) {
-		sbuf->head = sbuf_next_ptr(sbuf->head,
-				sbuf->ele_size, sbuf->size);
+	if ((sbuf->magic != SBUF_MAGIC) || (sbuf->ele_size == 0U) ||
+			(sbuf->ele_num < 2U) || (size != sbuf->size) ||
+			(size > (uint64_t)SBUF_MAX_SIZE)) {
+		return false;
 	}
-	sbuf->tail = next_tail;
 
-	return sbuf->ele_size;
+	return (sbuf->head < sbuf->size) && (sbuf->tail < sbuf->size) &&
+		((sbuf->head % sbuf->ele_size) == 0U) &&
+		((sbuf->tail % sbuf->ele_size) == 0U);
 }
 
 int sbuf_share_setup(uint16_t pcpu_id, uint32_t sbuf_id, uint64_t *hva)
@@ -164,6 +358,13 @@ int sbuf_share_setup(uint16_t pcpu_id, uint32_t sbuf_id, uint64_t *hva)
 		return -EINVAL;
 	}
 
+	if ((hva != NULL) &&
+			!sbuf_header_valid((struct shared_buf *)hva)) {
+		pr_err("%s invalid sbuf for pCPU[%u] with sbuf_id[%u]",
+				__func__, pcpu_id, sbuf_id);
+		return -EINVAL;
+	}
+
 	per_cpu(sbuf, pcpu_id)[sbuf_id] = hva;
 	pr_info("%s share sbuf for pCPU[%u] with sbuf_id[%u] setup successfully",
 			__func__, pcpu_id, sbuf_id);
@@ -26,9 +26,18 @@ static int shell_show_cpu_int(__unused int argc, __unused char **argv);
 static int shell_show_ptdev_info(__unused int argc, __unused char **argv);
 static int shell_show_vioapic_info(int argc, char **argv);
 static int shell_show_ioapic_info(__unused int argc, __unused char **argv);
+static int shell_show_vm_io_info(int argc, char **argv);
+static int shell_show_ept_stats(int argc, char **argv);
 static int shell_show_vmexit_profile(__unused int argc, __unused char **argv);
+static int shell_show_vmexit_stats(int argc, char **argv);
+static int shell_show_mem_stats(__unused int argc, __unused char **argv);
+static int shell_show_idle_stats(__unused int argc, __unused char **argv);
+#ifdef CONFIG_LOCKSTAT
+static int shell_show_lockstat(__unused int argc, __unused char **argv);
+#endif
 static int shell_dump_logbuf(int argc, char **argv);
 static int shell_loglevel(int argc, char **argv);
+static int shell_logbin(int argc, char **argv);
 static int shell_cpuid(int argc, char **argv);
 static int shell_trigger_crash(int argc, char **argv);
 
@@ -93,12 +102,50 @@ static struct shell_cmd shell_cmds[] = {
 		.help_str	= SHELL_CMD_IOAPIC_HELP,
 		.fcn		= shell_show_ioapic_info,
 	},
+	{
+		.str		= SHELL_CMD_VM_IO,
+		.cmd_param	= SHELL_CMD_VM_IO_PARAM,
+		.help_str	= SHELL_CMD_VM_IO_HELP,
+		.fcn		= shell_show_vm_io_info,
+	},
+	{
+		.str		= SHELL_CMD_EPT_STATS,
+		.cmd_param	= SHELL_CMD_EPT_STATS_PARAM,
+		.help_str	= SHELL_CMD_EPT_STATS_HELP,
+		.fcn		= shell_show_ept_stats,
+	},
 	{
 		.str		= SHELL_CMD_VMEXIT,
 		.cmd_param	= SHELL_CMD_VMEXIT_PARAM,
 		.help_str	= SHELL_CMD_VMEXIT_HELP,
 		.fcn		= shell_show_vmexit_profile,
 	},
+	{
+		.str		= SHELL_CMD_VMEXIT_STATS,
+		.cmd_param	= SHELL_CMD_VMEXIT_STATS_PARAM,
+		.help_str	= SHELL_CMD_VMEXIT_STATS_HELP,
+		.fcn		= shell_show_vmexit_stats,
+	},
+	{
+		.str		= SHELL_CMD_MEM_STATS,
+		.cmd_param	= SHELL_CMD_MEM_STATS_PARAM,
+		.help_str	= SHELL_CMD_MEM_STATS_HELP,
+		.fcn		= shell_show_mem_stats,
+	},
+	{
+		.str		= SHELL_CMD_IDLE_STATS,
+		.cmd_param	= SHELL_CMD_IDLE_STATS_PARAM,
+		.help_str	= SHELL_CMD_IDLE_STATS_HELP,
+		.fcn		= shell_show_idle_stats,
+	},
+#ifdef CONFIG_LOCKSTAT
+	{
+		.str		= SHELL_CMD_LOCKSTAT,
+		.cmd_param	= SHELL_CMD_LOCKSTAT_PARAM,
+		.help_str	= SHELL_CMD_LOCKSTAT_HELP,
+		.fcn		= shell_show_lockstat,
+	},
+#endif
 	{
 		.str		= SHELL_CMD_LOGDUMP,
 		.cmd_param	= SHELL_CMD_LOGDUMP_PARAM,
@@ -111,6 +158,12 @@ static struct shell_cmd shell_cmds[] = {
 		.help_str	= SHELL_CMD_LOG_LVL_HELP,
 		.fcn		= shell_loglevel,
 	},
+	{
+		.str		= SHELL_CMD_LOG_BIN,
+		.cmd_param	= SHELL_CMD_LOG_BIN_PARAM,
+		.help_str	= SHELL_CMD_LOG_BIN_HELP,
+		.fcn		= shell_logbin,
+	},
 	{
 		.str		= SHELL_CMD_CPUID,
 		.cmd_param	= SHELL_CMD_CPUID_PARAM,
@@ -836,6 +889,60 @@ static int shell_show_ioapic_info(__unused int argc, __unused char **argv)
 	return err;
 }
 
+static int shell_show_vm_io_info(int argc, char **argv)
+{
+	char *temp_str;
+	int32_t ret;
+
+	/* User input invalidation */
+	if (argc != 2) {
+		return -EINVAL;
+	}
+	ret = atoi(argv[1]);
+	if (ret < 0) {
+		return -EINVAL;
+	}
+
+	temp_str = alloc_page();
+	if (temp_str == NULL) {
+		return -ENOMEM;
+	}
+
+	get_vm_io_info(temp_str, CPU_PAGE_SIZE, (uint16_t)ret);
+	shell_puts(temp_str);
+
+	free(temp_str);
+
+	return 0;
+}
+
+static int shell_show_ept_stats(int argc, char **argv)
+{
+	char *temp_str;
+	int32_t ret;
+
+	/* User input invalidation */
+	if (argc != 2) {
+		return -EINVAL;
+	}
+	ret = atoi(argv[1]);
+	if (ret < 0) {
+		return -EINVAL;
+	}
+
+	temp_str = alloc_page();
+	if (temp_str == NULL) {
+		return -ENOMEM;
+	}
+
+	get_ept_stats(temp_str, CPU_PAGE_SIZE, (uint16_t)ret);
+	shell_puts(temp_str);
+
+	free(temp_str);
+
+	return 0;
+}
+
 static int shell_show_vmexit_profile(__unused int argc, __unused char **argv)
 {
 	char *temp_str = alloc_pages(2U);
@@ -852,6 +959,83 @@ static int shell_show_vmexit_profile(__unused int argc, __unused char **argv)
 	return 0;
 }
 
+static int shell_show_vmexit_stats(int argc, char **argv)
+{
+	char *temp_str;
+	int32_t ret;
+
+	/* User input invalidation */
+	if (argc != 2) {
+		return -EINVAL;
+	}
+	ret = atoi(argv[1]);
+	if (ret < 0) {
+		return -EINVAL;
+	}
+
+	temp_str = alloc_pages(4U);
+	if (temp_str == NULL) {
+		return -ENOMEM;
+	}
+
+	get_vm_vmexit_stats(temp_str, 4*CPU_PAGE_SIZE, (uint16_t)ret);
+	shell_puts(temp_str);
+
+	free(temp_str);
+
+	return 0;
+}
+
+static int shell_show_mem_stats(__unused int argc, __unused char **argv)
+{
+	char *temp_str = alloc_page();
+
+	if (temp_str == NULL) {
+		return -ENOMEM;
+	}
+
+	get_mem_stats(temp_str, CPU_PAGE_SIZE);
+	shell_puts(temp_str);
+
+	free(temp_str);
+
+	return 0;
+}
+
+static int shell_show_idle_stats(__unused int argc, __unused char **argv)
+{
+	char *temp_str = alloc_pages(4U);
+
+	if (temp_str == NULL) {
+		return -ENOMEM;
+	}
+
+	get_cpu_idle_stats(temp_str, 4 * CPU_PAGE_SIZE);
+	shell_puts(temp_str);
+
+	free(temp_str);
+
+	return 0;
+}
+
+#ifdef CONFIG_LOCKSTAT
+static int shell_show_lockstat(__unused int argc, __unused char **argv)
+{
+	char *temp_str = alloc_pages(2U);
+
+	if (temp_str == NULL) {
+		return -ENOMEM;
+	}
+
+	get_lockstat(temp_str, 2 * CPU_PAGE_SIZE);
+	shell_puts(temp_str);
+
+	free(temp_str);
+
+	return 0;
+}
+#endif
+
 static int shell_dump_logbuf(int argc, char **argv)
 {
 	uint16_t pcpu_id;
@@ -894,6 +1078,26 @@ static int shell_loglevel(int argc, char **argv)
 	return 0;
 }
 
+static int shell_logbin(int argc, char **argv)
+{
+	char str[MAX_STR_SIZE] = {0};
+
+	switch (argc) {
+	case 2:
+		set_logmsg_binary(atoi(argv[1]) != 0);
+		break;
+	case 1:
+		snprintf(str, MAX_STR_SIZE, "binary memory log: %s\r\n",
+			is_logmsg_binary() ? "on" : "off");
+		shell_puts(str);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 static int shell_cpuid(int argc, char **argv)
 {
 	char str[MAX_STR_SIZE] = {0};
@@ -81,10 +81,34 @@ struct shell {
 #define SHELL_CMD_VIOAPIC_PARAM		"<vm id>"
 #define SHELL_CMD_VIOAPIC_HELP		"show vioapic info"
 
+#define SHELL_CMD_VM_IO			"vm_io"
+#define SHELL_CMD_VM_IO_PARAM		"<vm id>"
+#define SHELL_CMD_VM_IO_HELP		"show port I/O handlers and their hits"
+
+#define SHELL_CMD_EPT_STATS		"ept_stats"
+#define SHELL_CMD_EPT_STATS_PARAM	"<vm id>"
+#define SHELL_CMD_EPT_STATS_HELP	"show EPT mappings per page size"
+
 #define SHELL_CMD_VMEXIT		"vmexit"
 #define SHELL_CMD_VMEXIT_PARAM		NULL
 #define SHELL_CMD_VMEXIT_HELP		"show vmexit profiling"
 
+#define SHELL_CMD_VMEXIT_STATS		"vmexit_stats"
+#define SHELL_CMD_VMEXIT_STATS_PARAM	"<vm id>"
+#define SHELL_CMD_VMEXIT_STATS_HELP	"show vmexit counts and latency histograms"
+
+#define SHELL_CMD_MEM_STATS		"mem_stats"
+#define SHELL_CMD_MEM_STATS_PARAM	NULL
+#define SHELL_CMD_MEM_STATS_HELP	"show heap usage, fragmentation and slab caches"
+
+#define SHELL_CMD_IDLE_STATS		"idle_stats"
+#define SHELL_CMD_IDLE_STATS_PARAM	NULL
+#define SHELL_CMD_IDLE_STATS_HELP	"show idle residency per CPU"
+
+#define SHELL_CMD_LOCKSTAT		"lockstat"
+#define SHELL_CMD_LOCKSTAT_PARAM	NULL
+#define SHELL_CMD_LOCKSTAT_HELP		"show the most contended spinlocks"
+
 #define SHELL_CMD_LOGDUMP		"logdump"
 #define SHELL_CMD_LOGDUMP_PARAM		"<pcpu id>"
 #define SHELL_CMD_LOGDUMP_HELP		"log buffer dump"
@@ -94,6 +118,10 @@ struct shell {
 					"[npk_loglevel]]]"
 #define SHELL_CMD_LOG_LVL_HELP		"get(para is NULL), or set loglevel [0-6]"
 
+#define SHELL_CMD_LOG_BIN		"logbin"
+#define SHELL_CMD_LOG_BIN_PARAM		"[<0|1>]"
+#define SHELL_CMD_LOG_BIN_HELP		"get(para is NULL), or set binary memory log, decoded by acrnlog"
+
 #define SHELL_CMD_CPUID			"cpuid"
 #define SHELL_CMD_CPUID_PARAM		"<leaf> [subleaf]"
 #define SHELL_CMD_CPUID_HELP		"cpuid leaf [subleaf], in hexadecimal"
@@ -0,0 +1,28 @@
+/*
+ * Copyright (C) 2018 Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <hypervisor.h>
+
+struct trace_filter trace_filter;
+
+bool trace_vm_check(uint16_t cpu_id)
+{
+	struct vcpu *vcpu = get_ever_run_vcpu(cpu_id);
+
+	return (vcpu != NULL) && (vcpu->vm->vm_id == trace_filter.vm_id);
+}
+
+void trace_filter_setup(const struct trace_filter_param *param)
+{
+	uint32_t i;
+
+	for (i = 0U; i < (ACRN_TRACE_EVENT_MAX / 64U); i++) {
+		trace_filter.ev_disabled[i] = ~param->ev_mask[i];
+	}
+
+	trace_filter.vm_id = param->vm_id;
+	trace_filter.vm_filter = (param->vm_id != ACRN_TRACE_VM_ANY);
+}
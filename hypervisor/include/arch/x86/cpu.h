@@ -218,6 +218,8 @@ enum cpu_reg_name {
 /**********************************/
 extern uint8_t		_ld_bss_start;
 extern uint8_t		_ld_bss_end;
+extern uint8_t		_ld_rodata_start;
+extern uint8_t		_ld_rodata_end;
 
 /* In trampoline range, hold the jump target which trampline will jump to */
 extern uint64_t               main_entry[1];
@@ -319,11 +321,25 @@ extern struct cpuinfo_x86 boot_cpu_data;
  */
 #define MAX_CX_ENTRY	(MAX_CSTATE - 1U)
 
+/* What an idle pcpu is doing, see cpu_do_idle() */
+#define IDLE_STATE_NONE		0U	/* Not idle */
+#define IDLE_STATE_POLL		1U	/* Polling sched_ctx flags */
+#define IDLE_STATE_MWAIT	2U	/* In MWAIT on the sched_ctx flags */
+#define IDLE_STATE_HLT		3U	/* In HLT, woken by interrupts */
+
+struct cpu_idle_info {
+	uint32_t state;
+	uint64_t poll_cycles;
+	uint64_t sleep_cycles;
+	uint64_t sleep_count;
+};
+
 /* Function prototypes */
-void cpu_do_idle(__unused uint16_t pcpu_id);
+void cpu_do_idle(uint16_t pcpu_id);
 void cpu_dead(uint16_t pcpu_id);
 void trampoline_start16(void);
 bool is_apicv_intr_delivery_supported(void);
+bool is_apicv_posted_intr_supported(void);
 bool is_ept_supported(void);
 bool cpu_has_cap(uint32_t bit);
 void load_cpu_state_data(void);
@@ -332,6 +348,9 @@ void cpu_secondary_init(void);
 void start_cpus(void);
 void stop_cpus(void);
 void wait_sync_change(uint64_t *sync, uint64_t wake_sync);
+#ifdef HV_DEBUG
+void get_cpu_idle_stats(char *str_arg, int str_max);
+#endif /* HV_DEBUG */
 
 /* Read control register */
 #define CPU_CR_READ(cr, result_ptr)                         \
@@ -517,6 +536,15 @@ msr_write(uint32_t reg_num, uint64_t value64)
 	CPU_MSR_WRITE(reg_num, value64);
 }
 
+static inline uint64_t
+read_xcr(int reg)
+{
+	uint32_t low, high;
+
+	asm volatile("xgetbv" : "=a" (low), "=d" (high) : "c" (reg));
+	return ((uint64_t)high << 32U) | (uint64_t)low;
+}
+
 static inline void
 write_xcr(int reg, uint64_t val)
 {
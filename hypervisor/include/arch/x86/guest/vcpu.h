@@ -163,6 +163,36 @@ struct cpu_context {
 	struct ext_context ext_ctx;
 };
 
+/*
+ * Guest state which the VMCS does not switch, saved while the vcpu is
+ * switched out of its pcpu for another vcpu.
+ */
+struct switch_context {
+	uint64_t ia32_star;
+	uint64_t ia32_lstar;
+	uint64_t ia32_fmask;
+	uint64_t ia32_kernel_gs_base;
+	uint64_t xcr0;
+	/* XSAVE (or FXSAVE) area, page aligned */
+	void *xsave_area;
+	/* Whether the fields above hold the state to restore */
+	bool saved;
+};
+
+/* Number of guest page walks cached per vcpu, see gva2gpa() */
+#define GUEST_TLB_ENTRIES	4U
+
+/* A cached guest linear to guest physical translation of a 4K page */
+struct guest_tlb_entry {
+	uint64_t gen;		/* gtlb_gen of the vcpu when filled */
+	uint64_t cr3;
+	uint64_t gva_page;
+	uint64_t gpa_page;
+	uint64_t hpa_page;	/* 0 until the page is accessed */
+	uint32_t ept_gen;	/* ept_gen of the VM when filled */
+	uint32_t rights;	/* access rights of the paging entries */
+};
+
 struct vcpu_arch {
 	int cur_context;
 	struct cpu_context contexts[NR_WORLD];
@@ -171,6 +201,8 @@ struct vcpu_arch {
 	void *vmcs;
 	uint16_t vpid;
 
+	struct switch_context switch_ctx;
+
 	/* Holds the information needed for IRQ/exception handling. */
 	struct {
 		/* The number of the exception to raise. */
@@ -193,6 +225,12 @@ struct vcpu_arch {
 	uint64_t exit_qualification;
 	uint32_t inst_len;
 
+	/* Guest page walks done during the current VM exit, the guest may
+	 * change its paging structures or CR3 without exiting
+	 */
+	uint64_t gtlb_gen;
+	struct guest_tlb_entry gtlb[GUEST_TLB_ENTRIES];
+
 	/* Information related to secondary / AP VCPU start-up */
 	enum vm_cpu_mode cpu_mode;
 	uint8_t nr_sipi;
@@ -225,12 +263,19 @@ struct vcpu {
 	struct acrn_vlapic *vlapic;	/* per vCPU virtualized LAPIC */
 
 	struct list_head run_list; /* inserted to schedule runqueue */
+	struct sched_policy *sched_policy; /* policy picking this vcpu */
+	uint32_t sched_prio; /* fixed priority, for the RT policy */
+	uint64_t sched_vruntime; /* cycles run, for the fair-share policy */
+	uint64_t sched_start; /* TSC when last switched in */
+	uint32_t halted; /* off the runqueue until an event, after HLT */
 	uint64_t pending_pre_work; /* any pre work pending? */
 	bool launched; /* Whether the vcpu is launched on target pcpu */
 	uint32_t paused_cnt; /* how many times vcpu is paused */
 	uint32_t running; /* vcpu is picked up and run? */
 
 	struct io_request req; /* used by io/ept emulation */
+	/* MMIO handler matched by the last MMIO access of this vcpu */
+	struct mem_io_node *last_mmio_node;
 
 	/* save guest msr tsc aux register.
 	 * Before VMENTRY, save guest MSR_TSC_AUX to this fields.
@@ -246,6 +291,9 @@ struct vcpu {
 #endif
 	uint64_t reg_cached;
 	uint64_t reg_updated;
+
+	/* VM exit statistics, only updated by the pcpu of this vcpu */
+	struct acrn_vmexit_reason_stats exit_stats[ACRN_VMEXIT_REASON_NUM];
 };
 
 struct vcpu_dump {
@@ -291,6 +339,9 @@ void reset_vcpu(struct vcpu *vcpu);
 void pause_vcpu(struct vcpu *vcpu, enum vcpu_state new_state);
 void resume_vcpu(struct vcpu *vcpu);
 void schedule_vcpu(struct vcpu *vcpu);
+void halt_vcpu(struct vcpu *vcpu);
+void wake_halted_vcpu(struct vcpu *vcpu);
+void load_switch_context(struct vcpu *vcpu);
 int prepare_vcpu(struct vm *vm, uint16_t pcpu_id);
 
 void request_vcpu_pre_work(struct vcpu *vcpu, uint16_t pre_work_id);
@@ -56,6 +56,12 @@ int vlapic_pending_intr(struct acrn_vlapic *vlapic, uint32_t *vecptr);
  */
 void vlapic_intr_accepted(struct acrn_vlapic *vlapic, uint32_t vector);
 
+/*
+ * Returns true if virtual interrupt delivery has a vector requested (RVI)
+ * which the PPR does not block. Must run with the VMCS of the vcpu loaded.
+ */
+bool vlapic_has_pending_delivery_intr(struct vcpu *vcpu);
+
 struct acrn_vlapic *vm_lapic_from_pcpuid(struct vm *vm, uint16_t pcpu_id);
 int vlapic_rdmsr(struct vcpu *vcpu, uint32_t msr, uint64_t *rval);
 int vlapic_wrmsr(struct vcpu *vcpu, uint32_t msr, uint64_t wval);
@@ -113,8 +119,13 @@ void vlapic_restore(struct acrn_vlapic *vlapic, struct lapic_regs *regs);
 bool vlapic_enabled(struct acrn_vlapic *vlapic);
 uint64_t vlapic_apicv_get_apic_access_addr(__unused struct vm *vm);
 uint64_t vlapic_apicv_get_apic_page_addr(struct acrn_vlapic *vlapic);
+uint64_t vlapic_apicv_get_pir_desc_addr(struct acrn_vlapic *vlapic);
+void vlapic_set_posted_intr_vector(struct acrn_vlapic *vlapic, uint32_t vector);
+bool vlapic_has_posted_intr(struct acrn_vlapic *vlapic);
 void vlapic_apicv_inject_pir(struct acrn_vlapic *vlapic);
 int apic_access_vmexit_handler(struct vcpu *vcpu);
+void vlapic_set_tsc_deadline_msr(struct acrn_vlapic *vlapic, uint64_t val_arg);
+bool vlapic_apic_write_fast_path(struct acrn_vlapic *vlapic, uint32_t offset);
 int apic_write_vmexit_handler(struct vcpu *vcpu);
 int veoi_vmexit_handler(struct vcpu *vcpu);
 int tpr_below_threshold_vmexit_handler(__unused struct vcpu *vcpu);
@@ -20,6 +20,8 @@ enum vm_privilege_level {
 
 #define	MAX_VM_NAME_LEN		16
 #define INVALID_VM_ID 0xffffU
+/* vm_id is allocated from a 64-bit bitmap */
+#define MAX_VM_NUM	64U
 
 struct vm_hw_info {
 	uint16_t num_vcpus;	/* Number of total virtual cores */
@@ -101,14 +103,20 @@ struct vm_arch {
 	struct acrn_vioapic vioapic;	/* Virtual IOAPIC base address */
 	struct acrn_vpic vpic;      /* Virtual PIC */
 	/**
-	 * A link to the IO handler of this VM.
-	 * We only register io handle to this link
-	 * when create VM on sequences and ungister it when
-	 * destory VM. So there no need lock to prevent preempt.
-	 * Besides, there only a few io handlers now, we don't
-	 * need binary search temporary.
+	 * The IO handlers of this VM, sorted by the base port of their
+	 * ranges which never overlap, so that hv_emulate_pio() can find
+	 * the handler with a binary search.
+	 * We only register io handlers when create VM on sequences and
+	 * unregister them when destroy VM. So there no need lock to
+	 * prevent preempt.
 	 */
-	struct vm_io_handler *io_handler;
+	struct vm_io_handler *io_handlers[MAX_IO_HANDLER_NUM];
+	uint32_t io_handler_num;
+
+	/* EPT TLB flushes saved by batching, see ept_batch_begin() */
+	uint64_t ept_flush_avoided;
+	/* bumped on each EPT update */
+	uint32_t ept_gen;
 
 	/* reference to virtual platform to come here (as needed) */
 };
@@ -126,6 +134,16 @@ struct vcpuid_entry {
 	uint32_t padding;
 };
 
+/* The leaves of a CPUID range (basic, 0x4000_xxxx, 0x8000_xxxx) indexed */
+#define VCPUID_RANGE_NR		3U
+#define VCPUID_RANGE_LEAVES	64U
+
+/* The entries of a leaf in vcpuid_entries, one per subleaf */
+struct vcpuid_index {
+	uint8_t first;
+	uint8_t nr;
+};
+
 struct vm {
 	uint16_t vm_id;		    /* Virtual machine identifier */
 	struct vm_hw_info hw;	/* Reference to this VM's HW information */
@@ -139,9 +157,14 @@ struct vm {
 	struct list_head list; /* list of VM */
 	spinlock_t spinlock;	/* Spin-lock used to protect VM modifications */
 
-	struct list_head mmio_list; /* list for mmio. This list is not updated
-				     * when vm is active. So no lock needed
-				     */
+	/* MMIO handlers sorted by the start of their ranges. They are not
+	 * updated when vm is active. So no lock needed
+	 */
+	struct mem_io_node *mmio_nodes[MAX_MMIO_NODE_NUM];
+	uint32_t mmio_node_num;
+
+	struct vm_posted_io posted_io;
+	struct vm_doorbells doorbells;
 
 	struct _vm_shared_memory *shared_memory_area;
 
@@ -153,6 +176,9 @@ struct vm {
 	unsigned char GUID[16];
 	struct secure_world_control sworld_control;
 
+	/* RT priority of the vcpus, 0 for the fair-share policy */
+	uint32_t sched_prio;
+
 	/* Secure World's snapshot
 	 * Currently, Secure World is only running on vcpu[0],
 	 * so the snapshot only stores the vcpu0's run_context
@@ -162,6 +188,8 @@ struct vm {
 
 	uint32_t vcpuid_entry_nr, vcpuid_level, vcpuid_xlevel;
 	struct vcpuid_entry vcpuid_entries[MAX_VM_VCPUID_ENTRIES];
+	/* leaf - range base to entries, indexed by range (leaf >> 30) */
+	struct vcpuid_index vcpuid_index[VCPUID_RANGE_NR][VCPUID_RANGE_LEAVES];
 #ifdef CONFIG_PARTITION_MODE
 	struct vm_description	*vm_desc;
 	struct vpci vpci;
@@ -185,6 +213,8 @@ struct vm_description {
 	uint16_t               vm_hw_num_cores;   /* Number of virtual cores */
 	/* Whether secure world is supported for current VM. */
 	bool                   sworld_supported;
+	/* Whether the vcpus are scheduled with the RT policy */
+	bool                   rt_sched;
 #ifdef CONFIG_PARTITION_MODE
 	uint8_t			vm_id;
 	struct mptable_info	*mptable;
@@ -86,10 +86,14 @@ struct vm_io_handler_desc {
 };
 
 struct vm_io_handler {
-	struct vm_io_handler *next;
 	struct vm_io_handler_desc desc;
+	/** Number of port I/O accesses dispatched to this handler. */
+	uint64_t hits;
 };
 
+/* Maximum number of port I/O handlers which can be registered per VM */
+#define MAX_IO_HANDLER_NUM	32U
+
 #define IO_ATTR_R               0U
 #define IO_ATTR_RW              1U
 #define IO_ATTR_NO_ACCESS       2U
@@ -103,11 +107,57 @@ typedef int (*hv_mem_io_handler_t)(struct vcpu *vcpu, struct io_request *io_req,
 struct mem_io_node {
 	hv_mem_io_handler_t read_write;
 	void *handler_private_data;
-	struct list_head list;
 	uint64_t range_start;
 	uint64_t range_end;
 };
 
+/* Maximum number of MMIO handlers which can be registered per VM */
+#define MAX_MMIO_NODE_NUM	16U
+
+/* Maximum number of posted write ranges per VM */
+#define MAX_POSTED_RANGE_NUM	16U
+
+struct posted_range {
+	uint32_t type;
+	uint64_t start;
+	uint64_t end;
+};
+
+/* Writes posted to the device model without waiting for their completion */
+struct vm_posted_io {
+	/* Protects ring production and the ranges */
+	spinlock_t lock;
+	struct vhm_posted_ring *ring;
+	/* Private copy of ring->tail, which SOS may corrupt */
+	uint32_t tail;
+	uint32_t range_num;
+	struct posted_range ranges[MAX_POSTED_RANGE_NUM];
+	/* Writes posted and writes falling back to vhm_request as ring full */
+	uint64_t posted;
+	uint64_t ring_full;
+};
+
+/* Maximum number of doorbells per VM */
+#define MAX_DOORBELL_NUM	32U
+
+struct doorbell {
+	uint32_t type;
+	uint16_t index;
+	uint8_t size;
+	bool datamatch;
+	uint64_t address;
+	uint64_t data;
+};
+
+/* Writes completed by setting a bit in the doorbell page */
+struct vm_doorbells {
+	/* Protects the page and the doorbells */
+	spinlock_t lock;
+	union acrn_doorbell_page *page;
+	uint32_t num;
+	struct doorbell entries[MAX_DOORBELL_NUM];
+};
+
 /* External Interfaces */
 int32_t pio_instr_vmexit_handler(struct vcpu *vcpu);
 void   setup_io_bitmap(struct vm *vm);
@@ -116,6 +166,9 @@ void   allow_guest_io_access(struct vm *vm, uint32_t address_arg, uint32_t nbyte
 void   register_io_emulation_handler(struct vm *vm, struct vm_io_range *range,
 		io_read_fn_t io_read_fn_ptr,
 		io_write_fn_t io_write_fn_ptr);
+#ifdef HV_DEBUG
+void get_vm_io_info(char *str_arg, int str_max, uint16_t vmid);
+#endif /* HV_DEBUG */
 
 int register_mmio_emulation_handler(struct vm *vm,
 	hv_mem_io_handler_t read_write, uint64_t start,
@@ -129,5 +182,10 @@ int32_t emulate_io(struct vcpu *vcpu, struct io_request *io_req);
 void emulate_io_post(struct vcpu *vcpu);
 
 int32_t acrn_insert_request_wait(struct vcpu *vcpu, struct io_request *io_req);
+int32_t acrn_insert_posted_request(struct vcpu *vcpu,
+		struct io_request *io_req);
+int32_t set_posted_range(struct vm *vm, struct acrn_posted_range *range);
+int32_t acrn_ring_doorbell(struct vcpu *vcpu, struct io_request *io_req);
+int32_t set_doorbell(struct vm *vm, struct acrn_doorbell *doorbell);
 
 #endif /* IOREQ_H */
@@ -19,6 +19,8 @@
 
 #define VECTOR_TIMER		0xEFU
 #define VECTOR_NOTIFY_VCPU	0xF0U
+#define VECTOR_POSTED_INTR	0xF2U
+#define VECTOR_POSTED_INTR_WAKEUP	0xF3U
 #define VECTOR_VIRT_IRQ_VHM	0xF7U
 #define VECTOR_SPURIOUS		0xFFU
 
@@ -29,6 +31,8 @@
 
 #define TIMER_IRQ		(NR_IRQS - 1U)
 #define NOTIFY_IRQ		(NR_IRQS - 2U)
+#define POSTED_INTR_IRQ		(NR_IRQS - 3U)
+#define POSTED_INTR_WAKEUP_IRQ	(NR_IRQS - 4U)
 
 #define DEFAULT_DEST_MODE	IOAPIC_RTE_DESTLOG
 #define DEFAULT_DELIVERY_MODE	IOAPIC_RTE_DELLOPRI
@@ -86,6 +90,8 @@ uint32_t irq_to_vector(uint32_t irq);
 #define	MSI_ADDR_BASE	0xfee00000U
 #define	MSI_ADDR_RH	0x00000008U	/* Redirection Hint */
 #define	MSI_ADDR_LOG	0x00000004U	/* Destination Mode */
+#define	MSI_ADDR_REMAP	0x00000010U	/* Remappable Format */
+#define	MSI_ADDR_HANDLE_SHIFT	5U	/* Handle[14:0] */
 
 /* RFLAGS */
 #define HV_ARCH_VCPU_RFLAGS_IF              (1U<<9)
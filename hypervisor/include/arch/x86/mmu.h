@@ -132,19 +132,27 @@ static inline void clflush(volatile void *p)
 	asm volatile ("clflush (%0)" :: "r"(p));
 }
 
+/* Max EPT tables merge_page_table() may unlink per ept_mr_* call */
+#define EPT_MERGED_MAX		64U
+
 /* External Interfaces */
 void    destroy_ept(struct vm *vm);
 uint64_t  gpa2hpa(const struct vm *vm, uint64_t gpa);
 uint64_t  local_gpa2hpa(const struct vm *vm, uint64_t gpa, uint32_t *size);
 uint64_t  hpa2gpa(const struct vm *vm, uint64_t hpa);
-int ept_mr_add(const struct vm *vm, uint64_t *pml4_page, uint64_t hpa,
+void ept_batch_begin(struct vm *vm);
+void ept_batch_end(struct vm *vm);
+int ept_mr_add(struct vm *vm, uint64_t *pml4_page, uint64_t hpa,
 	uint64_t gpa, uint64_t size, uint64_t prot_orig);
-int ept_mr_modify(const struct vm *vm, uint64_t *pml4_page,
+int ept_mr_modify(struct vm *vm, uint64_t *pml4_page,
 	uint64_t gpa, uint64_t size,
 	uint64_t prot_set, uint64_t prot_clr);
-int ept_mr_del(const struct vm *vm, uint64_t *pml4_page,
+int ept_mr_del(struct vm *vm, uint64_t *pml4_page,
 	uint64_t gpa, uint64_t size);
 void free_ept_mem(uint64_t *pml4_page);
+#ifdef HV_DEBUG
+void get_ept_stats(char *str_arg, int str_max, uint16_t vmid);
+#endif /* HV_DEBUG */
 int     ept_violation_vmexit_handler(struct vcpu *vcpu);
 int     ept_misconfig_vmexit_handler(__unused struct vcpu *vcpu);
 
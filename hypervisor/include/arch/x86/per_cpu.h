@@ -9,12 +9,12 @@
 
 #include <hypervisor.h>
 #include <bsp_extern.h>
+#include <timer.h>
 #include <schedule.h>
 #include <common/irq.h>
 #include <arch/x86/irq.h>
 #include <sbuf.h>
 #include <gdt.h>
-#include <timer.h>
 #include <logmsg.h>
 #include "arch/x86/guest/instr_emul.h"
 
@@ -27,6 +27,9 @@ struct per_cpu_region {
 #endif
 	uint64_t irq_count[NR_IRQS];
 	uint64_t softirq_pending;
+	/* passthrough interrupts for SOFTIRQ_PTDEV, see ptdev.c */
+	void *ptdev_softirq_head;
+	void *ptdev_softirq_fifo;
 	uint64_t spurious;
 	uint64_t vmxon_region_pa;
 	struct shared_buf *earlylog_sbuf;
@@ -41,6 +44,22 @@ struct per_cpu_region {
 	struct host_gdt gdt;
 	struct tss_64 tss;
 	enum cpu_state cpu_state;
+	/* Bumped on quiescent states, odd in guest mode, see unpublish_vm() */
+	uint64_t vm_qs_seq;
+	struct cpu_idle_info idle;
+#ifdef CONFIG_LOCKSTAT
+	struct lockstat_counters lockstat[LOCKSTAT_MAX_LOCKS];
+#endif
+	/* Queue nodes of the MCS locks held or waited for by this pcpu */
+	struct mcs_node mcs_nodes[MCS_NODES_PER_CPU];
+	uint64_t mcs_nodes_used;
+	/* EPT update batch opened by this pcpu, see ept_batch_begin() */
+	void *ept_batch_vm;
+	uint32_t ept_batch_depth;
+	bool ept_flush_pending;
+	/* EPT tables unlinked by merge_page_table(), see ept_free_merged() */
+	void *ept_merged[EPT_MERGED_MAX];
+	uint32_t ept_merged_num;
 	uint8_t mc_stack[CONFIG_STACK_SIZE] __aligned(16);
 	uint8_t df_stack[CONFIG_STACK_SIZE] __aligned(16);
 	uint8_t sf_stack[CONFIG_STACK_SIZE] __aligned(16);
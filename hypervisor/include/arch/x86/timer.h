@@ -14,12 +14,25 @@ enum tick_mode {
 	TICK_MODE_PERIODIC,
 };
 
+/* Maximum number of vcpus sharing a pcpu, see allocate_pcpu() */
+#define MAX_VCPUS_PER_PCPU	62U
+/*
+ * Maximum number of active timers per pcpu: the vlapic timer of each of its
+ * vcpus, the scheduler slice timer and the console timer. A pcpu never has
+ * more timers than that, so add_timer() does not fail on a full heap.
+ */
+#define MAX_TIMER_NUM		(MAX_VCPUS_PER_PCPU + 2U)
+#define INVALID_TIMER_IDX	0xffffffffU
+
 struct per_cpu_timers {
-	struct list_head timer_list;	/* it's for runtime active timer list */
+	/* min-heap of the active timers, ordered by fire_tsc */
+	struct hv_timer *heap[MAX_TIMER_NUM];
+	uint32_t timer_num;
 };
 
 struct hv_timer {
-	struct list_head node;		/* link all timers */
+	uint32_t heap_idx;		/* index in the heap, if active */
+	uint16_t pcpu_id;		/* pcpu of the heap, if active */
 	int mode;			/* timer mode: one-shot or periodic */
 	uint64_t fire_tsc;		/* tsc deadline to interrupt */
 	uint64_t period_in_cycle;	/* period of the periodic timer in unit of TSC cycles */
@@ -28,8 +41,8 @@ struct hv_timer {
 };
 
 /*
- * Don't initialize a timer twice if it has been add to the timer list
- * after call add_timer. If u want, delete the timer from the list first.
+ * Don't initialize a timer twice if it has been add to the timer heap
+ * after call add_timer. If u want, delete the timer from the heap first.
  */
 static inline void initialize_timer(struct hv_timer *timer,
 				timer_handle_t func,
@@ -44,7 +57,7 @@ static inline void initialize_timer(struct hv_timer *timer,
 		timer->fire_tsc = fire_tsc;
 		timer->mode = mode;
 		timer->period_in_cycle = period_in_cycle;
-		INIT_LIST_HEAD(&timer->node);
+		timer->heap_idx = INVALID_TIMER_IDX;
 	}
 }
 
@@ -47,8 +47,12 @@ int cr_access_vmexit_handler(struct vcpu *vcpu);
 #define VM_EXIT_IO_INSTRUCTION_PORT_NUMBER(exit_qual) \
 	(VM_EXIT_QUALIFICATION_BIT_MASK(exit_qual, 31U, 16U) >> 16U)
 
+void vmexit_account(struct vcpu *vcpu, uint32_t basic_exit_reason,
+		uint64_t cycles);
+
 #ifdef HV_DEBUG
 void get_vmexit_profile(char *str_arg, int str_max);
+void get_vm_vmexit_stats(char *str_arg, int str_max, uint16_t vmid);
 #endif /* HV_DEBUG */
 
 #endif /* VMEXIT_H_ */
@@ -9,6 +9,7 @@
 
 /* 16-bit control fields */
 #define VMX_VPID						0x00000000U
+#define VMX_POSTED_INTR_VECTOR		0x00000002U
 /* 16-bit guest-state fields */
 #define VMX_GUEST_ES_SEL    0x00000800U
 #define VMX_GUEST_CS_SEL    0x00000802U
@@ -48,6 +49,8 @@
 #define VMX_VIRTUAL_APIC_PAGE_ADDR_HIGH 0x00002013U
 #define VMX_APIC_ACCESS_ADDR_FULL  0x00002014U
 #define VMX_APIC_ACCESS_ADDR_HIGH  0x00002015U
+#define VMX_PIR_DESC_ADDR_FULL     0x00002016U
+#define VMX_PIR_DESC_ADDR_HIGH     0x00002017U
 #define VMX_EPT_POINTER_FULL      0x0000201AU
 #define VMX_EPT_POINTER_HIGH      0x0000201BU
 #define	VMX_EOI_EXIT0_FULL			0x0000201CU
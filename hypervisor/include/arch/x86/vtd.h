@@ -482,6 +482,9 @@ struct iommu_domain *create_iommu_domain(uint16_t vm_id,
 /* Destroy the iommu domain */
 void destroy_iommu_domain(struct iommu_domain *domain);
 
+/* Invalidate the cached translations of a iommu domain on all the units */
+void iommu_flush_domain(const struct iommu_domain *domain);
+
 /* Enable translation of iommu*/
 void enable_iommu(void);
 
@@ -494,6 +497,30 @@ void suspend_iommu(void);
 /* resume iomu */
 void resume_iommu(void);
 
+#define INVALID_IRTE_INDEX	0xFFFFU
+
+/* Whether MSIs of the device specified by bdf go through an interrupt
+ * remapping table
+ */
+bool iommu_intr_remapping_supported(uint16_t bdf);
+
+/* Whether the remapping hardware of the device can post interrupts */
+bool iommu_posted_intr_supported(uint16_t bdf);
+
+/* Allocate an interrupt remapping table entry for the device */
+int32_t iommu_alloc_irte(uint16_t bdf, uint16_t *index);
+
+/* Clear and free an interrupt remapping table entry */
+void iommu_free_irte(uint16_t bdf, uint16_t index);
+
+/* Remap to a host vector and logical destination */
+void iommu_set_remapped_irte(uint16_t bdf, uint16_t index, uint32_t vector,
+	uint32_t dest, uint32_t delmode);
+
+/* Post a guest vector to the posted-interrupt descriptor at pid_addr */
+void iommu_set_posted_irte(uint16_t bdf, uint16_t index, uint32_t vector,
+	uint64_t pid_addr);
+
 /* iommu initialization */
 void init_iommu(void);
 void init_iommu_vm0_domain(struct vm *vm0);
@@ -52,9 +52,8 @@ int32_t hcall_get_api_version(struct vm *vm, uint64_t param);
 /**
  * @brief create virtual machine
  *
- * Create a virtual machine based on parameter, currently there is no
- * limitation for calling times of this function, will add MAX_VM_NUM
- * support later.
+ * Create a virtual machine based on parameter, at most MAX_VM_NUM
+ * virtual machines can exist at the same time.
  *
  * @param vm Pointer to VM data structure
  * @param param guest physical memory address. This gpa points to
@@ -90,6 +89,24 @@ int32_t hcall_destroy_vm(uint16_t vmid);
  */
 int32_t hcall_reset_vm(uint16_t vmid);
 
+/**
+ * @brief get VM exit statistics of a vcpu
+ *
+ * Copy a snapshot of the per exit reason VM exit counters and latency
+ * histograms of a vcpu of the target VM to the caller. The snapshot is not
+ * atomic as the vcpu may keep running.
+ * The function will return -1 if the target VM or vcpu does not exist.
+ *
+ * @param vm Pointer to VM data structure
+ * @param vmid ID of the VM
+ * @param param guest physical address. This gpa points to
+ *              struct acrn_vmexit_stats
+ *
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_get_vcpu_exit_stats(struct vm *vm, uint16_t vmid,
+		uint64_t param);
+
 /**
  * @brief start virtual machine
  *
@@ -219,6 +236,82 @@ int32_t hcall_set_ioreq_buffer(struct vm *vm, uint16_t vmid, uint64_t param);
  */
 int32_t hcall_notify_ioreq_finish(uint16_t vmid, uint16_t vcpu_id);
 
+/**
+ * @brief run a batch of operations for a VM
+ *
+ * Run the irqline, MSI injection and ioreq completion operations of the
+ * batch in order, and write the status of each one back to its record.
+ * The VM is looked up only once for the whole batch.
+ *
+ * @param vm Pointer to VM data structure
+ * @param param guest physical address. This gpa points to
+ *              struct acrn_multicall
+ *
+ * @return 0 if the batch was run, non-zero if it could not be read.
+ */
+int32_t hcall_multicall(struct vm *vm, uint64_t param);
+
+/**
+ * @brief set posted write ring
+ *
+ * Set the ring into which writes to the posted ranges of a VM are queued.
+ *
+ * @param vm Pointer to VM data structure
+ * @param vmid ID of the VM
+ * @param param guest physical address. This gpa points to
+ *              struct acrn_set_ioreq_buffer, whose req_buf is the gpa of a
+ *              struct vhm_posted_ring
+ *
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_set_posted_ring(struct vm *vm, uint16_t vmid, uint64_t param);
+
+/**
+ * @brief add or remove a posted write range
+ *
+ * Writes to a posted range are queued into the posted write ring of the VM
+ * and the vCPU resumes without waiting for the device model.
+ *
+ * @param vm Pointer to VM data structure
+ * @param vmid ID of the VM
+ * @param param guest physical address. This gpa points to
+ *              struct acrn_posted_range
+ *
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_set_posted_range(struct vm *vm, uint16_t vmid, uint64_t param);
+
+/**
+ * @brief set doorbell page
+ *
+ * Set the page holding the pending doorbell bitmap of a VM.
+ *
+ * @param vm Pointer to VM data structure
+ * @param vmid ID of the VM
+ * @param param guest physical address. This gpa points to
+ *              struct acrn_set_ioreq_buffer, whose req_buf is the gpa of a
+ *              union acrn_doorbell_page
+ *
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_set_doorbell_page(struct vm *vm, uint16_t vmid, uint64_t param);
+
+/**
+ * @brief add or remove a doorbell
+ *
+ * A write matching a doorbell completes in the hypervisor by setting the
+ * bit of the doorbell in the doorbell page, and the vCPU resumes without
+ * waiting for the device model.
+ *
+ * @param vm Pointer to VM data structure
+ * @param vmid ID of the VM
+ * @param param guest physical address. This gpa points to
+ *              struct acrn_doorbell
+ *
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_set_doorbell(struct vm *vm, uint16_t vmid, uint64_t param);
+
 /**
  * @brief setup ept memory mapping
  *
@@ -354,6 +447,17 @@ int32_t hcall_setup_sbuf(struct vm *vm, uint64_t param);
   */
 int32_t hcall_setup_hv_npk_log(struct vm *vm, uint64_t param);
 
+/**
+ * @brief Setup the trace event filter.
+ *
+ * @param vm Pointer to VM data structure
+ * @param param guest physical address. This gpa points to
+ *              struct trace_filter_param
+ *
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_setup_trace_filter(struct vm *vm, uint64_t param);
+
 /**
  * @brief Get VCPU Power state.
  *
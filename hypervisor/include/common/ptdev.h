@@ -58,19 +58,25 @@ struct ptdev_remapping_info {
 	struct vm *vm;
 	uint32_t active;	/* 1=active, 0=inactive and to free*/
 	uint32_t allocated_pirq;
-	struct list_head softirq_node;
+	/* link and state in the softirq queue of a pcpu */
+	struct ptdev_remapping_info *softirq_next;
+	uint32_t softirq_state;
 	struct list_head entry_node;
 	struct ptdev_msi_info msi;
+	/* interrupt remapping table entry of a MSI, INVALID_IRTE_INDEX if
+	 * the MSI is programmed in compatibility format
+	 */
+	uint16_t irte_idx;
 };
 
 extern struct list_head ptdev_list;
-extern spinlock_t ptdev_lock;
+extern mcs_spinlock_t ptdev_lock;
 
-void ptdev_softirq(__unused uint16_t cpu_id);
+void ptdev_softirq(uint16_t pcpu_id);
 void ptdev_init(void);
 void ptdev_release_all_entries(struct vm *vm);
 
-struct ptdev_remapping_info *ptdev_dequeue_softirq(void);
+struct ptdev_remapping_info *ptdev_dequeue_softirq(uint16_t pcpu_id);
 struct ptdev_remapping_info *alloc_entry(struct vm *vm,
 		uint32_t intr_type);
 void release_entry(struct ptdev_remapping_info *entry);
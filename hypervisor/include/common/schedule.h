@@ -10,12 +10,45 @@
 #define	NEED_RESCHEDULE		(1U)
 #define	NEED_OFFLINE		(2U)
 
+/* Time slice of vcpus sharing a pcpu, in us */
+#define SCHED_SLICE_US		10000U
+/* Priority of the vcpus of VMs created with RT_SCHED_ENABLED */
+#define SCHED_RT_PRIO_DEFAULT	1U
+
+struct sched_context;
+
+/*
+ * A scheduling policy picks, among the runnable vcpus of a pcpu which
+ * follow it, the one to run next. Policies are consulted in precedence
+ * order (RT first), so a runnable RT vcpu always runs before fair-share
+ * ones. Runnable vcpus of a policy are time sliced among each other.
+ */
+struct sched_policy {
+	const char *name;
+	/* Runnable vcpu of this policy to run next, or NULL */
+	struct vcpu *(*pick_next)(struct sched_context *ctx);
+	/* The vcpu was made runnable */
+	void (*enqueue)(struct sched_context *ctx, struct vcpu *vcpu);
+	/* The vcpu ran for cycles */
+	void (*charge)(struct sched_context *ctx, struct vcpu *vcpu,
+			uint64_t cycles);
+};
+
+extern struct sched_policy sched_rt_policy;
+extern struct sched_policy sched_fair_policy;
+
 struct sched_context {
 	spinlock_t runqueue_lock;
 	struct list_head runqueue;
 	uint64_t flags;
 	struct vcpu *curr_vcpu;
 	spinlock_t scheduler_lock;
+	/* Number of vcpus assigned to this pcpu */
+	uint32_t nr_vcpus;
+	/* Lower bound of the vruntime of runnable fair-share vcpus */
+	uint64_t min_vruntime;
+	/* Preempts the current vcpu at the end of its time slice */
+	struct hv_timer slice_timer;
 };
 
 void init_scheduler(void);
@@ -28,6 +61,8 @@ void free_pcpu(uint16_t pcpu_id);
 
 void add_vcpu_to_runqueue(struct vcpu *vcpu);
 void remove_vcpu_from_runqueue(struct vcpu *vcpu);
+void set_vcpu_sched_policy(struct vcpu *vcpu, struct sched_policy *policy,
+		uint32_t prio);
 
 void default_idle(void);
 
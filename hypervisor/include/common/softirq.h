@@ -9,7 +9,8 @@
 
 #define SOFTIRQ_TIMER		0U
 #define SOFTIRQ_PTDEV		1U
-#define NR_SOFTIRQS		2U
+#define SOFTIRQ_POSTED_INTR	2U
+#define NR_SOFTIRQS		3U
 #define SOFTIRQ_MASK		((1UL << NR_SOFTIRQS) - 1UL)
 
 typedef void (*softirq_handler)(uint16_t cpu_id);
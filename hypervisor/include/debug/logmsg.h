@@ -20,12 +20,38 @@
 #define LOG_FLAG_STDOUT		0x00000001U
 #define LOG_FLAG_MEMORY		0x00000002U
 #define LOG_FLAG_NPK		0x00000004U
+/* Log binary records instead of text into memory */
+#define LOG_FLAG_BINARY		0x00000008U
 #define LOG_ENTRY_SIZE	80
 /* Size of buffer used to store a message being logged,
  * should align to LOG_ENTRY_SIZE.
  */
 #define LOG_MESSAGE_MAX_SIZE	(4 * LOG_ENTRY_SIZE)
 
+/* Text messages start with '[', binary records with this byte */
+#define LOG_BIN_MAGIC		0xb1U
+#define LOG_BIN_MAX_ARGS	16U
+
+/*
+ * Binary log record, which takes one or more LOG_ENTRY_SIZE entries of the
+ * hvlog sbuf. Only the first nr_args arguments are stored, and the strings
+ * of the %s arguments follow them. The argument of a %s is the offset of its
+ * string there. acrnlog formats the record with the format string found at
+ * fmt_id in the .rodata dump of the hypervisor (acrn.logdict).
+ */
+struct log_bin_record {
+	uint8_t magic;		/* LOG_BIN_MAGIC */
+	uint8_t nr_entries;	/* sbuf entries taken by the record */
+	uint8_t severity;
+	uint8_t nr_args;
+	uint32_t fmt_id;	/* offset of the format string in .rodata */
+	uint64_t timestamp;	/* in us */
+	uint32_t seq;
+	uint16_t pcpu_id;
+	uint16_t str_len;	/* size of the strings after the arguments */
+	uint64_t args[LOG_BIN_MAX_ARGS];
+};
+
 #if defined(HV_DEBUG)
 
 extern uint32_t console_loglevel;
@@ -34,6 +60,8 @@ extern uint32_t npk_loglevel;
 void init_logmsg(__unused uint32_t mem_size, uint32_t flags);
 void print_logmsg_buffer(uint16_t pcpu_id);
 void do_logmsg(uint32_t severity, const char *fmt, ...);
+void set_logmsg_binary(bool enable);
+bool is_logmsg_binary(void);
 
 void asm_assert(int32_t line, const char *file, const char *txt);
 
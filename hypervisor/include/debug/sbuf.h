@@ -12,9 +12,10 @@
 #ifndef SHARED_BUFFER_H
 #define SHARED_BUFFER_H
 
-#define SBUF_MAGIC	0x5aa57aa71aa13aa3UL
+/* Changes with the layout of struct shared_buf */
+#define SBUF_MAGIC	0x5aa57aa71aa13aa4UL
 #define SBUF_MAX_SIZE	(1 << 22)
-#define SBUF_HEAD_SIZE	64
+#define SBUF_HEAD_SIZE	192
 
 /* sbuf flags */
 #define OVERRUN_CNT_EN	(1 << 0) /* whether overrun counting is enabled */
@@ -25,6 +26,13 @@
  * buffer empty: tail == head
  * buffer full:  (tail + ele_size) % size == head
  *
+ * A single producer and a single consumer may access the sbuf without a
+ * lock. The producer only writes tail, which it stores after the elements,
+ * and the consumer only writes head, which it stores after reading them.
+ * With OVERWRITE_EN the producer also moves head forward, so both sides
+ * update head with cmpxchg and the consumer drops what it read if head
+ * moved under it.
+ *
  *             Base of memory for elements
  *                |
  *                |
@@ -42,17 +50,23 @@ enum {
 	ACRN_SBUF_ID_MAX,
 };
 
-/* Make sure sizeof(struct shared_buf) == SBUF_HEAD_SIZE */
+/* Make sure sizeof(struct shared_buf) == SBUF_HEAD_SIZE, with the read-mostly
+ * fields, the producer side and the consumer side on separate cache lines.
+ */
 struct shared_buf {
 	uint64_t magic;
 	uint32_t ele_num;	/* number of elements */
 	uint32_t ele_size;	/* sizeof of elements */
-	uint32_t head;		/* offset from base, to read */
-	uint32_t tail;		/* offset from base, to write */
 	uint64_t flags;
-	uint32_t overrun_cnt;	/* count of overrun */
 	uint32_t size;		/* ele_num * ele_size */
-	uint32_t padding[6];
+	uint32_t padding0[9];
+
+	uint32_t tail;		/* offset from base, to write */
+	uint32_t overrun_cnt;	/* count of overrun */
+	uint32_t padding1[14];
+
+	uint32_t head;		/* offset from base, to read */
+	uint32_t padding2[15];
 };
 
 #ifdef HV_DEBUG
@@ -76,6 +90,13 @@ struct shared_buf *sbuf_allocate(uint32_t ele_num, uint32_t ele_size);
 void sbuf_free(struct shared_buf *sbuf);
 int sbuf_get(struct shared_buf *sbuf, uint8_t *data);
 int sbuf_put(struct shared_buf *sbuf, uint8_t *data);
+uint32_t sbuf_get_many(struct shared_buf *sbuf, uint8_t *data, uint32_t nr);
+uint32_t sbuf_put_many(struct shared_buf *sbuf, const uint8_t *data,
+		uint32_t nr);
+/* Tell if an element is the first one of a record, for sbuf_put_record() */
+typedef bool (*sbuf_rec_start_t)(const uint8_t *ele);
+bool sbuf_put_record(struct shared_buf *sbuf, const uint8_t *data,
+		uint32_t nr, sbuf_rec_start_t rec_start);
 int sbuf_share_setup(uint16_t pcpu_id, uint32_t sbuf_id, uint64_t *hva);
 
 #else /* HV_DEBUG */
@@ -124,6 +145,31 @@ static inline int sbuf_put(
 	return 0;
 }
 
+static inline uint32_t sbuf_get_many(
+		__unused struct shared_buf *sbuf,
+		__unused uint8_t *data,
+		__unused uint32_t nr)
+{
+	return 0U;
+}
+
+static inline uint32_t sbuf_put_many(
+		__unused struct shared_buf *sbuf,
+		__unused const uint8_t *data,
+		__unused uint32_t nr)
+{
+	return 0U;
+}
+
+static inline bool sbuf_put_record(
+		__unused struct shared_buf *sbuf,
+		__unused const uint8_t *data,
+		__unused uint32_t nr,
+		__unused bool (*rec_start)(const uint8_t *ele))
+{
+	return false;
+}
+
 static inline int sbuf_share_setup(
 		__unused uint16_t pcpu_id,
 		__unused uint32_t sbuf_id,
@@ -45,6 +45,7 @@
 
 #include <sbuf.h>
 
+#define TRACE_STR_CONT			0xFBU
 #define TRACE_CUSTOM			0xFCU
 #define TRACE_FUNC_ENTER		0xFDU
 #define TRACE_FUNC_EXIT			0xFEU
@@ -75,13 +76,44 @@ struct trace_entry {
 	} payload;
 } __attribute__((aligned(8)));
 
+/* Max length of the string of TRACE_STR_VAR, including the NUL */
+#define TRACE_STR_MAX			128U
+/* Characters of the string of TRACE_STR_VAR per entry */
+#define TRACE_STR_CHUNK			15U
+
+/* Set by HC_SETUP_TRACE_FILTER, all the events are traced by default */
+struct trace_filter {
+	/* bitmap of the disabled event indexes */
+	uint64_t ev_disabled[ACRN_TRACE_EVENT_MAX / 64U];
+	/* only trace the pcpus which last ran a vcpu of vm_id */
+	bool vm_filter;
+	uint16_t vm_id;
+};
+
+extern struct trace_filter trace_filter;
+
+bool trace_vm_check(uint16_t cpu_id);
+void trace_filter_setup(const struct trace_filter_param *param);
+
 static inline bool
-trace_check(uint16_t cpu_id, __unused uint32_t evid)
+trace_check(uint16_t cpu_id, uint32_t evid)
 {
+	uint32_t idx = ACRN_TRACE_EVENT_INDEX(evid);
+
+	/* A disabled event costs this single branch */
+	if ((trace_filter.ev_disabled[idx >> 6U] & (1UL << (idx & 0x3fU)))
+			!= 0UL) {
+		return false;
+	}
+
 	if (per_cpu(sbuf, cpu_id)[ACRN_TRACE] == NULL) {
 		return false;
 	}
 
+	if (trace_filter.vm_filter && !trace_vm_check(cpu_id)) {
+		return false;
+	}
+
 	return true;
 }
 
@@ -153,8 +185,8 @@ TRACE_6C(uint32_t evid, uint8_t a1, uint8_t a2, uint8_t a3,
 	trace_put(cpu_id, evid, 8U, &entry);
 }
 
-#define TRACE_ENTER TRACE_16STR(TRACE_FUNC_ENTER, __func__)
-#define TRACE_EXIT TRACE_16STR(TRACE_FUNC_EXIT, __func__)
+#define TRACE_ENTER TRACE_STR_VAR(TRACE_FUNC_ENTER, __func__)
+#define TRACE_EXIT TRACE_STR_VAR(TRACE_FUNC_EXIT, __func__)
 
 static inline void
 TRACE_16STR(uint32_t evid, const char name[])
@@ -180,6 +212,53 @@ TRACE_16STR(uint32_t evid, const char name[])
 	trace_put(cpu_id, evid, 16U, &entry);
 }
 
+/*
+ * Trace a string of up to TRACE_STR_MAX - 1 characters. Its first
+ * TRACE_STR_CHUNK bytes go NUL-terminated into the entry of evid, as with
+ * TRACE_16STR, and the rest into TRACE_STR_CONT entries which immediately
+ * follow it in the sbuf. The first byte of their payload is the length of
+ * the string, the next TRACE_STR_CHUNK bytes its next characters.
+ * All the entries have a n_data of 16.
+ */
+static inline void
+TRACE_STR_VAR(uint32_t evid, const char str[])
+{
+	struct trace_entry entry;
+	uint16_t cpu_id = get_cpu_id();
+	uint64_t rflags;
+	size_t len, off, i;
+	char *dst;
+	uint32_t id = evid;
+
+	if (!trace_check(cpu_id, evid)) {
+		return;
+	}
+
+	len = strnlen_s(str, TRACE_STR_MAX - 1U);
+
+	/* Keep the entries of the string together in the sbuf */
+	CPU_INT_ALL_DISABLE(&rflags);
+	off = 0U;
+	do {
+		entry.payload.fields_64.e = 0UL;
+		entry.payload.fields_64.f = 0UL;
+		if (off == 0U) {
+			dst = entry.payload.str;
+		} else {
+			entry.payload.str[0] = (char)len;
+			dst = &entry.payload.str[1];
+		}
+		for (i = 0U; (i < TRACE_STR_CHUNK) && ((off + i) < len); i++) {
+			dst[i] = str[off + i];
+		}
+
+		trace_put(cpu_id, id, 16U, &entry);
+		id = TRACE_STR_CONT;
+		off += TRACE_STR_CHUNK;
+	} while (off < len);
+	CPU_INT_ALL_RESTORE(rflags);
+}
+
 #else /* HV_DEBUG */
 
 #define TRACE_ENTER
@@ -212,6 +291,11 @@ TRACE_6C(__unused uint32_t evid,
 {
 }
 
+static inline void
+TRACE_STR_VAR(__unused uint32_t evid, __unused const char str[])
+{
+}
+
 #endif /* HV_DEBUG */
 
 #endif /* TRACE_H */
@@ -27,5 +27,8 @@ void *calloc(unsigned int num_elements, unsigned int element_size);
 void *alloc_page(void);
 void *alloc_pages(unsigned int page_num);
 void free(void *ptr);
+#ifdef HV_DEBUG
+void get_mem_stats(char *str_arg, int str_max);
+#endif /* HV_DEBUG */
 
 #endif /* MEM_MGT_H_ */
@@ -37,6 +37,7 @@ void mdelay(uint32_t loop_count_arg);
 size_t strnlen_s(const char *str_arg, size_t maxlen_arg);
 void *memset(void *base, uint8_t v, size_t n);
 void *memcpy_s(void *d, size_t dmax, const void *s, size_t slen_arg);
+void init_fast_strings(bool erms, bool fsrm);
 int udiv64(uint64_t dividend_arg, uint64_t divisor_arg, struct udiv_result *res);
 int udiv32(uint32_t dividend, uint32_t divisor, struct udiv_result *res);
 int atoi(const char *str);
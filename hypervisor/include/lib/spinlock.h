@@ -15,15 +15,45 @@
 typedef struct _spinlock {
 	uint32_t head;
 	uint32_t tail;
-
+#ifdef CONFIG_LOCKSTAT
+	uint32_t stat_id;	/* lockstat slot + 1, 0 until first obtained */
+	const char *name;	/* locks of the same name share a slot */
+	uint64_t hold_start;	/* TSC when the holder obtained the lock */
+#endif
 } spinlock_t;
 
+#ifdef CONFIG_LOCKSTAT
+/* Max number of lock names (or unnamed locks) with statistics */
+#define LOCKSTAT_MAX_LOCKS	64U
+
+/* Contention statistics of a lock slot on one pcpu */
+struct lockstat_counters {
+	uint64_t acquired;
+	uint64_t contended;
+	uint64_t spin_cycles;
+	uint64_t max_hold;
+};
+
+/* Name a statically initialized lock */
+#define SPINLOCK_NAME(n)	.name = (n),
+
+void spinlock_set_name(spinlock_t *lock, const char *name);
+void lockstat_release(spinlock_t *lock);
+void get_lockstat(char *str_arg, int str_max);
+#else
+#define SPINLOCK_NAME(n)
+#define spinlock_set_name(lock, n)	((void)(lock))
+#endif
+
 /* Function prototypes */
 void spinlock_init(spinlock_t *lock);
 void spinlock_obtain(spinlock_t *lock);
 
 static inline void spinlock_release(spinlock_t *lock)
 {
+#ifdef CONFIG_LOCKSTAT
+	lockstat_release(lock);
+#endif
 	/* Increment tail of queue */
 	asm volatile ("   lock incl %[tail]\n"
 				:
@@ -31,6 +61,27 @@ static inline void spinlock_release(spinlock_t *lock)
 				: "cc", "memory");
 }
 
+/* Max number of MCS locks a pcpu can hold or wait for at the same time,
+ * counting the nesting of thread, softirq and interrupt contexts.
+ */
+#define MCS_NODES_PER_CPU	4U
+
+/* Queue node of a pcpu waiting for or holding a MCS lock */
+struct mcs_node {
+	struct mcs_node *next;
+	uint32_t locked;
+} __aligned(64);
+
+/** Queued (MCS) spinlock, each waiter spins on its own per-cpu node. */
+typedef struct _mcs_spinlock {
+	struct mcs_node *tail;	/* last node in the queue, NULL if free */
+	struct mcs_node *owner;	/* node of the holder */
+} mcs_spinlock_t;
+
+void mcs_spinlock_init(mcs_spinlock_t *lock);
+void mcs_spinlock_obtain(mcs_spinlock_t *lock);
+void mcs_spinlock_release(mcs_spinlock_t *lock);
+
 #else /* ASSEMBLER */
 
 /** The offset of the head element. */
@@ -74,4 +125,16 @@ static inline void spinlock_release(spinlock_t *lock)
 		spinlock_release(lock);			\
 		CPU_INT_ALL_RESTORE(rflags);		\
 	} while (0)
+
+#define mcs_spinlock_irqsave_obtain(lock, p_rflags)	\
+	do {						\
+		CPU_INT_ALL_DISABLE(p_rflags);		\
+		mcs_spinlock_obtain(lock);		\
+	} while (0)
+
+#define mcs_spinlock_irqrestore_release(lock, rflags)	\
+	do {						\
+		mcs_spinlock_release(lock);		\
+		CPU_INT_ALL_RESTORE(rflags);		\
+	} while (0)
 #endif /* SPINLOCK_H */
@@ -27,6 +27,7 @@
 #define HC_ID_GEN_BASE               0x0UL
 #define HC_GET_API_VERSION          BASE_HC_ID(HC_ID, HC_ID_GEN_BASE + 0x00UL)
 #define HC_SOS_OFFLINE_CPU          BASE_HC_ID(HC_ID, HC_ID_GEN_BASE + 0x01UL)
+#define HC_MULTICALL                BASE_HC_ID(HC_ID, HC_ID_GEN_BASE + 0x02UL)
 
 /* VM management */
 #define HC_ID_VM_BASE               0x10UL
@@ -36,6 +37,7 @@
 #define HC_PAUSE_VM                 BASE_HC_ID(HC_ID, HC_ID_VM_BASE + 0x03UL)
 #define HC_CREATE_VCPU              BASE_HC_ID(HC_ID, HC_ID_VM_BASE + 0x04UL)
 #define HC_RESET_VM                 BASE_HC_ID(HC_ID, HC_ID_VM_BASE + 0x05UL)
+#define HC_GET_VCPU_EXIT_STATS      BASE_HC_ID(HC_ID, HC_ID_VM_BASE + 0x06UL)
 
 /* IRQ and Interrupts */
 #define HC_ID_IRQ_BASE              0x20UL
@@ -48,6 +50,10 @@
 #define HC_ID_IOREQ_BASE            0x30UL
 #define HC_SET_IOREQ_BUFFER         BASE_HC_ID(HC_ID, HC_ID_IOREQ_BASE + 0x00UL)
 #define HC_NOTIFY_REQUEST_FINISH    BASE_HC_ID(HC_ID, HC_ID_IOREQ_BASE + 0x01UL)
+#define HC_SET_POSTED_RING          BASE_HC_ID(HC_ID, HC_ID_IOREQ_BASE + 0x02UL)
+#define HC_SET_POSTED_RANGE         BASE_HC_ID(HC_ID, HC_ID_IOREQ_BASE + 0x03UL)
+#define HC_SET_DOORBELL_PAGE        BASE_HC_ID(HC_ID, HC_ID_IOREQ_BASE + 0x04UL)
+#define HC_SET_DOORBELL             BASE_HC_ID(HC_ID, HC_ID_IOREQ_BASE + 0x05UL)
 
 /* Guest memory management */
 #define HC_ID_MEM_BASE              0x40UL
@@ -68,6 +74,7 @@
 #define HC_ID_DBG_BASE              0x60UL
 #define HC_SETUP_SBUF               BASE_HC_ID(HC_ID, HC_ID_DBG_BASE + 0x00UL)
 #define HC_SETUP_HV_NPK_LOG         BASE_HC_ID(HC_ID, HC_ID_DBG_BASE + 0x01UL)
+#define HC_SETUP_TRACE_FILTER       BASE_HC_ID(HC_ID, HC_ID_DBG_BASE + 0x02UL)
 
 /* Trusty */
 #define HC_ID_TRUSTY_BASE           0x70UL
@@ -209,6 +216,37 @@ struct hv_npk_log_param {
 	uint64_t mmio_addr;
 } __aligned(8);
 
+/** Number of trace event indexes, see ACRN_TRACE_EVENT_INDEX */
+#define ACRN_TRACE_EVENT_MAX	1024U
+
+/** Index of a trace event id in trace_filter_param.ev_mask, built from
+ *  bits 17:16 (event group) and 7:0 of the id.
+ */
+#define ACRN_TRACE_EVENT_INDEX(evid)	\
+	((((evid) >> 8U) & 0x300U) | ((evid) & 0xffU))
+
+/** trace_filter_param.vm_id to trace the events of all the VMs */
+#define ACRN_TRACE_VM_ANY	0xffffU
+
+/**
+ * @brief Info to setup the trace event filter
+ *
+ * the parameter for HC_SETUP_TRACE_FILTER hypercall
+ */
+struct trace_filter_param {
+	/** only trace the pcpus running this VM, or ACRN_TRACE_VM_ANY */
+	uint16_t vm_id;
+
+	/** Reserved */
+	uint16_t reserved0;
+
+	/** Reserved */
+	uint32_t reserved1;
+
+	/** bitmap of the enabled event indexes */
+	uint64_t ev_mask[ACRN_TRACE_EVENT_MAX / 64U];
+} __aligned(8);
+
 /**
  * Gpa to hpa translation parameter, used for HC_VM_GPA2HPA hypercall
  */
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2018 Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <hypervisor.h>
+
+void *memchr(const void *void_s, int c, size_t n)
+{
+	unsigned char val = (unsigned char)c;
+	unsigned char *ptr = (unsigned char *)void_s;
+	unsigned char *end = ptr + n;
+
+	while (ptr < end) {
+		if (*ptr == val) {
+			return ((void *)ptr);
+		}
+		ptr++;
+	}
+	return NULL;
+}
+
+/* Use rep movsb/stosb from this size on with ERMS, for any size with FSRM */
+#define ERMS_MIN_SIZE	256U
+
+static bool fast_strings_erms;
+static bool fast_strings_fsrm;
+
+/* 64-bit word which may be unaligned and alias any object */
+typedef uint64_t __attribute__((__may_alias__, __aligned__(1))) mem_word_t;
+
+void init_fast_strings(bool erms, bool fsrm)
+{
+	fast_strings_erms = erms;
+	fast_strings_fsrm = fsrm;
+}
+
+static inline bool use_rep_byte_ops(size_t n)
+{
+	return fast_strings_fsrm || (fast_strings_erms && (n >= ERMS_MIN_SIZE));
+}
+
+/* Copy the fixed small sizes of the hot paths by unrolled word moves */
+static inline bool memcpy_fixed(uint8_t *d, const uint8_t *s, size_t n)
+{
+	mem_word_t *dw = (mem_word_t *)d;
+	const mem_word_t *sw = (const mem_word_t *)s;
+	uint64_t w0, w1, w2, w3;
+
+	switch (n) {
+	case 8U:
+		dw[0] = sw[0];
+		break;
+	case 16U:
+		w0 = sw[0];
+		w1 = sw[1];
+		dw[0] = w0;
+		dw[1] = w1;
+		break;
+	case 32U:
+		w0 = sw[0];
+		w1 = sw[1];
+		w2 = sw[2];
+		w3 = sw[3];
+		dw[0] = w0;
+		dw[1] = w1;
+		dw[2] = w2;
+		dw[3] = w3;
+		break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+/***********************************************************************
+ *
+ *   FUNCTION
+ *
+ *       memcpy_s
+ *
+ *   DESCRIPTION
+ *
+ *       Copies at most slen bytes from src address to dest address,
+ *       up to dmax.
+ *
+ *   INPUTS
+ *
+ *       d                  pointer to Destination address
+ *       dmax               maximum  length of dest
+ *       s                  pointer to Source address
+ *       slen               maximum number of bytes of src to copy
+ *
+ *   OUTPUTS
+ *
+ *       void *             pointer to destination address if successful,
+ *                          or else return null.
+ *
+ ***********************************************************************/
+void *memcpy_s(void *d, size_t dmax, const void *s, size_t slen_arg)
+{
+	uint8_t *dest8;
+	uint8_t *src8;
+	size_t slen = slen_arg;
+
+	if ((slen == 0U) || (dmax == 0U) || (dmax < slen)) {
+		ASSERT(false);
+	}
+
+	if (((d > s) && (d <= ((s + slen) - 1U)))
+			|| ((d < s) && (s <= ((d + dmax) - 1U)))) {
+		ASSERT(false);
+	}
+
+	/* same memory block, no need to copy */
+	if (d == s) {
+		return d;
+	}
+
+	dest8 = (uint8_t *)d;
+	src8 = (uint8_t *)s;
+
+	if (memcpy_fixed(dest8, src8, slen)) {
+		return d;
+	}
+
+	if (use_rep_byte_ops(slen)) {
+		asm volatile ("cld; rep; movsb"
+				: "+c"(slen), "+D"(dest8), "+S"(src8)
+				:
+				: "memory");
+		return d;
+	}
+
+	/* small data block */
+	if (slen < 8U) {
+		while (slen != 0U) {
+			*dest8 = *src8;
+			dest8++;
+			src8++;
+			slen--;
+		}
+
+		return d;
+	}
+
+	/* make sure 8bytes-aligned for at least one addr. */
+	if ((!MEM_ALIGNED_CHECK(src8, 8UL)) &&
+			(!MEM_ALIGNED_CHECK(dest8, 8UL))) {
+		for (; (slen != 0U) && ((((uint64_t)src8) & 7UL) != 0UL);
+				slen--) {
+			*dest8 = *src8;
+			dest8++;
+			src8++;
+		}
+	}
+
+	/* copy main data blocks, with rep prefix */
+	if (slen > 8U) {
+		uint32_t ecx;
+
+		asm volatile ("cld; rep; movsq"
+				: "=&c"(ecx), "=&D"(dest8), "=&S"(src8)
+				: "0" (slen >> 3), "1" (dest8), "2" (src8)
+				: "memory");
+
+		slen = slen & 0x7U;
+	}
+
+	/* tail bytes */
+	while (slen != 0U) {
+		*dest8 = *src8;
+		dest8++;
+		src8++;
+		slen--;
+	}
+
+	return d;
+}
+
+void *memset(void *base, uint8_t v, size_t n)
+{
+	uint8_t *dest_p;
+	size_t n_q;
+	size_t count;
+
+	dest_p = (uint8_t *)base;
+
+	if ((dest_p == NULL) || (n == 0U)) {
+		return NULL;
+	}
+
+	if (use_rep_byte_ops(n)) {
+		count = n;
+		asm volatile("cld ; rep ; stosb"
+				: "+c"(count), "+D"(dest_p)
+				: "a" (v)
+				: "memory");
+		return (void *)dest_p;
+	}
+
+	/* do the few bytes to get uint64_t alignment */
+	count = n;
+	for (; (count != 0U) && (((uint64_t)dest_p & 7UL) != 0UL); count--) {
+		*dest_p = v;
+		dest_p++;
+	}
+
+	/* 64-bit mode */
+	n_q = count >> 3U;
+	asm volatile("cld ; rep ; stosq ; movl %3,%%ecx ; rep ; stosb"
+				: "+c"(n_q), "+D"(dest_p)
+				: "a" (v * 0x0101010101010101U),
+				"r"((unsigned int)count  & 7U));
+
+	return (void *)dest_p;
+}
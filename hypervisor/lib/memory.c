@@ -22,7 +22,7 @@ static uint32_t Malloc_Heap_Contiguity_Bitmap[MALLOC_HEAP_BITMAP_SIZE];
 
 static struct mem_pool Memory_Pool = {
 	.start_addr = Malloc_Heap,
-	.spinlock = {.head = 0U, .tail = 0U},
+	.spinlock = {.head = 0U, .tail = 0U, SPINLOCK_NAME("Memory_Pool")},
 	.size = CONFIG_HEAP_SIZE,
 	.buff_size = MALLOC_HEAP_BUFF_SIZE,
 	.total_buffs = MALLOC_HEAP_TOTAL_BUFF,
@@ -32,27 +32,45 @@ static struct mem_pool Memory_Pool = {
 };
 
 /************************************************************************/
-/*        Memory pool declaration (block size = CPU_PAGE_SIZE)          */
+/*     Buddy page pool declaration (block size = CPU_PAGE_SIZE)        */
 /************************************************************************/
 static uint8_t __bss_noinit
 Paging_Heap[CONFIG_NUM_ALLOC_PAGES][CPU_PAGE_SIZE] __aligned(CPU_PAGE_SIZE);
 
-#define PAGING_HEAP_BUFF_SIZE      CPU_PAGE_SIZE
-#define PAGING_HEAP_TOTAL_BUFF     CONFIG_NUM_ALLOC_PAGES
-#define PAGING_HEAP_BITMAP_SIZE \
-	INT_DIV_ROUNDUP(PAGING_HEAP_TOTAL_BUFF, BITMAP_WORD_SIZE)
-static uint32_t Paging_Heap_Bitmap[PAGING_HEAP_BITMAP_SIZE];
-static uint32_t Paging_Heap_Contiguity_Bitmap[MALLOC_HEAP_BITMAP_SIZE];
+#define PAGING_HEAP_TOTAL_PAGES    CONFIG_NUM_ALLOC_PAGES
 
-static struct mem_pool Paging_Memory_Pool = {
+/* Free blocks are of 2^0 .. 2^(PAGE_ORDER_NUM - 1) pages */
+#define PAGE_ORDER_NUM             13U
+#define INVALID_PAGE_IDX           0xffffffffU
+
+/* Per page state; only meaningful for the first page of a block */
+struct page_info {
+	uint32_t next;		/* Next free block of the same order */
+	uint32_t prev;		/* Previous free block of the same order */
+	uint32_t alloc_num;	/* Pages of the allocation, 0 if not allocated */
+	uint8_t order;		/* Order of the free block */
+	bool free;		/* First page of a free block */
+};
+
+struct page_pool {
+	void *start_addr;	/* Start Address of the Page Pool */
+	spinlock_t spinlock;	/* To protect Page Allocation */
+	uint32_t total_pages;	/* Total Pages in the Page Pool */
+	uint32_t free_pages;	/* Free Pages in the Page Pool */
+	bool initialized;	/* Free lists populated */
+	struct page_info *pages;
+	uint32_t free_head[PAGE_ORDER_NUM];	/* Free list per order */
+	uint32_t free_blocks[PAGE_ORDER_NUM];	/* Free blocks per order */
+};
+
+static struct page_info Paging_Heap_Pages[PAGING_HEAP_TOTAL_PAGES];
+
+static struct page_pool Paging_Memory_Pool = {
 	.start_addr = Paging_Heap,
-	.spinlock = {.head = 0U, .tail = 0U},
-	.size = CONFIG_NUM_ALLOC_PAGES * CPU_PAGE_SIZE,
-	.buff_size = PAGING_HEAP_BUFF_SIZE,
-	.total_buffs = PAGING_HEAP_TOTAL_BUFF,
-	.bmp_size = PAGING_HEAP_BITMAP_SIZE,
-	.bitmap = Paging_Heap_Bitmap,
-	.contiguity_bitmap = Paging_Heap_Contiguity_Bitmap
+	.spinlock = {.head = 0U, .tail = 0U,
+		SPINLOCK_NAME("Paging_Memory_Pool")},
+	.total_pages = PAGING_HEAP_TOTAL_PAGES,
+	.pages = Paging_Heap_Pages,
 };
 
 static void *allocate_mem(struct mem_pool *pool, unsigned int num_bytes)
@@ -233,6 +251,455 @@ static void deallocate_mem(struct mem_pool *pool, void *ptr)
 	}
 }
 
+static void page_list_add(struct page_pool *pool, uint32_t idx, uint8_t order)
+{
+	struct page_info *page = &pool->pages[idx];
+	uint32_t head = pool->free_head[order];
+
+	page->order = order;
+	page->free = true;
+	page->prev = INVALID_PAGE_IDX;
+	page->next = head;
+	if (head != INVALID_PAGE_IDX) {
+		pool->pages[head].prev = idx;
+	}
+	pool->free_head[order] = idx;
+	pool->free_blocks[order]++;
+}
+
+static void page_list_del(struct page_pool *pool, uint32_t idx)
+{
+	struct page_info *page = &pool->pages[idx];
+
+	if (page->prev != INVALID_PAGE_IDX) {
+		pool->pages[page->prev].next = page->next;
+	} else {
+		pool->free_head[page->order] = page->next;
+	}
+	if (page->next != INVALID_PAGE_IDX) {
+		pool->pages[page->next].prev = page->prev;
+	}
+	page->free = false;
+	pool->free_blocks[page->order]--;
+}
+
+/* Free the block of 2^order pages at idx, merging it with its buddies */
+static void free_page_block(struct page_pool *pool, uint32_t idx_arg,
+		uint8_t order_arg)
+{
+	uint32_t idx = idx_arg, buddy;
+	uint8_t order = order_arg;
+
+	pool->free_pages += 1U << order;
+
+	while (order < (PAGE_ORDER_NUM - 1U)) {
+		buddy = idx ^ (1U << order);
+		if ((buddy >= pool->total_pages) ||
+				(!pool->pages[buddy].free) ||
+				(pool->pages[buddy].order != order)) {
+			break;
+		}
+		page_list_del(pool, buddy);
+		idx &= ~(1U << order);
+		order++;
+	}
+
+	page_list_add(pool, idx, order);
+}
+
+/* Free page_num pages from idx, as the largest naturally aligned blocks */
+static void free_page_range(struct page_pool *pool, uint32_t idx_arg,
+		uint32_t page_num)
+{
+	uint32_t idx = idx_arg, end = idx_arg + page_num;
+	uint8_t order;
+
+	while (idx < end) {
+		order = 0U;
+		while (((order + 1U) < PAGE_ORDER_NUM) &&
+				((idx & ((1U << (order + 1U)) - 1U)) == 0U) &&
+				((idx + (1U << (order + 1U))) <= end)) {
+			order++;
+		}
+		free_page_block(pool, idx, order);
+		idx += 1U << order;
+	}
+}
+
+static void init_page_pool(struct page_pool *pool)
+{
+	uint8_t order;
+
+	for (order = 0U; order < PAGE_ORDER_NUM; order++) {
+		pool->free_head[order] = INVALID_PAGE_IDX;
+	}
+	free_page_range(pool, 0U, pool->total_pages);
+	pool->initialized = true;
+}
+
+static void *allocate_pages(struct page_pool *pool, uint32_t page_num)
+{
+	void *memory = NULL;
+	uint32_t idx;
+	uint8_t order = 0U, cur;
+
+	while (((order + 1U) < PAGE_ORDER_NUM) && ((1U << order) < page_num)) {
+		order++;
+	}
+	if ((page_num == 0U) || ((1U << order) < page_num)) {
+		return NULL;
+	}
+
+	spinlock_obtain(&pool->spinlock);
+
+	if (!pool->initialized) {
+		init_page_pool(pool);
+	}
+
+	/* Smallest order with a free block large enough */
+	for (cur = order; cur < PAGE_ORDER_NUM; cur++) {
+		if (pool->free_head[cur] != INVALID_PAGE_IDX) {
+			break;
+		}
+	}
+
+	if (cur < PAGE_ORDER_NUM) {
+		idx = pool->free_head[cur];
+		page_list_del(pool, idx);
+		pool->free_pages -= 1U << cur;
+
+		/* Give back the upper halves while splitting down to order */
+		while (cur > order) {
+			cur--;
+			page_list_add(pool, idx + (1U << cur), cur);
+			pool->free_pages += 1U << cur;
+		}
+
+		/* Give back the tail pages which were not requested */
+		free_page_range(pool, idx + page_num, (1U << order) - page_num);
+
+		pool->pages[idx].alloc_num = page_num;
+		memory = (char *)pool->start_addr + ((uint64_t)idx * CPU_PAGE_SIZE);
+	}
+
+	spinlock_release(&pool->spinlock);
+
+	return memory;
+}
+
+static void deallocate_pages(struct page_pool *pool, void *ptr)
+{
+	uint32_t idx, page_num;
+
+	spinlock_obtain(&pool->spinlock);
+
+	/* Map the page address to its index. */
+	idx = (uint32_t)(((char *)ptr - (char *)pool->start_addr) /
+			CPU_PAGE_SIZE);
+	page_num = pool->pages[idx].alloc_num;
+	if (page_num != 0U) {
+		pool->pages[idx].alloc_num = 0U;
+		free_page_range(pool, idx, page_num);
+	}
+
+	spinlock_release(&pool->spinlock);
+}
+
+/************************************************************************/
+/*       Slab caches in front of Memory_Pool, for small objects        */
+/************************************************************************/
+/*
+ * Requests up to SLAB_MAX_SIZE bytes are served from power of 2 size
+ * classes. Each pcpu caches free objects of each class without locking,
+ * and moves them by batches of SLAB_BATCH from/to the depot of the class,
+ * which is refilled by carving SLAB_CHUNK_SIZE chunks out of Memory_Pool.
+ * Chunks are never given back to Memory_Pool.
+ */
+#define SLAB_MIN_SHIFT		5U
+#define SLAB_CLASS_NUM		6U
+#define SLAB_MAX_SIZE		(1U << ((SLAB_MIN_SHIFT + SLAB_CLASS_NUM) - 1U))
+#define SLAB_CHUNK_SIZE		CPU_PAGE_SIZE
+#define SLAB_BATCH		8U
+#define SLAB_CACHE_MAX		(2U * SLAB_BATCH)
+
+struct slab_obj {
+	struct slab_obj *next;
+};
+
+struct slab_cpu_cache {
+	struct slab_obj *head;
+	uint32_t count;
+	uint64_t allocs;
+	uint64_t frees;
+} __aligned(CACHE_LINE_SIZE);
+
+struct slab_class {
+	spinlock_t lock;	/* To protect the depot */
+	struct slab_obj *depot;
+	uint32_t depot_count;
+	uint32_t chunks;
+	struct slab_cpu_cache cpu[MAX_PCPU_NUM];
+};
+
+static struct slab_class Slab_Classes[SLAB_CLASS_NUM];
+
+/* Size class + 1 of the slab chunk each Memory_Pool buffer is in, or 0 */
+static uint8_t Malloc_Heap_Slab_Class[MALLOC_HEAP_TOTAL_BUFF];
+
+static inline uint32_t slab_size(uint32_t class)
+{
+	return 1U << (SLAB_MIN_SHIFT + class);
+}
+
+static inline uint32_t slab_class_of(unsigned int num_bytes)
+{
+	uint32_t class = 0U;
+
+	while (slab_size(class) < num_bytes) {
+		class++;
+	}
+
+	return class;
+}
+
+/* Move up to SLAB_BATCH objects from the depot to the cache */
+static void slab_refill(struct slab_class *sc, uint32_t class,
+			struct slab_cpu_cache *cache)
+{
+	struct slab_obj *obj;
+	char *chunk;
+	uint32_t i, buff_idx, size = slab_size(class);
+
+	spinlock_obtain(&sc->lock);
+
+	if (sc->depot == NULL) {
+		chunk = allocate_mem(&Memory_Pool, SLAB_CHUNK_SIZE);
+		if (chunk != NULL) {
+			buff_idx = (uint32_t)((chunk - (char *)Memory_Pool.start_addr)
+					/ Memory_Pool.buff_size);
+			for (i = 0U; i < (SLAB_CHUNK_SIZE / MALLOC_HEAP_BUFF_SIZE);
+					i++) {
+				Malloc_Heap_Slab_Class[buff_idx + i] =
+					(uint8_t)(class + 1U);
+			}
+
+			for (i = 0U; i < SLAB_CHUNK_SIZE; i += size) {
+				obj = (struct slab_obj *)(chunk + i);
+				obj->next = sc->depot;
+				sc->depot = obj;
+			}
+			sc->depot_count += SLAB_CHUNK_SIZE / size;
+			sc->chunks++;
+		}
+	}
+
+	for (i = 0U; (i < SLAB_BATCH) && (sc->depot != NULL); i++) {
+		obj = sc->depot;
+		sc->depot = obj->next;
+		sc->depot_count--;
+		obj->next = cache->head;
+		cache->head = obj;
+		cache->count++;
+	}
+
+	spinlock_release(&sc->lock);
+}
+
+/* Move SLAB_BATCH objects from the cache back to the depot */
+static void slab_drain(struct slab_class *sc, struct slab_cpu_cache *cache)
+{
+	struct slab_obj *obj;
+	uint32_t i;
+
+	spinlock_obtain(&sc->lock);
+	for (i = 0U; i < SLAB_BATCH; i++) {
+		obj = cache->head;
+		cache->head = obj->next;
+		cache->count--;
+		obj->next = sc->depot;
+		sc->depot = obj;
+		sc->depot_count++;
+	}
+	spinlock_release(&sc->lock);
+}
+
+static void *slab_alloc(uint32_t class)
+{
+	struct slab_class *sc = &Slab_Classes[class];
+	struct slab_cpu_cache *cache;
+	struct slab_obj *obj;
+	uint64_t rflags;
+	uint16_t pcpu_id = get_cpu_id();
+
+	/* TSC_AUX may not hold the pcpu id yet early in the boot */
+	if (pcpu_id >= MAX_PCPU_NUM) {
+		return allocate_mem(&Memory_Pool, slab_size(class));
+	}
+
+	cache = &sc->cpu[pcpu_id];
+
+	/* The cache may be used by an interrupt handler of this pcpu */
+	CPU_INT_ALL_DISABLE(&rflags);
+	if (cache->head == NULL) {
+		slab_refill(sc, class, cache);
+	}
+
+	obj = cache->head;
+	if (obj != NULL) {
+		cache->head = obj->next;
+		cache->count--;
+		cache->allocs++;
+	}
+	CPU_INT_ALL_RESTORE(rflags);
+
+	return (void *)obj;
+}
+
+static void slab_free(uint32_t class, void *ptr)
+{
+	struct slab_class *sc = &Slab_Classes[class];
+	struct slab_cpu_cache *cache;
+	struct slab_obj *obj = (struct slab_obj *)ptr;
+	uint64_t rflags;
+	uint16_t pcpu_id = get_cpu_id();
+
+	if (pcpu_id >= MAX_PCPU_NUM) {
+		spinlock_obtain(&sc->lock);
+		obj->next = sc->depot;
+		sc->depot = obj;
+		sc->depot_count++;
+		spinlock_release(&sc->lock);
+		return;
+	}
+
+	/* An object freed on another pcpu than its allocation's simply
+	 * moves to the cache of this pcpu
+	 */
+	cache = &sc->cpu[pcpu_id];
+
+	CPU_INT_ALL_DISABLE(&rflags);
+	obj->next = cache->head;
+	cache->head = obj;
+	cache->count++;
+	cache->frees++;
+
+	if (cache->count > SLAB_CACHE_MAX) {
+		slab_drain(sc, cache);
+	}
+	CPU_INT_ALL_RESTORE(rflags);
+}
+
+#ifdef HV_DEBUG
+/* Count the allocated buffers and the longest run of free buffers */
+static void get_pool_usage(struct mem_pool *pool, uint32_t *used,
+			uint32_t *max_free_run)
+{
+	uint32_t buff_idx, run = 0U;
+
+	*used = 0U;
+	*max_free_run = 0U;
+
+	spinlock_obtain(&pool->spinlock);
+	for (buff_idx = 0U; buff_idx < pool->total_buffs; buff_idx++) {
+		if ((pool->bitmap[buff_idx / BITMAP_WORD_SIZE] &
+				(1U << (buff_idx % BITMAP_WORD_SIZE))) != 0U) {
+			(*used)++;
+			run = 0U;
+		} else {
+			run++;
+			if (run > *max_free_run) {
+				*max_free_run = run;
+			}
+		}
+	}
+	spinlock_release(&pool->spinlock);
+}
+
+void get_mem_stats(char *str_arg, int str_max)
+{
+	char *str = str_arg;
+	int len, size = str_max;
+	struct page_pool *page_pool = &Paging_Memory_Pool;
+	struct slab_class *sc;
+	uint32_t used, max_free_run, class, cached, objs, free_blocks;
+	uint64_t allocs, frees;
+	uint16_t pcpu_id;
+	uint8_t order;
+
+	len = snprintf(str, size, "\r\nPOOL\tBUFF\t   TOTAL\t    USED"
+			"\tLARGEST_FREE\tFRAG%%");
+	size -= len;
+	str += len;
+
+	get_pool_usage(&Memory_Pool, &used, &max_free_run);
+	/* share of the free buffers not in the largest free run */
+	len = snprintf(str, size, "\r\nheap\t%u\t%8u\t%8u\t%12u\t%u",
+		Memory_Pool.buff_size, Memory_Pool.total_buffs, used,
+		max_free_run, (used == Memory_Pool.total_buffs) ? 0U :
+		(100U - ((max_free_run * 100U) /
+		(Memory_Pool.total_buffs - used))));
+	size -= len;
+	str += len;
+
+	spinlock_obtain(&page_pool->spinlock);
+	used = page_pool->total_pages - page_pool->free_pages;
+	if (!page_pool->initialized) {
+		used = 0U;
+	}
+	max_free_run = 0U;
+	for (order = 0U; order < PAGE_ORDER_NUM; order++) {
+		if (page_pool->free_blocks[order] != 0U) {
+			max_free_run = 1U << order;
+		}
+	}
+	len = snprintf(str, size, "\r\npage\t%u\t%8u\t%8u\t%12u\t%u",
+		CPU_PAGE_SIZE, page_pool->total_pages, used, max_free_run,
+		(used == page_pool->total_pages) ? 0U :
+		(100U - ((max_free_run * 100U) /
+		(page_pool->total_pages - used))));
+	size -= len;
+	str += len;
+
+	len = snprintf(str, size, "\r\n\r\nORDER\tFREE_BLOCKS");
+	size -= len;
+	str += len;
+	for (order = 0U; order < PAGE_ORDER_NUM; order++) {
+		free_blocks = page_pool->free_blocks[order];
+		len = snprintf(str, size, "\r\n%u\t%11u", (uint32_t)order,
+				free_blocks);
+		size -= len;
+		str += len;
+	}
+	spinlock_release(&page_pool->spinlock);
+
+	len = snprintf(str, size, "\r\n\r\nSLAB\tCHUNKS\t    OBJS"
+			"\t   INUSE\t  CACHED\t   DEPOT");
+	size -= len;
+	str += len;
+
+	for (class = 0U; class < SLAB_CLASS_NUM; class++) {
+		sc = &Slab_Classes[class];
+		allocs = 0UL;
+		frees = 0UL;
+		cached = 0U;
+		for (pcpu_id = 0U; pcpu_id < phys_cpu_num; pcpu_id++) {
+			allocs += sc->cpu[pcpu_id].allocs;
+			frees += sc->cpu[pcpu_id].frees;
+			cached += sc->cpu[pcpu_id].count;
+		}
+		objs = sc->chunks * (SLAB_CHUNK_SIZE / slab_size(class));
+
+		len = snprintf(str, size, "\r\n%u\t%6u\t%8u\t%8lld\t%8u\t%8u",
+			slab_size(class), sc->chunks, objs, allocs - frees,
+			cached, sc->depot_count);
+		size -= len;
+		str += len;
+	}
+
+	snprintf(str, size, "\r\n");
+}
+#endif /* HV_DEBUG */
+
 /*
  * The return address will be CPU_PAGE_SIZE aligned if 'num_bytes' is greater
  * than CPU_PAGE_SIZE.
@@ -242,7 +709,10 @@ void *malloc(unsigned int num_bytes)
 	void *memory = NULL;
 
 	/* Check if bytes requested extend page-size */
-	if (num_bytes < CPU_PAGE_SIZE) {
+	if (num_bytes <= SLAB_MAX_SIZE) {
+		/* Request memory allocation from the slab caches */
+		memory = slab_alloc(slab_class_of(num_bytes));
+	} else if (num_bytes < CPU_PAGE_SIZE) {
 		/*
 		 * Request memory allocation from smaller segmented memory pool
 		 */
@@ -267,8 +737,8 @@ void *alloc_pages(unsigned int page_num)
 {
 	void *memory = NULL;
 
-	/* Request memory allocation from Page-aligned memory pool */
-	memory = allocate_mem(&Paging_Memory_Pool, page_num * CPU_PAGE_SIZE);
+	/* Request memory allocation from the buddy page pool */
+	memory = allocate_pages(&Paging_Memory_Pool, page_num);
 
 	/* Check if memory allocation is successful */
 	if (memory == NULL) {
@@ -303,152 +773,24 @@ void free(void *ptr)
 	if ((Memory_Pool.start_addr < ptr) &&
 		(ptr < (Memory_Pool.start_addr +
 			(Memory_Pool.total_buffs * Memory_Pool.buff_size)))) {
-		/* Free buffer in 16-Bytes aligned Memory Pool */
-		deallocate_mem(&Memory_Pool, ptr);
-	}
-	/* Check if ptr belongs to page aligned Memory Pool */
-	else if ((Paging_Memory_Pool.start_addr < ptr) &&
-			(ptr < (Paging_Memory_Pool.start_addr +
-				(Paging_Memory_Pool.total_buffs *
-				 Paging_Memory_Pool.buff_size)))) {
-		/* Free buffer in page aligned Memory Pool */
-		deallocate_mem(&Paging_Memory_Pool, ptr);
-	}
-}
-
-void *memchr(const void *void_s, int c, size_t n)
-{
-	unsigned char val = (unsigned char)c;
-	unsigned char *ptr = (unsigned char *)void_s;
-	unsigned char *end = ptr + n;
-
-	while (ptr < end) {
-		if (*ptr == val) {
-			return ((void *)ptr);
-		}
-		ptr++;
-	}
-	return NULL;
-}
-
-/***********************************************************************
- *
- *   FUNCTION
- *
- *       memcpy_s
- *
- *   DESCRIPTION
- *
- *       Copies at most slen bytes from src address to dest address,
- *       up to dmax.
- *
- *   INPUTS
- *
- *       d                  pointer to Destination address
- *       dmax               maximum  length of dest
- *       s                  pointer to Source address
- *       slen               maximum number of bytes of src to copy
- *
- *   OUTPUTS
- *
- *       void *             pointer to destination address if successful,
- *                          or else return null.
- *
- ***********************************************************************/
-void *memcpy_s(void *d, size_t dmax, const void *s, size_t slen_arg)
-{
-	uint8_t *dest8;
-	uint8_t *src8;
-	size_t slen = slen_arg;
-
-	if ((slen == 0U) || (dmax == 0U) || (dmax < slen)) {
-		ASSERT(false);
-	}
-
-	if (((d > s) && (d <= ((s + slen) - 1U)))
-			|| ((d < s) && (s <= ((d + dmax) - 1U)))) {
-		ASSERT(false);
-	}
-
-	/* same memory block, no need to copy */
-	if (d == s) {
-		return d;
-	}
-
-	dest8 = (uint8_t *)d;
-	src8 = (uint8_t *)s;
-
-	/* small data block */
-	if (slen < 8U) {
-		while (slen != 0U) {
-			*dest8 = *src8;
-			dest8++;
-			src8++;
-			slen--;
-		}
-
-		return d;
-	}
-
-	/* make sure 8bytes-aligned for at least one addr. */
-	if ((!MEM_ALIGNED_CHECK(src8, 8UL)) &&
-			(!MEM_ALIGNED_CHECK(dest8, 8UL))) {
-		for (; (slen != 0U) && ((((uint64_t)src8) & 7UL) != 0UL);
-				slen--) {
-			*dest8 = *src8;
-			dest8++;
-			src8++;
+		uint32_t buff_idx = (uint32_t)(((char *)ptr -
+			(char *)Memory_Pool.start_addr) / Memory_Pool.buff_size);
+		uint8_t class = Malloc_Heap_Slab_Class[buff_idx];
+
+		if (class != 0U) {
+			/* Free object to the slab caches */
+			slab_free((uint32_t)class - 1U, ptr);
+		} else {
+			/* Free buffer in 16-Bytes aligned Memory Pool */
+			deallocate_mem(&Memory_Pool, ptr);
 		}
 	}
-
-	/* copy main data blocks, with rep prefix */
-	if (slen > 8U) {
-		uint32_t ecx;
-
-		asm volatile ("cld; rep; movsq"
-				: "=&c"(ecx), "=&D"(dest8), "=&S"(src8)
-				: "0" (slen >> 3), "1" (dest8), "2" (src8)
-				: "memory");
-
-		slen = slen & 0x7U;
-	}
-
-	/* tail bytes */
-	while (slen != 0U) {
-		*dest8 = *src8;
-		dest8++;
-		src8++;
-		slen--;
-	}
-
-	return d;
-}
-
-void *memset(void *base, uint8_t v, size_t n)
-{
-	uint8_t *dest_p;
-	size_t n_q;
-	size_t count;
-
-	dest_p = (uint8_t *)base;
-
-	if ((dest_p == NULL) || (n == 0U)) {
-		return NULL;
-	}
-
-	/* do the few bytes to get uint64_t alignment */
-	count = n;
-	for (; (count != 0U) && (((uint64_t)dest_p & 7UL) != 0UL); count--) {
-		*dest_p = v;
-		dest_p++;
+	/* Check if ptr belongs to the buddy page pool */
+	else if ((Paging_Memory_Pool.start_addr <= ptr) &&
+			(ptr < (Paging_Memory_Pool.start_addr +
+				((uint64_t)Paging_Memory_Pool.total_pages *
+				 CPU_PAGE_SIZE)))) {
+		/* Free pages in the buddy page pool */
+		deallocate_pages(&Paging_Memory_Pool, ptr);
 	}
-
-	/* 64-bit mode */
-	n_q = count >> 3U;
-	asm volatile("cld ; rep ; stosq ; movl %3,%%ecx ; rep ; stosb"
-				: "+c"(n_q), "+D"(dest_p)
-				: "a" (v * 0x0101010101010101U),
-				"r"((unsigned int)count  & 7U));
-
-	return (void *)dest_p;
 }
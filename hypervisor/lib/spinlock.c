@@ -4,13 +4,196 @@
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
-#include <hv_lib.h>
+#include <hypervisor.h>
 
 void spinlock_init(spinlock_t *lock)
 {
 	(void)memset(lock, 0U, sizeof(spinlock_t));
 }
 
+#ifdef CONFIG_LOCKSTAT
+/* Slot value of the locks left out once all the slots are taken */
+#define LOCKSTAT_NO_SLOT	0xffffffffU
+
+/* Name, or address for unnamed locks, of each slot */
+static const char *lockstat_names[LOCKSTAT_MAX_LOCKS];
+static const spinlock_t *lockstat_locks[LOCKSTAT_MAX_LOCKS];
+static uint32_t lockstat_nr;
+static uint32_t lockstat_busy;
+
+void spinlock_set_name(spinlock_t *lock, const char *name)
+{
+	lock->name = name;
+}
+
+/* Find or allocate the slot of the lock, slots are never freed */
+static uint32_t lockstat_register(const spinlock_t *lock)
+{
+	uint32_t i, id = LOCKSTAT_NO_SLOT;
+
+	while (atomic_swap32(&lockstat_busy, 1U) != 0U) {
+		asm volatile ("pause" ::: "memory");
+	}
+
+	for (i = 0U; i < lockstat_nr; i++) {
+		if ((lock->name != NULL) && (lockstat_names[i] != NULL) &&
+			(strcmp(lock->name, lockstat_names[i]) == 0)) {
+			id = i + 1U;
+			break;
+		}
+	}
+
+	if ((id == LOCKSTAT_NO_SLOT) && (lockstat_nr < LOCKSTAT_MAX_LOCKS)) {
+		lockstat_names[lockstat_nr] = lock->name;
+		lockstat_locks[lockstat_nr] = lock;
+		lockstat_nr++;
+		id = lockstat_nr;
+	}
+
+	(void)atomic_swap32(&lockstat_busy, 0U);
+
+	return id;
+}
+
+/*
+ * No counters for a lock never obtained by spinlock_obtain(), as those
+ * taken in assembly like trampoline_spinlock, nor once slots ran out.
+ */
+static struct lockstat_counters *lockstat_counters(const spinlock_t *lock)
+{
+	uint16_t pcpu_id = get_cpu_id();
+
+	if ((lock->stat_id == 0U) || (lock->stat_id == LOCKSTAT_NO_SLOT) ||
+			(pcpu_id >= phys_cpu_num)) {
+		return NULL;
+	}
+
+	return &per_cpu(lockstat, pcpu_id)[lock->stat_id - 1U];
+}
+
+void spinlock_obtain(spinlock_t *lock)
+{
+	uint32_t ticket;
+	uint64_t spin = 0UL;
+	bool contended;
+	struct lockstat_counters *counters;
+
+	ticket = (uint32_t)atomic_xadd32((int *)&lock->head, 1);
+	contended = (atomic_load32(&lock->tail) != ticket);
+	if (contended) {
+		spin = rdtsc();
+		while (atomic_load32(&lock->tail) != ticket) {
+			asm volatile ("pause" ::: "memory");
+		}
+		spin = rdtsc() - spin;
+	}
+
+	/* Only the holder gets here, so the lock fields are not racy */
+	lock->hold_start = rdtsc();
+	if (lock->stat_id == 0U) {
+		lock->stat_id = lockstat_register(lock);
+	}
+
+	counters = lockstat_counters(lock);
+	if (counters != NULL) {
+		counters->acquired++;
+		if (contended) {
+			counters->contended++;
+			counters->spin_cycles += spin;
+		}
+	}
+}
+
+void lockstat_release(spinlock_t *lock)
+{
+	struct lockstat_counters *counters = lockstat_counters(lock);
+	uint64_t hold;
+
+	/* hold_start is 0 unless this hold began in spinlock_obtain() */
+	if ((counters != NULL) && (lock->hold_start != 0UL)) {
+		hold = rdtsc() - lock->hold_start;
+		if (hold > counters->max_hold) {
+			counters->max_hold = hold;
+		}
+	}
+	lock->hold_start = 0UL;
+}
+
+#ifdef HV_DEBUG
+#define LOCKSTAT_TOP	16U
+
+/* Print the locks which spun the most, summed over all the pcpus */
+void get_lockstat(char *str_arg, int str_max)
+{
+	char *str = str_arg;
+	int len, size = str_max;
+	struct lockstat_counters sum[LOCKSTAT_MAX_LOCKS];
+	struct lockstat_counters *c;
+	bool shown[LOCKSTAT_MAX_LOCKS];
+	uint32_t nr = atomic_load32(&lockstat_nr);
+	uint32_t i, n, top;
+	uint16_t pcpu_id;
+
+	(void)memset(sum, 0U, sizeof(sum));
+	(void)memset(shown, 0U, sizeof(shown));
+	for (pcpu_id = 0U; pcpu_id < phys_cpu_num; pcpu_id++) {
+		for (i = 0U; i < nr; i++) {
+			c = &per_cpu(lockstat, pcpu_id)[i];
+			sum[i].acquired += c->acquired;
+			sum[i].contended += c->contended;
+			sum[i].spin_cycles += c->spin_cycles;
+			if (c->max_hold > sum[i].max_hold) {
+				sum[i].max_hold = c->max_hold;
+			}
+		}
+	}
+
+	len = snprintf(str, size, "\r\nLOCK\t\t\t  ACQUIRED\t CONTENDED"
+			"\t   SPIN_CYC\t  MAX_HOLD");
+	size -= len;
+	str += len;
+
+	for (n = 0U; n < LOCKSTAT_TOP; n++) {
+		top = nr;
+		for (i = 0U; i < nr; i++) {
+			if (!shown[i] && ((top == nr) ||
+				(sum[i].spin_cycles > sum[top].spin_cycles))) {
+				top = i;
+			}
+		}
+		if ((top == nr) || (sum[top].acquired == 0UL)) {
+			break;
+		}
+		shown[top] = true;
+
+		if (lockstat_names[top] != NULL) {
+			len = snprintf(str, size, "\r\n%-24s",
+					lockstat_names[top]);
+		} else {
+			len = snprintf(str, size, "\r\n0x%-22llx",
+					(uint64_t)lockstat_locks[top]);
+		}
+		if (len >= size) {
+			goto END;
+		}
+		size -= len;
+		str += len;
+
+		len = snprintf(str, size, "%10lld\t%10lld\t%11lld\t%10lld",
+				sum[top].acquired, sum[top].contended,
+				sum[top].spin_cycles, sum[top].max_hold);
+		if (len >= size) {
+			goto END;
+		}
+		size -= len;
+		str += len;
+	}
+
+END:
+	snprintf(str, size, "\r\n");
+}
+#endif /* HV_DEBUG */
+#else
 void spinlock_obtain(spinlock_t *lock)
 {
 
@@ -32,3 +215,83 @@ void spinlock_obtain(spinlock_t *lock)
 		      [tail] "m"(lock->tail)
 		      : "cc", "memory");
 }
+#endif /* CONFIG_LOCKSTAT */
+
+void mcs_spinlock_init(mcs_spinlock_t *lock)
+{
+	(void)memset(lock, 0U, sizeof(mcs_spinlock_t));
+}
+
+/* Nodes are only taken and freed on their own pcpu, and an interrupt frees
+ * the nodes it took before returning, so the bitmap needs no bus lock.
+ */
+static struct mcs_node *mcs_node_get(void)
+{
+	uint16_t pcpu_id = get_cpu_id();
+	uint64_t *used = &per_cpu(mcs_nodes_used, pcpu_id);
+	uint16_t i = ffz64(*used);
+
+	/* Handing out a node past the array would corrupt the per_cpu data */
+	if (i >= MCS_NODES_PER_CPU) {
+		panic("pcpu %hu out of MCS nodes", pcpu_id);
+	}
+	bitmap_set_nolock(i, used);
+
+	return &per_cpu(mcs_nodes, pcpu_id)[i];
+}
+
+static void mcs_node_put(const struct mcs_node *node)
+{
+	uint16_t pcpu_id = get_cpu_id();
+	uint16_t i = (uint16_t)(node - per_cpu(mcs_nodes, pcpu_id));
+
+	bitmap_clear_nolock(i, &per_cpu(mcs_nodes_used, pcpu_id));
+}
+
+void mcs_spinlock_obtain(mcs_spinlock_t *lock)
+{
+	struct mcs_node *node = mcs_node_get();
+	struct mcs_node *prev;
+
+	node->next = NULL;
+	node->locked = 1U;
+
+	prev = (struct mcs_node *)atomic_swap64((uint64_t *)&lock->tail,
+			(uint64_t)node);
+	if (prev != NULL) {
+		/* Queue up and spin on our own cache line until the
+		 * previous holder hands the lock over.
+		 */
+		atomic_store64((uint64_t *)&prev->next, (uint64_t)node);
+		while (atomic_load32(&node->locked) != 0U) {
+			asm volatile ("pause" ::: "memory");
+		}
+	}
+
+	lock->owner = node;
+}
+
+void mcs_spinlock_release(mcs_spinlock_t *lock)
+{
+	struct mcs_node *node = lock->owner;
+	struct mcs_node *next;
+
+	next = (struct mcs_node *)atomic_load64((uint64_t *)&node->next);
+	if (next == NULL) {
+		if (atomic_cmpxchg64((uint64_t *)&lock->tail, (uint64_t)node,
+				0UL) == (uint64_t)node) {
+			mcs_node_put(node);
+			return;
+		}
+
+		/* A waiter swapped itself in but has not linked yet */
+		do {
+			asm volatile ("pause" ::: "memory");
+			next = (struct mcs_node *)atomic_load64(
+					(uint64_t *)&node->next);
+		} while (next == NULL);
+	}
+
+	atomic_store32(&next->locked, 0U);
+	mcs_node_put(node);
+}
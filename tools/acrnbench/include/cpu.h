@@ -0,0 +1,25 @@
+/*
+ * Copyright (C) 2018 Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* Host replacement of the hypervisor cpu.h, as used by atomic.h and bits.h */
+
+#ifndef CPU_H
+#define CPU_H
+
+#define BUS_LOCK	"lock ; "
+
+#define CPU_INT_ALL_DISABLE(p_rflags)	((void)(p_rflags))
+#define CPU_INT_ALL_RESTORE(rflags)	((void)(rflags))
+
+static inline uint64_t rdtsc(void)
+{
+	uint32_t lo, hi;
+
+	asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((uint64_t)hi << 32U) | lo;
+}
+
+#endif /* CPU_H */
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2018 Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Host replacement of the hypervisor.h umbrella header. It provides just
+ * enough of the hypervisor environment for the benchmarks to build some
+ * hypervisor sources unchanged as part of a userspace program. Each pcpu
+ * is a benchmark thread, which sets bench_cpu_id before using per_cpu().
+ */
+
+#ifndef HYPERVISOR_H
+#define HYPERVISOR_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <types.h>
+#include <cpu.h>
+#include <macros.h>
+#include <atomic.h>
+#include <bits.h>
+#include <list.h>
+#include <spinlock.h>
+#include <timer.h>
+
+#define BENCH_MAX_CPUS		64U
+#define BOOT_CPU_ID		0U
+
+/* Per-cpu data of the hypervisor sources built into the benchmarks */
+struct bench_per_cpu {
+	struct per_cpu_timers cpu_timers;
+	struct mcs_node mcs_nodes[MCS_NODES_PER_CPU];
+	uint64_t mcs_nodes_used;
+} __aligned(64);
+
+extern struct bench_per_cpu bench_per_cpu_data[BENCH_MAX_CPUS];
+extern __thread uint16_t bench_cpu_id;
+extern uint64_t bench_tsc_deadline;
+
+#define per_cpu(name, pcpu_id)	(bench_per_cpu_data[(pcpu_id)].name)
+
+static inline uint16_t get_cpu_id(void)
+{
+	return bench_cpu_id;
+}
+
+#define min(x, y)	(((x) < (y)) ? (x) : (y))
+#define max(x, y)	(((x) < (y)) ? (y) : (x))
+
+#define pr_err(...)	((void)fprintf(stderr, __VA_ARGS__))
+#define ASSERT(x, ...)	do { if (!(x)) { abort(); } } while (0)
+#define panic(...)	do { (void)fprintf(stderr, __VA_ARGS__); abort(); } \
+			while (0)
+
+#define TRACE_2L(evid, e, f)	do { } while (0)
+
+/* The TSC deadline MSR only records the last programmed deadline */
+#define MSR_IA32_TSC_DEADLINE	0x6e0U
+
+static inline void msr_write(uint32_t msr, uint64_t val)
+{
+	if (msr == MSR_IA32_TSC_DEADLINE) {
+		bench_tsc_deadline = val;
+	}
+}
+
+/* The host TSC frequency does not matter, any period is long enough */
+#define us_to_ticks(us)		((uint64_t)(us) * 1000UL)
+
+/* Timer setup and calibration are not run by the benchmarks */
+typedef void (*irq_action_t)(uint32_t irq, void *data);
+#define TIMER_IRQ			0U
+#define IRQF_NONE			0U
+#define VECTOR_TIMER			0xefU
+#define APIC_LVTT_TM_TSCDLT		0x00040000U
+#define LAPIC_LVT_TIMER_REGISTER	0x320U
+#define CR4_TSD				(1UL << 2U)
+#define request_irq(irq, func, data, flags)	((void)(func), -ENODEV)
+#define free_irq(irq)				((void)(irq))
+#define write_lapic_reg32(reg, val)		((void)(val))
+#define CPU_CR_READ(cr, p)			(*(p) = 0UL)
+#define CPU_CR_WRITE(cr, val)			((void)(val))
+#define pio_write8(val, port)			((void)(val))
+#define pio_read8(port)				(0U)
+#define cpuid(leaf, a, b, c, d)	(*(a) = 0U, *(b) = 0U, *(c) = 0U, *(d) = 0U)
+
+struct bench_cpuinfo {
+	uint32_t cpuid_level;
+};
+static const struct bench_cpuinfo boot_cpu_data;
+
+#endif /* HYPERVISOR_H */
@@ -0,0 +1,17 @@
+/*
+ * Copyright (C) 2018 Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* Host replacement of the hypervisor softirq.h, softirqs are run directly */
+
+#ifndef SOFTIRQ_H
+#define SOFTIRQ_H
+
+#define SOFTIRQ_TIMER		0U
+
+#define fire_softirq(nr)		((void)(nr))
+#define register_softirq(nr, func)	((void)(nr), (void)(func))
+
+#endif /* SOFTIRQ_H */
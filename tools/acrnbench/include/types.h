@@ -0,0 +1,21 @@
+/*
+ * Copyright (C) 2018 Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/* Host replacement of the hypervisor types.h, on top of the C library */
+
+#ifndef TYPES_H
+#define TYPES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
+#define __aligned(x)	__attribute__((aligned(x)))
+#define __packed	__attribute__((packed))
+#define __unused	__attribute__((unused))
+
+#endif /* TYPES_H */
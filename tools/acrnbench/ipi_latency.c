@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2018 Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Guest IPI round-trip latency.
+ *
+ * Run in a SMP guest: two threads pinned on two vcpus play ping-pong on
+ * futexes. Each one sleeps in FUTEX_WAIT between its turns, so the vcpu
+ * goes idle and each wakeup of the other thread is a reschedule IPI, a
+ * write of the x2APIC ICR trapped by the hypervisor. A round trip is two
+ * IPIs and two wakeups of an idle vcpu; its min/avg/p99/max are reported
+ * in ns.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <getopt.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+static volatile uint32_t ping;
+static volatile uint32_t pong;
+static uint32_t iters = 10000U;
+static int pong_cpu = 1;
+
+static void futex_wait(volatile uint32_t *addr, uint32_t val)
+{
+	while (__atomic_load_n(addr, __ATOMIC_ACQUIRE) == val) {
+		(void)syscall(SYS_futex, addr, FUTEX_WAIT, val, NULL, NULL, 0);
+	}
+}
+
+static void futex_post(volatile uint32_t *addr, uint32_t val)
+{
+	__atomic_store_n(addr, val, __ATOMIC_RELEASE);
+	(void)syscall(SYS_futex, addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+static int pin(int cpu)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000UL) + (uint64_t)ts.tv_nsec;
+}
+
+static void *pong_thread(void *arg)
+{
+	uint32_t i;
+
+	(void)arg;
+	if (pin(pong_cpu) != 0) {
+		fprintf(stderr, "can not run on cpu %d\n", pong_cpu);
+		exit(1);
+	}
+
+	for (i = 1U; i <= iters; i++) {
+		futex_wait(&ping, i - 1U);
+		futex_post(&pong, i);
+	}
+
+	return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-c ping_cpu,pong_cpu] [-n round_trips] "
+		"[-s sleep_us]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+	int ping_cpu = 0;
+	uint32_t i, sleep_us = 100U;
+	uint64_t *lat, start, sum = 0UL;
+	pthread_t tid;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "c:n:s:h")) != -1) {
+		switch (opt) {
+		case 'c':
+			if (sscanf(optarg, "%d,%d", &ping_cpu, &pong_cpu)
+					!= 2) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'n':
+			iters = (uint32_t)strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			sleep_us = (uint32_t)strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return (opt == 'h') ? 0 : 1;
+		}
+	}
+
+	if ((iters == 0U) || (ping_cpu == pong_cpu)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	lat = calloc(iters, sizeof(*lat));
+	if (lat == NULL) {
+		return 1;
+	}
+
+	if (pin(ping_cpu) != 0) {
+		fprintf(stderr, "can not run on cpu %d\n", ping_cpu);
+		return 1;
+	}
+	errno = pthread_create(&tid, NULL, pong_thread, NULL);
+	if (errno != 0) {
+		perror("pthread_create");
+		return 1;
+	}
+
+	for (i = 1U; i <= iters; i++) {
+		/* let the pong vcpu go idle before each round trip */
+		(void)usleep(sleep_us);
+		start = now_ns();
+		futex_post(&ping, i);
+		futex_wait(&pong, i - 1U);
+		lat[i - 1U] = now_ns() - start;
+		sum += lat[i - 1U];
+	}
+	(void)pthread_join(tid, NULL);
+
+	qsort(lat, iters, sizeof(*lat), cmp_u64);
+	printf("cpu %d <-> cpu %d, %u round trips (ns)\n",
+		ping_cpu, pong_cpu, iters);
+	printf("%10s %10s %10s %10s\n", "min", "avg", "p99", "max");
+	printf("%10lu %10lu %10lu %10lu\n", lat[0], sum / iters,
+		lat[((uint64_t)iters * 99UL) / 100UL], lat[iters - 1U]);
+
+	free(lat);
+	return 0;
+}
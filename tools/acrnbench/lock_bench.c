@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2018 Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Host stress benchmark of the ticket spinlock and the MCS lock of the
+ * hypervisor.
+ *
+ * lib/spinlock.c is built unchanged, without CONFIG_LOCKSTAT. For 1 to 64
+ * threads, each pinned on a host cpu and playing its own pcpu, all the
+ * threads take the same spinlock_t or mcs_spinlock_t in a loop for a fixed
+ * time, with a short critical section touching shared data. It reports the
+ * lock acquisitions per second summed over the threads.
+ *
+ * Spinning threads sharing a host cpu wait for the scheduler rather than
+ * for the lock, so the thread counts are capped by the online cpus unless
+ * asked otherwise.
+ */
+
+#define _GNU_SOURCE
+#include <time.h>
+#include <getopt.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <hypervisor.h>
+
+#include "lib/spinlock.c"
+
+struct bench_per_cpu bench_per_cpu_data[BENCH_MAX_CPUS];
+__thread uint16_t bench_cpu_id;
+uint64_t bench_tsc_deadline;
+
+/* Cache lines written in each critical section */
+#define CS_LINES	2U
+
+static spinlock_t ticket_lock;
+static mcs_spinlock_t mcs_lock;
+static bool use_mcs;
+static volatile uint64_t shared_data[CS_LINES * 8U] __aligned(64);
+
+static volatile uint32_t running;
+static volatile bool stop;
+
+struct bench_thread {
+	pthread_t tid;
+	uint16_t cpu_id;
+	uint64_t ops;
+} __aligned(64);
+
+static struct bench_thread threads[BENCH_MAX_CPUS];
+
+static void *lock_thread(void *arg)
+{
+	struct bench_thread *t = (struct bench_thread *)arg;
+	uint32_t i;
+	cpu_set_t set;
+
+	bench_cpu_id = t->cpu_id;
+	CPU_ZERO(&set);
+	CPU_SET(t->cpu_id % (uint16_t)sysconf(_SC_NPROCESSORS_ONLN), &set);
+	(void)pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+	(void)__atomic_add_fetch(&running, 1U, __ATOMIC_SEQ_CST);
+	while (!stop) {
+		if (use_mcs) {
+			mcs_spinlock_obtain(&mcs_lock);
+		} else {
+			spinlock_obtain(&ticket_lock);
+		}
+		for (i = 0U; i < CS_LINES; i++) {
+			shared_data[i * 8U]++;
+		}
+		if (use_mcs) {
+			mcs_spinlock_release(&mcs_lock);
+		} else {
+			spinlock_release(&ticket_lock);
+		}
+		t->ops++;
+	}
+
+	return NULL;
+}
+
+/* Acquisitions per second of nthreads threads during ms milliseconds */
+static double bench_lock(uint32_t nthreads, bool mcs, uint32_t ms)
+{
+	uint32_t i;
+	uint64_t ops = 0UL;
+
+	spinlock_init(&ticket_lock);
+	mcs_spinlock_init(&mcs_lock);
+	use_mcs = mcs;
+	running = 0U;
+	stop = false;
+
+	for (i = 0U; i < nthreads; i++) {
+		threads[i].cpu_id = (uint16_t)i;
+		threads[i].ops = 0UL;
+		if (pthread_create(&threads[i].tid, NULL, lock_thread,
+				&threads[i]) != 0) {
+			perror("pthread_create");
+			exit(1);
+		}
+	}
+	while (running != nthreads) {
+		(void)sched_yield();
+	}
+
+	(void)usleep(ms * 1000U);
+	stop = true;
+
+	for (i = 0U; i < nthreads; i++) {
+		(void)pthread_join(threads[i].tid, NULL);
+		ops += threads[i].ops;
+	}
+
+	return ((double)ops * 1000.0) / (double)ms;
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-t max_threads] [-d duration_ms]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t max_threads = (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+	uint32_t ms = 500U, n;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:d:h")) != -1) {
+		switch (opt) {
+		case 't':
+			max_threads = (uint32_t)strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			ms = (uint32_t)strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return (opt == 'h') ? 0 : 1;
+		}
+	}
+
+	if ((max_threads == 0U) || (ms == 0U)) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (max_threads > BENCH_MAX_CPUS) {
+		max_threads = BENCH_MAX_CPUS;
+	}
+
+	printf("%8s %14s %14s   (Mops/s)\n", "threads", "ticket", "mcs");
+	/* Powers of two, then max_threads */
+	for (n = 1U; ; n *= 2U) {
+		n = min(n, max_threads);
+		printf("%8u", n);
+		printf(" %14.2f", bench_lock(n, false, ms) / 1e6);
+		printf(" %14.2f\n", bench_lock(n, true, ms) / 1e6);
+		if (n == max_threads) {
+			break;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2018 Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Host microbenchmark of the memcpy_s() and memset() of the hypervisor.
+ *
+ * lib/memops.c is built unchanged, its functions renamed so that they do
+ * not clash with the C library ones. Each size is copied and set in a
+ * loop from hot buffers, with the fast strings features of init_fast_strings
+ * forced to:
+ *
+ *   movsq   none, rep movsq/stosq for the bulk and byte loops
+ *   erms    ERMS, rep movsb/stosb from ERMS_MIN_SIZE on
+ *   fsrm    FSRM, rep movsb/stosb for any size
+ *
+ * The 8, 16 and 32 bytes copies take the unrolled path in all the modes.
+ * rep movsb/stosb are only fast on the CPUs which report the features.
+ */
+
+#include <time.h>
+#include <getopt.h>
+#include <hypervisor.h>
+
+#define memset		hv_memset
+#define memcpy_s	hv_memcpy_s
+#define memchr		hv_memchr
+#include "lib/memops.c"
+#undef memset
+#undef memcpy_s
+#undef memchr
+
+struct bench_per_cpu bench_per_cpu_data[BENCH_MAX_CPUS];
+__thread uint16_t bench_cpu_id;
+uint64_t bench_tsc_deadline;
+
+#define MAX_SIZE	(1UL << 20U)
+
+static const size_t sizes[] = {
+	8U, 16U, 32U, 64U, 128U, 256U, 512U, 1024U, 4096U, 65536U, MAX_SIZE
+};
+
+static const struct {
+	const char *name;
+	bool erms;
+	bool fsrm;
+} modes[] = {
+	{ "movsq", false, false },
+	{ "erms", true, false },
+	{ "fsrm", true, true },
+};
+
+static uint8_t src_buf[MAX_SIZE] __aligned(64);
+static uint8_t dst_buf[MAX_SIZE] __aligned(64);
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000UL) + (uint64_t)ts.tv_nsec;
+}
+
+/* GB/s of iters calls on size bytes, memset if set, else memcpy_s */
+static double bench_size(size_t size, uint64_t iters, bool set)
+{
+	uint64_t i, start;
+
+	start = now_ns();
+	for (i = 0UL; i < iters; i++) {
+		if (set) {
+			(void)hv_memset(dst_buf, (uint8_t)i, size);
+		} else {
+			(void)hv_memcpy_s(dst_buf, MAX_SIZE, src_buf, size);
+		}
+		/* keep each call, the fixed size copies are plain stores */
+		asm volatile ("" : : : "memory");
+	}
+
+	return (double)(size * iters) / (double)(now_ns() - start);
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-b mbytes]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+	uint64_t bytes = 1024UL << 20U, iters;
+	uint32_t s, m;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "b:h")) != -1) {
+		switch (opt) {
+		case 'b':
+			bytes = strtoull(optarg, NULL, 0) << 20U;
+			break;
+		default:
+			usage(argv[0]);
+			return (opt == 'h') ? 0 : 1;
+		}
+	}
+
+	if (bytes == 0UL) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	(void)hv_memset(src_buf, 0x5aU, MAX_SIZE);
+
+	printf("%8s", "size");
+	for (m = 0U; m < ARRAY_SIZE(modes); m++) {
+		printf("  cpy %-5s  set %-5s", modes[m].name, modes[m].name);
+	}
+	printf("   (GB/s)\n");
+
+	for (s = 0U; s < ARRAY_SIZE(sizes); s++) {
+		iters = bytes / sizes[s];
+		if (iters == 0UL) {
+			iters = 1UL;
+		}
+		printf("%8zu", sizes[s]);
+		for (m = 0U; m < ARRAY_SIZE(modes); m++) {
+			init_fast_strings(modes[m].erms, modes[m].fsrm);
+			printf("  %9.2f", bench_size(sizes[s], iters, false));
+			printf("  %9.2f", bench_size(sizes[s], iters, true));
+		}
+		printf("\n");
+	}
+
+	return 0;
+}
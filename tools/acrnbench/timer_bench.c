@@ -0,0 +1,309 @@
+/*
+ * Copyright (C) 2018 Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Host microbenchmark of the per-pcpu timer queue of the hypervisor.
+ *
+ * The timer min-heap of arch/x86/timer.c is built unchanged and compared
+ * with the sorted timer list it replaced, kept below as it was, for 1 to
+ * MAX_TIMER_NUM active timers:
+ *
+ *   rearm   add_timer() of a random active timer to a new deadline, as done
+ *           by each vlapic timer or TSC deadline write of a guest
+ *   expire  timer_softirq() when all the timers expired, per timer
+ *
+ * All the timers are on the pcpu of the calling thread.
+ */
+
+#include <time.h>
+#include <getopt.h>
+#include <hypervisor.h>
+#include <softirq.h>
+
+#include "arch/x86/timer.c"
+
+struct bench_per_cpu bench_per_cpu_data[BENCH_MAX_CPUS];
+__thread uint16_t bench_cpu_id;
+uint64_t bench_tsc_deadline;
+
+/* Sorted timer list, as in the hypervisor before the min-heap */
+#define MAX_TIMER_ACTIONS	32U
+
+struct list_timer {
+	struct list_head node;
+	int mode;
+	uint64_t fire_tsc;
+	uint64_t period_in_cycle;
+	timer_handle_t func;
+	void *priv_data;
+};
+
+static struct list_head timer_list;
+
+static void list_local_add_timer(struct list_timer *timer, bool *need_update)
+{
+	struct list_head *pos, *prev;
+	struct list_timer *tmp;
+	uint64_t tsc = timer->fire_tsc;
+
+	prev = &timer_list;
+	list_for_each(pos, &timer_list) {
+		tmp = list_entry(pos, struct list_timer, node);
+		if (tmp->fire_tsc < tsc) {
+			prev = &tmp->node;
+		} else {
+			break;
+		}
+	}
+
+	list_add(&timer->node, prev);
+
+	if (need_update != NULL) {
+		*need_update = (prev == &timer_list);
+	}
+}
+
+static void list_update_physical_timer(void)
+{
+	struct list_timer *timer;
+
+	if (!list_empty(&timer_list)) {
+		timer = list_entry(timer_list.next, struct list_timer, node);
+		msr_write(MSR_IA32_TSC_DEADLINE, timer->fire_tsc);
+	}
+}
+
+static void list_add_timer(struct list_timer *timer)
+{
+	bool need_update;
+
+	list_local_add_timer(timer, &need_update);
+	if (need_update) {
+		list_update_physical_timer();
+	}
+}
+
+static void list_del_timer(struct list_timer *timer)
+{
+	if (!list_empty(&timer->node)) {
+		list_del_init(&timer->node);
+	}
+}
+
+static void list_timer_softirq(void)
+{
+	struct list_timer *timer;
+	struct list_head *pos, *n;
+	int tries = MAX_TIMER_ACTIONS;
+	uint64_t current_tsc = rdtsc();
+
+	list_for_each_safe(pos, n, &timer_list) {
+		timer = list_entry(pos, struct list_timer, node);
+		tries--;
+		if ((timer->fire_tsc <= current_tsc) && (tries > 0)) {
+			list_del_timer(timer);
+			if ((timer->func != NULL) && (timer->fire_tsc != 0UL)) {
+				timer->func(timer->priv_data);
+			}
+			if (timer->mode == TICK_MODE_PERIODIC) {
+				timer->fire_tsc += timer->period_in_cycle;
+				list_local_add_timer(timer, NULL);
+			}
+		} else {
+			break;
+		}
+	}
+
+	list_update_physical_timer();
+}
+
+/* Deadlines far enough not to expire during the run */
+#define FUTURE_TSC	(1UL << 60U)
+#define PERIOD_TSC	(1UL << 58U)
+
+static struct hv_timer heap_timers[MAX_TIMER_NUM];
+static struct list_timer list_timers[MAX_TIMER_NUM];
+static uint64_t fired;
+
+static void timer_fn(__unused void *data)
+{
+	fired++;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000UL) + (uint64_t)ts.tv_nsec;
+}
+
+/* xorshift, the same sequence for both queues */
+static uint64_t rnd_state;
+
+static uint64_t rnd(void)
+{
+	rnd_state ^= rnd_state << 13U;
+	rnd_state ^= rnd_state >> 7U;
+	rnd_state ^= rnd_state << 17U;
+	return rnd_state;
+}
+
+static double bench_rearm_list(uint32_t n, uint64_t ops)
+{
+	uint64_t i, start;
+	struct list_timer *t;
+
+	INIT_LIST_HEAD(&timer_list);
+	rnd_state = 88172645463325252UL;
+	for (i = 0UL; i < n; i++) {
+		t = &list_timers[i];
+		INIT_LIST_HEAD(&t->node);
+		t->func = timer_fn;
+		t->mode = TICK_MODE_ONESHOT;
+		t->fire_tsc = FUTURE_TSC + (rnd() >> 8U);
+		list_add_timer(t);
+	}
+
+	start = now_ns();
+	for (i = 0UL; i < ops; i++) {
+		t = &list_timers[rnd() % n];
+		list_del_timer(t);
+		t->fire_tsc = FUTURE_TSC + (rnd() >> 8U);
+		list_add_timer(t);
+	}
+
+	return (double)(now_ns() - start) / (double)ops;
+}
+
+static double bench_rearm_heap(uint32_t n, uint64_t ops)
+{
+	uint64_t i, start;
+	struct hv_timer *t;
+
+	init_percpu_timer(get_cpu_id());
+	rnd_state = 88172645463325252UL;
+	for (i = 0UL; i < n; i++) {
+		t = &heap_timers[i];
+		initialize_timer(t, timer_fn, NULL,
+			FUTURE_TSC + (rnd() >> 8U), TICK_MODE_ONESHOT, 0UL);
+		(void)add_timer(t);
+	}
+
+	start = now_ns();
+	for (i = 0UL; i < ops; i++) {
+		t = &heap_timers[rnd() % n];
+		t->fire_tsc = FUTURE_TSC + (rnd() >> 8U);
+		(void)add_timer(t);
+	}
+
+	return (double)(now_ns() - start) / (double)ops;
+}
+
+/* The list handles at most MAX_TIMER_ACTIONS - 1 timers per softirq */
+static double bench_expire_list(uint32_t n, uint32_t rounds)
+{
+	uint64_t total = 0UL, start, past;
+	uint32_t r, i;
+	struct list_timer *t;
+
+	rnd_state = 88172645463325252UL;
+	for (r = 0U; r < rounds; r++) {
+		INIT_LIST_HEAD(&timer_list);
+		past = rdtsc() - 1UL;
+		for (i = 0U; i < n; i++) {
+			t = &list_timers[i];
+			INIT_LIST_HEAD(&t->node);
+			t->func = timer_fn;
+			t->mode = TICK_MODE_PERIODIC;
+			t->period_in_cycle = PERIOD_TSC;
+			t->fire_tsc = past - (rnd() % past);
+			list_add_timer(t);
+		}
+
+		fired = 0UL;
+		start = now_ns();
+		while (fired < n) {
+			list_timer_softirq();
+		}
+		total += now_ns() - start;
+	}
+
+	return (double)total / ((double)rounds * (double)n);
+}
+
+static double bench_expire_heap(uint32_t n, uint32_t rounds)
+{
+	uint64_t total = 0UL, start, past;
+	uint32_t r, i;
+	struct hv_timer *t;
+
+	rnd_state = 88172645463325252UL;
+	for (r = 0U; r < rounds; r++) {
+		init_percpu_timer(get_cpu_id());
+		past = rdtsc() - 1UL;
+		for (i = 0U; i < n; i++) {
+			t = &heap_timers[i];
+			initialize_timer(t, timer_fn, NULL,
+				past - (rnd() % past), TICK_MODE_PERIODIC,
+				PERIOD_TSC);
+			(void)add_timer(t);
+		}
+
+		fired = 0UL;
+		start = now_ns();
+		while (fired < n) {
+			timer_softirq(get_cpu_id());
+		}
+		total += now_ns() - start;
+	}
+
+	return (double)total / ((double)rounds * (double)n);
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-o rearm_ops] [-r expire_rounds]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+	uint64_t ops = 1000000UL;
+	uint32_t rounds = 10000U;
+	uint32_t n;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "o:r:h")) != -1) {
+		switch (opt) {
+		case 'o':
+			ops = strtoull(optarg, NULL, 0);
+			break;
+		case 'r':
+			rounds = (uint32_t)strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return (opt == 'h') ? 0 : 1;
+		}
+	}
+
+	if ((ops == 0UL) || (rounds == 0U)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	printf("%-8s %12s %12s %12s %12s\n", "timers", "rearm_list",
+		"rearm_heap", "expire_list", "expire_heap");
+	for (n = 1U; n <= MAX_TIMER_NUM; n <<= 1U) {
+		printf("%-8u %12.1f %12.1f %12.1f %12.1f\n", n,
+			bench_rearm_list(n, ops), bench_rearm_heap(n, ops),
+			bench_expire_list(n, rounds),
+			bench_expire_heap(n, rounds));
+	}
+	printf("(ns per timer operation)\n");
+
+	return 0;
+}
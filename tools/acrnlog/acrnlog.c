@@ -23,10 +23,31 @@
 #define LOG_INCOMPLETE_WARNING	"WARNING: logs missing here! "\
 				"Try reducing polling interval"
 
+/* Binary log records, see struct log_bin_record in the hypervisor */
+#define LOG_BIN_MAGIC		0xb1
+#define LOG_BIN_MAX_ARGS	16
+
 /* num of physical cpu, not the cpu num seen on SOS */
 static unsigned int pcpu_num = PCPU_NUM;
 static unsigned long interval = DEFAULT_POLL_INTERVAL;
 
+/* .rodata of the hypervisor (acrn.logdict), to format binary records */
+static char *log_dict;
+static size_t log_dict_size;
+
+struct log_bin_record {
+	__u8 magic;		/* LOG_BIN_MAGIC */
+	__u8 nr_entries;	/* sbuf entries taken by the record */
+	__u8 severity;
+	__u8 nr_args;
+	__u32 fmt_id;		/* offset of the format in log_dict */
+	__u64 timestamp;	/* in us */
+	__u32 seq;
+	__u16 pcpu_id;
+	__u16 str_len;		/* size of the strings after the args */
+	__u64 args[LOG_BIN_MAX_ARGS];
+};
+
 struct hvlog_msg {
 	__u64 usec;		/* timestamp, from tsc reset in usec */
 	int cpu;		/* which physical cpu output the log */
@@ -48,6 +69,9 @@ struct hvlog_dev {
 	int latched;		/* 1 if an sbuf element latched */
 	char entry_latch[LOG_ELEMENT_SIZE];	/* latch for an sbuf element */
 	struct hvlog_msg latched_msg;	/* latch for parsed msg */
+
+	int bin_latched;	/* 1 if a decoded binary record latched */
+	struct hvlog_msg *bin_msg;	/* latch for the decoded record */
 };
 
 /*
@@ -78,6 +102,204 @@ static int get_cpu_num(void)
 	return cpu_num;
 }
 
+static int load_log_dict(const char *path)
+{
+	struct stat st;
+	int fd, ret = -1;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st)) {
+		perror(path);
+		goto out;
+	}
+
+	/* one more byte, so that the last format string is terminated */
+	log_dict = calloc(1, st.st_size + 1);
+	if (!log_dict)
+		goto out;
+
+	if (read(fd, log_dict, st.st_size) != st.st_size) {
+		perror(path);
+		free(log_dict);
+		log_dict = NULL;
+		goto out;
+	}
+
+	log_dict_size = st.st_size;
+	ret = 0;
+ out:
+	if (fd >= 0)
+		close(fd);
+	return ret;
+}
+
+/*
+ * Format one conversion of a binary record, arg being stored the way the
+ * hypervisor printf reads it: 64 bits for "ll" and %p, 32 bits otherwise.
+ */
+static int format_bin_arg(char *out, size_t size, const char *spec,
+			  int spec_len, char conv, const char *len_mod,
+			  __u64 arg, const char *strs, size_t str_len)
+{
+	char f[32];
+
+	if (conv == 'p')
+		return snprintf(out, size, "0x%llx", arg);
+
+	if (conv == 's') {
+		snprintf(f, sizeof(f), "%.*ss", spec_len, spec);
+		return snprintf(out, size, f,
+				arg < str_len ? strs + arg : "(null)");
+	}
+
+	if (conv == 'c') {
+		snprintf(f, sizeof(f), "%.*sc", spec_len, spec);
+		return snprintf(out, size, f, (int)(char)arg);
+	}
+
+	snprintf(f, sizeof(f), "%.*sll%c", spec_len, spec, conv);
+	if (!strcmp(len_mod, "hh"))
+		arg = (conv == 'd' || conv == 'i') ? (__u64)(signed char)arg
+			: (__u8)arg;
+	else if (!strcmp(len_mod, "h"))
+		arg = (conv == 'd' || conv == 'i') ? (__u64)(short)arg
+			: (__u16)arg;
+	else if (strcmp(len_mod, "ll"))
+		arg = (conv == 'd' || conv == 'i') ? (__u64)(int)arg
+			: (__u32)arg;
+
+	return snprintf(out, size, f, arg);
+}
+
+/* Format a binary record into msg, the same way the hypervisor would */
+static void format_bin_record(const struct log_bin_record *rec,
+			      struct hvlog_msg *msg)
+{
+	const char *strs = (const char *)&rec->args[rec->nr_args];
+	const char *fmt, *spec, *spec_end;
+	char len_mod[3], conv;
+	size_t size = LOG_MSG_SIZE - 1, len;
+	int i = 0, n;
+
+	msg->usec = rec->timestamp;
+	msg->cpu = rec->pcpu_id;
+	msg->sev = rec->severity;
+	msg->seq = rec->seq;
+
+	len = snprintf(msg->raw, size, "[%lluus][cpu=%hu][sev=%u][seq=%u]:",
+		       rec->timestamp, rec->pcpu_id, rec->severity, rec->seq);
+
+	if (!log_dict || rec->fmt_id >= log_dict_size) {
+		len += snprintf(msg->raw + len, size - len, "<fmt 0x%x>",
+				rec->fmt_id);
+		for (i = 0; i < rec->nr_args && len < size; i++)
+			len += snprintf(msg->raw + len, size - len,
+					" 0x%llx", rec->args[i]);
+		goto out;
+	}
+
+	fmt = log_dict + rec->fmt_id;
+	while (*fmt && len < size) {
+		if (*fmt != '%') {
+			msg->raw[len++] = *fmt++;
+			continue;
+		}
+
+		spec = fmt++;
+		fmt += strspn(fmt, "#0- +");
+		fmt += strspn(fmt, "0123456789");
+		if (*fmt == '.') {
+			fmt++;
+			fmt += strspn(fmt, "0123456789");
+		}
+		spec_end = fmt;
+
+		n = 0;
+		while ((*fmt == 'h' || *fmt == 'l') && n < 2)
+			len_mod[n++] = *fmt++;
+		len_mod[n] = 0;
+
+		conv = *fmt;
+		if (!conv)
+			break;
+		fmt++;
+
+		if (conv == '%') {
+			msg->raw[len++] = '%';
+			continue;
+		}
+
+		if (!strchr("diuoxXspc", conv)) {
+			/* printed as is, takes no argument */
+			n = snprintf(msg->raw + len, size - len, "%.*s",
+				     (int)(fmt - spec), spec);
+		} else if (i < rec->nr_args) {
+			n = format_bin_arg(msg->raw + len, size - len, spec,
+					   (int)(spec_end - spec), conv,
+					   len_mod, rec->args[i++], strs,
+					   rec->str_len);
+		} else {
+			break;
+		}
+
+		len += n;
+	}
+
+ out:
+	if (len > size)
+		len = size;
+	msg->raw[len++] = '\n';
+	msg->raw[len] = 0;
+	msg->len = len;
+}
+
+/*
+ * The hypervisor drops whole records when it overwrites old ones, but an
+ * entry left from a record whose start was overwritten while being read
+ * may begin with LOG_BIN_MAGIC by chance. Such an entry is not taken as the
+ * start of a binary record unless its header is consistent.
+ */
+static int bin_record_valid(const char *entry)
+{
+	const struct log_bin_record *rec = (const struct log_bin_record *)entry;
+	size_t size;
+
+	if (rec->nr_entries == 0 || rec->nr_args > LOG_BIN_MAX_ARGS ||
+	    rec->nr_entries * LOG_ELEMENT_SIZE > LOG_MSG_SIZE)
+		return 0;
+
+	size = sizeof(*rec) - sizeof(rec->args) +
+	       rec->nr_args * sizeof(__u64) + rec->str_len;
+	return (size + LOG_ELEMENT_SIZE - 1) / LOG_ELEMENT_SIZE ==
+	       rec->nr_entries;
+}
+
+/*
+ * Read the rest of the binary record starting with entry, and format it
+ * into msg.
+ */
+static void hvlog_read_bin(struct hvlog_dev *dev, const char *entry,
+			   struct hvlog_msg *msg)
+{
+	char buf[LOG_MSG_SIZE + 1] __attribute__((aligned(8))) = { };
+	struct log_bin_record *rec = (struct log_bin_record *)buf;
+	int i;
+
+	memcpy(buf, entry, LOG_ELEMENT_SIZE);
+	for (i = 1; i < rec->nr_entries &&
+	     (i + 1) * LOG_ELEMENT_SIZE <= LOG_MSG_SIZE; i++) {
+		if (read(dev->fd, buf + i * LOG_ELEMENT_SIZE,
+			 LOG_ELEMENT_SIZE) <= 0)
+			break;
+	}
+
+	if (rec->nr_args > LOG_BIN_MAX_ARGS)
+		rec->nr_args = LOG_BIN_MAX_ARGS;
+
+	memset(msg, 0, sizeof(struct hvlog_msg) + LOG_MSG_SIZE);
+	format_bin_record(rec, msg);
+}
+
 /*
  * The function read a complete msg from acrnlog dev.
  * read one more sbuf entry if read an entry doesn't end with '\0'
@@ -94,6 +316,13 @@ struct hvlog_msg *hvlog_read_dev(struct hvlog_dev *dev)
 	msg[0] = dev->msg;
 	msg[1] = &dev->latched_msg;
 
+	if (dev->bin_latched) {
+		dev->bin_latched = 0;
+		memcpy(msg[0], dev->bin_msg,
+		       sizeof(struct hvlog_msg) + LOG_MSG_SIZE);
+		return msg[0];
+	}
+
 	memset(msg[0], 0, sizeof(struct hvlog_msg) + LOG_MSG_SIZE);
 	msg_num = 0;
 
@@ -111,6 +340,23 @@ struct hvlog_msg *hvlog_read_dev(struct hvlog_dev *dev)
 				 LOG_ELEMENT_SIZE);
 			if (!ret)
 				break;
+			/* a binary record is a complete message */
+			if ((unsigned char)msg[0]->raw[msg[0]->len] ==
+			    LOG_BIN_MAGIC &&
+			    bin_record_valid(&msg[0]->raw[msg[0]->len])) {
+				if (msg_num == 0) {
+					hvlog_read_bin(dev, msg[0]->raw,
+						       msg[0]);
+					return msg[0];
+				}
+				/* ends the message being read, latch it */
+				hvlog_read_bin(dev, &msg[0]->raw[msg[0]->len],
+					       dev->bin_msg);
+				memset(&msg[0]->raw[msg[0]->len], 0,
+				       LOG_ELEMENT_SIZE);
+				dev->bin_latched = 1;
+				break;
+			}
 			/* do we read a new meaasge? */
 			ret =
 			    sscanf(&msg[0]->raw[msg[0]->len],
@@ -176,11 +422,19 @@ struct hvlog_dev *hvlog_open_dev(const char *path)
 		goto alloc_msg;
 	}
 
+	dev->bin_msg = calloc(1, sizeof(struct hvlog_msg) + LOG_MSG_SIZE);
+	if (!dev->bin_msg) {
+		printf("%s %d\n", __FUNCTION__, __LINE__);
+		goto alloc_bin_msg;
+	}
+
 	return dev;
 
- open_fd:
-	close(dev->fd);
+ alloc_bin_msg:
+	free(dev->msg);
  alloc_msg:
+	close(dev->fd);
+ open_fd:
 	free(dev);
  open_dev:
 	return NULL;
@@ -193,6 +447,8 @@ void hvlog_close_dev(struct hvlog_dev *dev)
 
 	if (dev->msg)
 		free(dev->msg);
+	if (dev->bin_msg)
+		free(dev->bin_msg);
 	if (dev->fd > 0)
 		close(dev->fd);
 	free(dev);
@@ -404,15 +660,18 @@ static int mk_dir(const char *path)
 }
 
 /* for user optinal args */
-static const char optString[] = "s:n:t:h";
+static const char optString[] = "s:n:t:d:h";
 
 static void display_usage(void)
 {
 	printf("acrnlog - tool to collect ACRN hypervisor log\n"
-	       "[Usage] acrnlog [-s size] [-n number] [-t interval] [-h]\n\n"
+	       "[Usage] acrnlog [-s size] [-n number] [-t interval] [-d dict]"
+	       " [-h]\n\n"
 	       "[Options]\n"
 	       "\t-h: print this message\n"
 	       "\t-t: polling interval to collect logs, in ms\n"
+	       "\t-d: acrn.logdict of the running hypervisor, to format\n"
+	       "\t    the binary log records\n"
 	       "\t-s: size limitation for each log file, in MB.\n"
 	       "\t    0 means no limitation.\n"
 	       "\t-n: how many files you would like to keep on disk\n"
@@ -442,6 +701,10 @@ static int parse_opt(int argc, char *argv[])
 			interval = ret * 1000;
 			printf("Polling interval is %u ms\n", ret);
 			break;
+		case 'd':
+			if (load_log_dict(optarg))
+				return -EINVAL;
+			break;
 		case 'h':
 			display_usage();
 			return -EINVAL;
@@ -9,6 +9,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/ioctl.h>
 #include <sys/statvfs.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -29,10 +30,12 @@ static int exiting = 0;
 
 /* for opt */
 static uint64_t period = 10000;
-static const char optString[] = "i:hct:";
+static const char optString[] = "i:hct:e:v:";
 static const char dev_prefix[] = "acrn_trace_";
 
 static uint32_t flags;
+static struct trace_filter_param filter = { .vm_id = TRACE_VM_ANY };
+static int ev_filter;
 static char trace_file_dir[TRACE_FILE_DIR_LEN];
 
 static reader_struct *reader;
@@ -41,14 +44,71 @@ static int pcpu_num = 0;
 static void display_usage(void)
 {
 	printf("acrntrace - tool to collect ACRN trace data\n"
-	       "[Usage] acrntrace [-i period] [-t max_time] [-ch]\n\n"
+	       "[Usage] acrntrace [-i period] [-t max_time] [-e event,...]"
+	       " [-v vmid] [-ch]\n\n"
 	       "[Options]\n"
 	       "\t-h: print this message\n"
 	       "\t-i: period_in_ms: specify polling interval [1-999]\n"
 	       "\t-t: max time to capture trace data (in second)\n"
+	       "\t-e: only trace the given event ids, e.g. -e 0x10,0x10012\n"
+	       "\t-v: only trace the pcpus running the given VM\n"
 	       "\t-c: clear the buffered old data\n");
 }
 
+static int parse_events(char *list)
+{
+	char *tok, *end;
+	unsigned long evid;
+	uint32_t idx;
+
+	for (tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+		evid = strtoul(tok, &end, 0);
+		if (end == tok || *end != '\0') {
+			pr_err("'-e' invalid event id %s\n", tok);
+			return -EINVAL;
+		}
+
+		idx = TRACE_EVENT_INDEX(evid);
+		filter.ev_mask[idx / 64] |= 1UL << (idx % 64);
+	}
+
+	ev_filter = 1;
+	flags |= FLAG_FILTER;
+	return 0;
+}
+
+static int set_trace_filter(struct trace_filter_param *param)
+{
+	int fd, ret;
+
+	fd = open(VHM_DEV_PATH, O_RDWR);
+	if (fd < 0) {
+		pr_err("Failed to open %s, err %d\n", VHM_DEV_PATH, errno);
+		return -1;
+	}
+
+	ret = ioctl(fd, IC_SETUP_TRACE_FILTER, param);
+	if (ret < 0)
+		pr_err("Failed to set trace filter, err %d\n", errno);
+
+	close(fd);
+	return ret;
+}
+
+/* Trace all the events of all the VMs again */
+static void reset_trace_filter(void)
+{
+	struct trace_filter_param param;
+
+	if (!(flags & FLAG_FILTER))
+		return;
+
+	memset(&param, 0xff, sizeof(param));
+	param.vm_id = TRACE_VM_ANY;
+	set_trace_filter(&param);
+	flags &= ~FLAG_FILTER;
+}
+
 static void timer_handler(union sigval sv)
 {
 	exiting = 1;
@@ -116,6 +176,19 @@ static int parse_opt(int argc, char *argv[])
 		case 'c':
 			flags |= FLAG_CLEAR_BUF;
 			break;
+		case 'e':
+			if (parse_events(optarg))
+				return -EINVAL;
+			break;
+		case 'v':
+			ret = atoi(optarg);
+			if (ret < 0 || ret >= TRACE_VM_ANY) {
+				pr_err("'-v' require a valid vm id\n");
+				return -EINVAL;
+			}
+			filter.vm_id = ret;
+			flags |= FLAG_FILTER;
+			break;
 		case 'h':
 			display_usage();
 			return -EINVAL;
@@ -303,6 +376,8 @@ static void handle_on_exit(void)
 {
 	uint32_t cpu;
 
+	reset_trace_filter();
+
 	/* if nothing to release */
 	if (!(flags & FLAG_TO_REL))
 		return;
@@ -353,6 +428,14 @@ int main(int argc, char *argv[])
 
 	atexit(handle_on_exit);
 
+	if (flags & FLAG_FILTER) {
+		/* -v alone keeps all the events */
+		if (!ev_filter)
+			memset(filter.ev_mask, 0xff, sizeof(filter.ev_mask));
+		if (set_trace_filter(&filter) < 0)
+			exit(EXIT_FAILURE);
+	}
+
 	/* acquair res for each trace dev */
 	flags |= FLAG_TO_REL;
 	foreach_cpu(cpu)
@@ -374,6 +457,7 @@ int main(int argc, char *argv[])
 
 	free(reader);
 	flags &= ~FLAG_TO_REL;
+	reset_trace_filter();
 
 	return EXIT_SUCCESS;
 }
@@ -9,7 +9,8 @@
 
 #define PCPU_NUM        	4
 #define TRACE_ELEMENT_SIZE      32	/* byte */
-#define TRACE_ELEMENT_NUM	((4 * 1024 * 1024 - 64) / TRACE_ELEMENT_SIZE)
+#define TRACE_ELEMENT_NUM	((4 * 1024 * 1024 - SBUF_HEAD_SIZE) / \
+				TRACE_ELEMENT_SIZE)
 #define PAGE_SIZE		4096
 #define PAGE_MASK		(~(PAGE_SIZE - 1))
 #define MMAP_SIZE		(4 * 1024 * 1024)
@@ -38,17 +39,36 @@
  * flags:
  * FLAG_TO_REL   - resources need to be release
  * FLAG_CLEAR_BUF - to clear buffered old data
+ * FLAG_FILTER   - trace filter set, to be reset on exit
  */
 #define FLAG_TO_REL		(1UL << 0)
 #define FLAG_CLEAR_BUF		(1UL << 1)
+#define FLAG_FILTER		(1UL << 2)
 
 #define foreach_cpu(cpu)                                       \
         for ((cpu) = 0; (cpu) < (pcpu_num); (cpu)++)
 
 typedef unsigned char uint8_t;
+typedef unsigned short uint16_t;
 typedef unsigned int uint32_t;
 typedef unsigned long uint64_t;
 
+/* Trace event filter, set through the VHM driver (HC_SETUP_TRACE_FILTER) */
+#define VHM_DEV_PATH		"/dev/acrn_vhm"
+#define IC_SETUP_TRACE_FILTER	((0x43UL << 24) | (0x70UL + 0x00))
+
+#define TRACE_EVENT_MAX		1024
+#define TRACE_EVENT_INDEX(evid)	\
+	((((evid) >> 8) & 0x300) | ((evid) & 0xff))
+#define TRACE_VM_ANY		0xffff
+
+struct trace_filter_param {
+	uint16_t vm_id;
+	uint16_t reserved0;
+	uint32_t reserved1;
+	uint64_t ev_mask[TRACE_EVENT_MAX / 64];
+} __attribute__((aligned(8)));
+
 typedef struct {
 	uint64_t tsc;
 	uint64_t id;
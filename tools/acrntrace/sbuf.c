@@ -12,11 +12,6 @@
 #include "sbuf.h"
 #include <errno.h>
 
-static inline bool sbuf_is_empty(shared_buf_t *sbuf)
-{
-	return (sbuf->head == sbuf->tail);
-}
-
 static inline uint32_t sbuf_next_ptr(uint32_t pos,
 		uint32_t span, uint32_t scope)
 {
@@ -25,50 +20,95 @@ static inline uint32_t sbuf_next_ptr(uint32_t pos,
 	return pos;
 }
 
-int sbuf_get(shared_buf_t *sbuf, uint8_t *data)
+static inline uint32_t sbuf_used(shared_buf_t *sbuf,
+		uint32_t head, uint32_t tail)
 {
-	const void *from;
+	return (tail >= head) ? (tail - head) : (sbuf->size - head + tail);
+}
 
-	if ((sbuf == NULL) || (data == NULL))
-		return -EINVAL;
+/*
+ * Read up to nr elements into data with a single update of head.
+ * Returns the number of elements read.
+ */
+uint32_t sbuf_get_many(shared_buf_t *sbuf, uint8_t *data, uint32_t nr)
+{
+	const uint8_t *base = (const uint8_t *)sbuf + SBUF_HEAD_SIZE;
+	uint32_t head, tail, n, len, run, next_head;
 
-	if (sbuf_is_empty(sbuf)) {
-		/* no data available */
+	if ((sbuf == NULL) || (data == NULL))
 		return 0;
-	}
-
-	from = (void *)sbuf + SBUF_HEAD_SIZE + sbuf->head;
 
-	memcpy(data, from, sbuf->ele_size);
+	do {
+		head = __atomic_load_n(&sbuf->head, __ATOMIC_ACQUIRE);
+		tail = __atomic_load_n(&sbuf->tail, __ATOMIC_ACQUIRE);
+		n = sbuf_used(sbuf, head, tail) / sbuf->ele_size;
+		if (nr < n)
+			n = nr;
+		if (n == 0) {
+			/* no data available */
+			return 0;
+		}
+
+		len = n * sbuf->ele_size;
+		run = sbuf->size - head;
+		if (len < run)
+			run = len;
+		memcpy(data, base + head, run);
+		memcpy(data + run, base, len - run);
+		next_head = sbuf_next_ptr(head, len, sbuf->size);
+
+		if (!(sbuf->flags & OVERWRITE_EN)) {
+			__atomic_store_n(&sbuf->head, next_head,
+					__ATOMIC_RELEASE);
+			break;
+		}
+		/* the producer may have overwritten what we read */
+	} while (!__atomic_compare_exchange_n(&sbuf->head, &head, next_head,
+			false, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+	return n;
+}
 
-	sbuf->head = sbuf_next_ptr(sbuf->head, sbuf->ele_size, sbuf->size);
+int sbuf_get(shared_buf_t *sbuf, uint8_t *data)
+{
+	if ((sbuf == NULL) || (data == NULL))
+		return -EINVAL;
 
-	return sbuf->ele_size;
+	return sbuf_get_many(sbuf, data, 1) * sbuf->ele_size;
 }
 
+/*
+ * Write the elements from head up to tail, or up to the end of the ring
+ * if they wrap, to fd with one write(). The elements are written in
+ * place, so the producer must not use OVERWRITE_EN meanwhile.
+ */
 int sbuf_write(int fd, shared_buf_t *sbuf)
 {
 	const void *start;
+	uint32_t head, tail, len;
 	int written;
 
 	if (sbuf == NULL)
 		return -EINVAL;
 
-	if (sbuf_is_empty(sbuf)) {
+	head = __atomic_load_n(&sbuf->head, __ATOMIC_RELAXED);
+	tail = __atomic_load_n(&sbuf->tail, __ATOMIC_ACQUIRE);
+	if (head == tail)
 		return 0;
-	}
 
-	start = (void *)sbuf + SBUF_HEAD_SIZE + sbuf->head;
-        written = write(fd, start, sbuf->ele_size);
-	if (written != sbuf->ele_size) {
-		printf("Failed to write: ret %d (ele_size %d), errno %d\n",
-			written, sbuf->ele_size, (written == -1) ? errno : 0);
+	len = (tail > head) ? (tail - head) : (sbuf->size - head);
+	start = (void *)sbuf + SBUF_HEAD_SIZE + head;
+	written = write(fd, start, len);
+	if (written != len) {
+		printf("Failed to write: ret %d (len %u), errno %d\n",
+			written, len, (written == -1) ? errno : 0);
 		return -1;
 	}
 
-	sbuf->head = sbuf_next_ptr(sbuf->head, sbuf->ele_size, sbuf->size);
+	__atomic_store_n(&sbuf->head, sbuf_next_ptr(head, len, sbuf->size),
+			__ATOMIC_RELEASE);
 
-	return sbuf->ele_size;
+	return len;
 }
 
 int sbuf_clear_buffered(shared_buf_t *sbuf)
@@ -76,7 +116,9 @@ int sbuf_clear_buffered(shared_buf_t *sbuf)
 	if (sbuf == NULL)
 		return -EINVAL;
 
-	sbuf->head = sbuf->tail;
+	__atomic_store_n(&sbuf->head,
+			__atomic_load_n(&sbuf->tail, __ATOMIC_ACQUIRE),
+			__ATOMIC_RELEASE);
 
 	return 0;
 }
@@ -9,9 +9,10 @@
 
 #include <linux/types.h>
 
-#define SBUF_MAGIC 0x5aa57aa71aa13aa3
+/* Changes with the layout of shared_buf_t, as in the hypervisor */
+#define SBUF_MAGIC 0x5aa57aa71aa13aa4
 #define SBUF_MAX_SIZE   (1ULL << 22)
-#define SBUF_HEAD_SIZE  64
+#define SBUF_HEAD_SIZE  192
 
 /* sbuf flags */
 #define OVERRUN_CNT_EN  (1ULL << 0) /* whether overrun counting is enabled */
@@ -26,6 +27,11 @@ typedef unsigned long uint64_t;
  * buffer empty: tail == head
  * buffer full:  (tail + ele_size) % size == head
  *
+ * Same layout and protocol as the hypervisor side: the producer only writes
+ * tail and the consumer only writes head, each stored with release order
+ * after the elements are written or read. With OVERWRITE_EN the producer
+ * also moves head, and the consumer updates it with cmpxchg.
+ *
  *             Base of memory for elements
  *                |
  *                |
@@ -37,17 +43,23 @@ typedef unsigned long uint64_t;
  * shared_buf_t *buf
  */
 
-/* Make sure sizeof(shared_buf_t) == SBUF_HEAD_SIZE */
+/* Make sure sizeof(shared_buf_t) == SBUF_HEAD_SIZE, with the read-mostly
+ * fields, the producer side and the consumer side on separate cache lines.
+ */
 typedef struct shared_buf {
         uint64_t magic;
         uint32_t ele_num;       /* number of elements */
         uint32_t ele_size;      /* sizeof of elements */
-        uint32_t head;          /* offset from base, to read */
-        uint32_t tail;          /* offset from base, to write */
         uint64_t flags;
-        uint32_t overrun_cnt;   /* count of overrun */
         uint32_t size;          /* ele_num * ele_size */
-        uint32_t padding[6];
+        uint32_t padding0[9];
+
+        uint32_t tail;          /* offset from base, to write */
+        uint32_t overrun_cnt;   /* count of overrun */
+        uint32_t padding1[14];
+
+        uint32_t head;          /* offset from base, to read */
+        uint32_t padding2[15];
 } shared_buf_t;
 
 static inline void sbuf_clear_flags(shared_buf_t *sbuf, uint64_t flags)
@@ -66,6 +78,7 @@ static inline void sbuf_add_flags(shared_buf_t *sbuf, uint64_t flags)
 }
 
 int sbuf_get(shared_buf_t *sbuf, uint8_t *data);
+uint32_t sbuf_get_many(shared_buf_t *sbuf, uint8_t *data, uint32_t nr);
 int sbuf_write(int fd, shared_buf_t *sbuf);
 int sbuf_clear_buffered(shared_buf_t *sbuf);
 #endif /* SHARED_BUF_H */
@@ -26,12 +26,14 @@ def usage():
           {event_id}{whitespace}{text format string}
 
           The textual format string may include format specifiers, such as
-          %(cpu)d, %(tsc)d, %(event)d, %(1)d, %(2)d, ....
+          %(cpu)d, %(tsc)d, %(event)d, %(1)d, %(2)d, ...., %(str)s.
           The 'd' format specifier outputs in decimal, alternatively 'x' will
           output in hexadecimal and 'o' will output in octal.
 
           These respectively correspond to the CPU number (cpu), timestamp
           counter (tsc), event ID (event) and the data logged in the trace file.
+          str is the string of the events with 16 data, joined with the
+          TRACE_STR_CONT entries which follow them.
           There can be only one such rule for each type of event.
           """
 
@@ -73,9 +75,28 @@ D4REC = "IIII"
 D8REC = "BBBBBBBBBBBBBBBB"
 D16REC = "bbbbbbbbbbbbbbbb"
 
+# Continuation of the string of the previous entry: the length of the whole
+# string, then up to TRACE_STR_CHUNK characters
+TRACE_STR_CONT = 0xFB
+TRACE_STR_CHUNK = 15
+
+def print_entry(formats, args):
+    if args is None:
+        return
+
+    event = str(args['event'])
+    try:
+        if event in formats.keys():
+            print (formats[event] % args)
+    except TypeError:
+        if event in formats.keys():
+            print (formats[event])
+            print (args)
+
 def main_loop(formats, fd):
     global exit
     i = 0
+    pending = None
 
 
     while not exit:
@@ -111,6 +132,7 @@ def main_loop(formats, fd):
             d14 = 0
             d15 = 0
             d16 = 0
+            raw = b''
 
             if n_data == 2:
                 line = fd.read(struct.calcsize(D2REC))
@@ -137,6 +159,7 @@ def main_loop(formats, fd):
                 line = fd.read(struct.calcsize(D16REC))
                 if not line:
                     break
+                raw = line
 
                 (d1, d2, d3, d4, d5, d6, d7, d8,
                  d9, d10, d11, d12, d13, d14, d15, d16) = struct.unpack(D16REC, line)
@@ -159,18 +182,25 @@ def main_loop(formats, fd):
                     '13'    : d13,
                     '14'    : d14,
                     '15'    : d15,
-                    '16'    : d16      }
+                    '16'    : d16,
+                    'str'   : raw.split(b'\0', 1)[0].decode('ascii',
+                                                         'replace') }
 
-            try:
-                if str(event) in formats.keys():
-                    print (formats[str(event)] % args)
-            except TypeError:
-                if str(event) in formats.key():
-                    print (formats[str(event)])
-                    print (args)
+            if event == TRACE_STR_CONT:
+                if pending is not None and len(raw) > 0:
+                    chunk = raw[1:1 + TRACE_STR_CHUNK].decode('ascii',
+                                                              'replace')
+                    pending['str'] = (pending['str'] + chunk)[:raw[0]]
+                continue
+
+            # An entry is printed once its string is complete
+            print_entry(formats, pending)
+            pending = args
 
         except struct.error:
-            sys.exit()
+            break
+
+    print_entry(formats, pending)
 
 def main(argv):
     try: